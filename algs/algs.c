@@ -242,6 +242,7 @@ void crypto_op_done(fsl_crypto_dev_t *c_dev, crypto_job_ctx_t *ctx,
 		/* AVOID WARNINGS */
 	case RNG_INIT:
 	case RNG_SELF_TEST:
+	case PKHA:
 		break;
 #ifdef VIRTIO_C2X0
 	default:
@@ -269,11 +270,26 @@ int32_t check_device(fsl_crypto_dev_t *c_dev)
 	return 0;
 }
 
+/*******************************************************************************
+ * Function     : device_local
+ *
+ * Arguments    : c_dev - device
+ *
+ * Return Value : true if the device sits on the NUMA node of the calling CPU
+ *		  or its node is unknown
+ *
+ ******************************************************************************/
+bool device_local(fsl_crypto_dev_t *c_dev)
+{
+	int node = dev_to_node(&c_dev->priv_dev->dev->dev);
+
+	return node < 0 || node == numa_node_id();
+}
+
 fsl_crypto_dev_t *get_device_rr(void)
 {
-	uint32_t no_of_devices = 0, new_device = 0;
-	int device_status = 0, count = 0, cpu = 0;
-	per_dev_struct_t *dev_stat = NULL;
+	uint32_t no_of_devices = 0, start = 0;
+	int count = 0, local = 0;
 	fsl_crypto_dev_t *c_dev = NULL;
 
     no_of_devices = get_no_of_devices();
@@ -282,42 +298,121 @@ fsl_crypto_dev_t *get_device_rr(void)
         return NULL;
     }
 
-	while (!device_status && count < no_of_devices) {
-		new_device =
-			((atomic_inc_return(&selected_devices) -
-				1) % no_of_devices) + 1;
-		c_dev = get_crypto_dev(new_device);
-		if (!c_dev) {
-			print_error
-				("Could not retrieve the device structure.\n");
-			return NULL;
+	start = atomic_inc_return(&selected_devices) - 1;
+
+	/* Devices local to the calling CPU first, then any of them */
+	for (local = 1; local >= 0; local--) {
+		for (count = 0; count < no_of_devices; count++) {
+			c_dev = get_crypto_dev(((start + count) %
+						no_of_devices) + 1);
+			if (!c_dev) {
+				print_error
+					("Could not retrieve the device structure.\n");
+				return NULL;
+			}
+
+			if (local && !device_local(c_dev))
+				continue;
+			if (device_alive(c_dev))
+				return c_dev;
 		}
+	}
 
-		cpu = get_cpu();
-		dev_stat = per_cpu_ptr(c_dev->dev_status, cpu);
-		put_cpu();
+	print_error("No Device is ALIVE\n");
+	return NULL;
+}
 
-		device_status = atomic_read(&(dev_stat->device_status));
-		count++;
+/*******************************************************************************
+ * Function     : get_device_ll
+ *
+ * Arguments    : r_id - returns the least loaded application ring of the
+ *			 selected device
+ *
+ * Return Value : Least loaded alive device, NULL if there is none
+ *
+ * Description  : Load of a device is the sum of the jobs in flight on its
+ *		  application rings, divided by the number of its SEC
+ *		  engines. Devices local to the calling CPU are preferred
+ *		  over remote ones whatever their load. The scan starts at
+ *		  a rotating device so that idle devices share the work
+ *		  evenly.
+ *
+ ******************************************************************************/
+fsl_crypto_dev_t *get_device_ll(uint32_t *r_id)
+{
+	uint32_t no_of_devices, start, i, rid, dev_rid = 0;
+	uint32_t occ, ring_occ, load, secs, best_secs = 1;
+	uint32_t best_load = 0, best_rid = 0;
+	bool local, best_local = false;
+	fsl_crypto_dev_t *c_dev, *best = NULL;
+
+	no_of_devices = get_no_of_devices();
+	if (0 >= no_of_devices) {
+		print_error("No Device configured\n");
+		return NULL;
+	}
+
+	start = atomic_inc_return(&selected_devices);
+	for (i = 0; i < no_of_devices; i++) {
+		c_dev = get_crypto_dev(((start + i) % no_of_devices) + 1);
+		if (!c_dev || c_dev->num_of_rings < 2 || !device_alive(c_dev))
+			continue;
+
+		load = 0;
+		ring_occ = U32_MAX;
+		dev_rid = 0;
+		for (rid = 1; rid < c_dev->num_of_rings; rid++) {
+			occ = ring_occupancy(c_dev, rid);
+			load += occ;
+			/* A ring being reconfigured takes no new jobs */
+			if (atomic_read(&c_dev->ring_pairs[rid].block))
+				continue;
+			if (occ < ring_occ) {
+				ring_occ = occ;
+				dev_rid = rid;
+			}
+		}
+		if (!dev_rid)
+			continue;
+
+		secs = c_dev->dev_info.num_sec_engines ? : 1;
+		local = device_local(c_dev);
+		/* load / secs < best_load / best_secs */
+		if (!best || (local && !best_local) ||
+		    (local == best_local && (uint64_t)load * best_secs <
+					    (uint64_t)best_load * secs)) {
+			best = c_dev;
+			best_local = local;
+			best_load = load;
+			best_secs = secs;
+			best_rid = dev_rid;
+		}
 	}
 
-	if (!device_status) {
+	if (!best) {
 		print_error("No Device is ALIVE\n");
-		return NULL;		
+		return NULL;
 	}
 
-	return c_dev;
+	*r_id = best_rid;
+	return best;
 }
 
 uint32_t get_ring_rr(fsl_crypto_dev_t *c_dev)
 {
-	uint32_t no_of_app_rings = 0;
+	uint32_t no_of_app_rings = 0, i;
 	int32_t r_id = 0;
 	no_of_app_rings = c_dev->num_of_rings - 1;
 
 	if (0 < no_of_app_rings) {
-		r_id = atomic_inc_return(&c_dev->crypto_dev_sess_cnt);
-		r_id = (r_id - 1) % no_of_app_rings + 1;
+		/* Skip the rings being reconfigured, 0 if all of them are */
+		for (i = 0; i < no_of_app_rings; i++) {
+			r_id = atomic_inc_return(&c_dev->crypto_dev_sess_cnt);
+			r_id = (r_id - 1) % no_of_app_rings + 1;
+			if (!atomic_read(&c_dev->ring_pairs[r_id].block))
+				return r_id;
+		}
+		r_id = 0;
 	} else {
 		print_error("No application ring configured\n");
 	}
@@ -341,28 +436,88 @@ dev_dma_addr_t set_sec_affinity(fsl_crypto_dev_t *c_dev, uint32_t rid,
 }
 #endif
 
-void dma_tx_complete_cb(void *ctx)
+/*******************************************************************************
+ * Function     : device_alive
+ *
+ * Arguments    : c_dev - device
+ *
+ * Return Value : true if the device accepts jobs
+ *
+ * Description  : Same check as check_device() without accounting a job.
+ *
+ ******************************************************************************/
+bool device_alive(fsl_crypto_dev_t *c_dev)
+{
+	per_dev_struct_t *dev_stat;
+	int cpu;
+
+	cpu = get_cpu();
+	dev_stat = per_cpu_ptr(c_dev->dev_status, cpu);
+	put_cpu();
+
+	return 0 != atomic_read(&dev_stat->device_status);
+}
+
+/*******************************************************************************
+ * Function     : ring_occupancy
+ *
+ * Arguments    : c_dev - device
+ *		  rid   - ring id
+ *
+ * Return Value : Number of jobs posted on the ring and not yet consumed by fw
+ *
+ * Description  : Lockless snapshot; good enough for load estimation only.
+ *
+ ******************************************************************************/
+uint32_t ring_occupancy(fsl_crypto_dev_t *c_dev, uint32_t rid)
+{
+	fsl_h_rsrc_ring_pair_t *rp = &c_dev->ring_pairs[rid];
+
+	return rc_req_inflight(rp->counters, rp->s_c_counters);
+}
+
+#ifdef SW_FALLBACK
+/*******************************************************************************
+ * Function     : ring_latency_update
+ *
+ * Arguments    : ctx - completed crypto context
+ *
+ * Return Value : void
+ *
+ * Description  : Folds the completion latency of the job and the ring
+ *		  occupancy it saw at enqueue time into the ring averages
+ *		  (EWMA with 1/8 weight). occ_avg is kept scaled by 8 so
+ *		  that small occupancies do not round away.
+ *
+ ******************************************************************************/
+void ring_latency_update(crypto_op_ctx_t *ctx)
+{
+	fsl_h_rsrc_ring_pair_t *rp = &ctx->c_dev->ring_pairs[ctx->rid];
+	s64 lat = ktime_to_ns(ktime_sub(ktime_get(), ctx->stamp));
+
+	if (lat < 0 || lat > U32_MAX)
+		return;
+
+	rp->lat_avg = rp->lat_avg - (rp->lat_avg >> 3) + ((uint32_t)lat >> 3);
+	rp->occ_avg = rp->occ_avg - (rp->occ_avg >> 3) + ctx->occ;
+}
+#endif
+
+int dma_tx_complete_cb(void *ctx)
 {
 	crypto_op_ctx_t *crypto_ctx = ctx;
 	fsl_crypto_dev_t *c_dev = crypto_ctx->c_dev;
-#ifndef HIGH_PERF
-	if (atomic_inc_return(&crypto_ctx->reqcnt) <
-	    atomic_read(&crypto_ctx->maxreqs))
-		return;
 
-	kfree(crypto_ctx->crypto_mem.ip_sg);
-	kfree(crypto_ctx->crypto_mem.op_sg);
+	/* Runs from the DMA completion: a full ring is left to dma.c to retry
+	 * rather than waited for */
+	if (app_ring_enqueue_job(c_dev, crypto_ctx->rid,
+				 set_sec_affinity(c_dev, crypto_ctx->rid,
+						  crypto_ctx->desc),
+				 crypto_ctx))
+		return -1;
 
 	atomic_dec(&c_dev->active_jobs);
-#endif
-RETRY:
-	if (app_ring_enqueue(c_dev, crypto_ctx->rid, 
-			set_sec_affinity(c_dev, crypto_ctx->rid, crypto_ctx->desc))) {
-		print_error("App ring enqueue failed...\n");
-		set_current_state(TASK_INTERRUPTIBLE);
-		schedule_timeout(usecs_to_jiffies(10));
-		goto RETRY;
-	}
+	return 0;
 }
 
 #ifdef DEBUG_DESC
@@ -80,6 +80,7 @@ typedef enum crypto_op {
 	RNG,
 	RNG_INIT,
 	RNG_SELF_TEST,
+	PKHA,
 #ifdef VIRTIO_C2X0
 	VIRTIO_C2X0_HASH_CRA_INIT = 100,
 	VIRTIO_C2X0_HASH_CRA_EXIT = 101,
@@ -114,17 +115,31 @@ Fields      :   c_dev:	Crypto device instance to which this session belongs
 		r_id :	Id of the ring to which this session belongs
 		sec_eng:Id of the sec engine to which this session belongs.
 			Used only in case of Symmetric algorithms
+		inflight:Jobs of the session not completed yet
+		unordered:Session may change rings with jobs in flight
+		striped:Each request goes to the least loaded device and ring
+		order:	Reorder window delivering the completions of a striped
+			session in submission order, NULL if not asked for
 *******************************************************************************/
+struct sess_order;
+
+
 typedef struct crypto_dev_sess {
 	fsl_crypto_dev_t *c_dev;
 	uint32_t r_id;
 	uint8_t sec_eng;
+	atomic_t inflight;
+	bool unordered;
+	bool striped;
+	struct sess_order *order;
 	union {
 		struct hash_ctx hash;
 		struct sym_ctx symm;
 	} u;
 } crypto_dev_sess_t;
 
+int fill_crypto_dev_sess_ctx(crypto_dev_sess_t *ctx, uint32_t op_type);
+
 #ifdef VIRTIO_C2X0
 struct virtio_c2x0_crypto_sess_ctx {
 	crypto_dev_sess_t c_sess;
@@ -192,24 +207,91 @@ typedef struct crypto_op_ctx {
 	dev_dma_addr_t desc;
 	fsl_crypto_dev_t *c_dev;
 
-	atomic_t maxreqs;
-	atomic_t reqcnt;
+#ifdef USE_HOST_DMA
+	/* Last operand copy of the job, and what hands it to its ring once
+	 * the copy is done */
+	dma_cookie_t dma_cookie;
+	int (*dma_done) (void *ctx);
+	/* Operand bytes the job put on its channel */
+	uint32_t dma_len;
+#endif
 
 	union {
 		struct pkc_request *pkc;
 		struct rng_init_compl *rng_init;
 		struct buf_data *rng;
+		struct rng_direct *rng_direct;
 		struct ahash_request *ahash;
 		struct ablkcipher_request *ablk;
+		struct skcipher_request *skc;
 	} req;
 	struct split_key_result *result;
 	void (*op_done) (void *ctx, int32_t result);
+	/* Session the job is accounted to, NULL for sessionless requests */
+	crypto_dev_sess_t *sess;
 #ifdef VIRTIO_C2X0
 	int32_t card_status;
+#endif
+#ifdef SW_FALLBACK
+	/* Enqueue time and ring occupancy, feeds the ring latency estimate */
+	ktime_t stamp;
+	uint32_t occ;
+#endif
+#ifndef VIRTIO_C2X0
+	/* Entry in the outstanding jobs of its ring, next is NULL when the
+	 * job is not tracked. A PKC job joins the list in the same hold of
+	 * the ring lock that enqueues it, after its copy with host DMA */
+	struct list_head ring_list;
+	bool ring_job;
 #endif
 	struct crypto_op_ctx *next;
 } crypto_op_ctx_t;
 
+int sess_order_add(struct sess_order *order, struct pkc_request *req);
+void sess_order_cancel(struct sess_order *order, struct pkc_request *req);
+void sess_order_requeue(struct sess_order *order, struct pkc_request *req);
+void ring_job_del(crypto_op_ctx_t *ctx);
+
+/* Accounts a job to its ring and session until its response is handled */
+static inline int sess_job_start(crypto_op_ctx_t *ctx,
+				 crypto_dev_sess_t *c_sess)
+{
+	if (c_sess) {
+#ifndef VIRTIO_C2X0
+		if (c_sess->order && sess_order_add(c_sess->order,
+						    ctx->req.pkc))
+			return -1;
+#endif
+		atomic_inc(&c_sess->inflight);
+		ctx->sess = c_sess;
+	}
+#ifndef VIRTIO_C2X0
+	ctx->ring_job = true;
+#endif
+	return 0;
+}
+
+static inline void sess_job_end(crypto_op_ctx_t *ctx)
+{
+#ifndef VIRTIO_C2X0
+	ring_job_del(ctx);
+#endif
+	if (ctx->sess) {
+		atomic_dec(&ctx->sess->inflight);
+		ctx->sess = NULL;
+	}
+}
+
+/* The job is dropped before its response, nothing will be delivered */
+static inline void sess_job_abort(crypto_op_ctx_t *ctx)
+{
+#ifndef VIRTIO_C2X0
+	if (ctx->sess && ctx->sess->order)
+		sess_order_cancel(ctx->sess->order, ctx->req.pkc);
+#endif
+	sess_job_end(ctx);
+}
+
 /*******************************************************************************
 Description :   Defines the context for application request entry.
 		This will be use by firmware in response processing.
@@ -222,7 +304,7 @@ typedef struct app_req_job_ctx {
 void dump_desc(void *buff, uint32_t desc_size, const uint8_t *func);
 void change_desc_endianness(uint32_t *dev_mem,
 			    uint32_t *host_mem, int32_t words);
-void dma_tx_complete_cb(void *ctx);
+int dma_tx_complete_cb(void *ctx);
 int32_t check_device(fsl_crypto_dev_t *c_dev);
 void crypto_op_done(fsl_crypto_dev_t *c_dev,
 		    crypto_job_ctx_t *ctx, int32_t sec_result);
@@ -230,5 +312,12 @@ dev_dma_addr_t set_sec_affinity(fsl_crypto_dev_t *c_dev, uint32_t rid,
 								dev_dma_addr_t desc);
 uint32_t get_ring_rr(fsl_crypto_dev_t *c_dev);
 fsl_crypto_dev_t *get_device_rr(void);
+fsl_crypto_dev_t *get_device_ll(uint32_t *r_id);
+bool device_alive(fsl_crypto_dev_t *c_dev);
+bool device_local(fsl_crypto_dev_t *c_dev);
+uint32_t ring_occupancy(fsl_crypto_dev_t *c_dev, uint32_t rid);
+#ifdef SW_FALLBACK
+void ring_latency_update(crypto_op_ctx_t *ctx);
+#endif
 
 #endif
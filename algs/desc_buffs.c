@@ -62,6 +62,8 @@ static void distribute_buffers(crypto_mem_info_t *mem_info, uint8_t *mem)
 			}
 			break;
 		case BT_OP:
+		case BT_RES:
+		case BT_HOST:
 			break;
 		}
 	}
@@ -108,6 +110,8 @@ int32_t alloc_crypto_mem(crypto_mem_info_t *mem_info)
 			}
 			break;
 		case BT_OP:
+		case BT_RES:
+		case BT_HOST:
 			break;
 		}
 	}
@@ -170,6 +174,14 @@ int32_t dealloc_crypto_mem(crypto_mem_info_t *mem_info)
 						 h_dma_addr, buffers[i].len,
 						 PCI_DMA_BIDIRECTIONAL);
 			}
+			break;
+		case BT_HOST:
+			if (buffers[i].dev_buffer.h_dma_addr) {
+				pci_unmap_page(pci_dev->dev, buffers[i].dev_buffer.
+					       h_dma_addr, buffers[i].len,
+					       PCI_DMA_TODEVICE);
+			}
+			break;
 		default:
 			break;
 		}
@@ -232,6 +244,7 @@ void host_to_dev(crypto_mem_info_t *mem_info)
 		switch (buffers[i].bt) {
 		case BT_DESC:
 		case BT_IP:
+		case BT_RES:
 			buffers[i].dev_buffer.h_dma_addr = buffers[i].dev_buffer.h_p_addr;
 			buffers[i].dev_buffer.h_map_p_addr = h_map_p_addr(mem_info->dev, buffers[i].v_mem);
 
@@ -244,6 +257,12 @@ void host_to_dev(crypto_mem_info_t *mem_info)
 			buffers[i].dev_buffer.d_p_addr = op_buf_d_dma_addr(mem_info->dev,
 					      buffers[i].dev_buffer.h_dma_addr);
 			break;
+		case BT_HOST:
+			/* Mapped by the caller, SEC reaches it through the
+			 * same window as the outputs */
+			buffers[i].dev_buffer.d_p_addr = op_buf_d_dma_addr(mem_info->dev,
+					      buffers[i].dev_buffer.h_dma_addr);
+			break;
 		}
 	}
 }
@@ -309,6 +328,32 @@ int32_t unmap_crypto_mem(crypto_mem_info_t *crypto_mem) {
 
 	return 0;
 }
+
+/**
+ * Map a BT_HOST buffer for SEC to read from the host; dealloc_crypto_mem()
+ * unmaps it.
+ *
+ * @param  c_dev device of the job
+ * @param  buff  BT_HOST buffer
+ * @param  sg    host memory behind the buffer
+ * @return       error code
+ *               0:       success
+ *               -ENOMEM: failure
+ */
+int32_t map_host_buff(fsl_crypto_dev_t *c_dev, buffer_info_t *buff,
+		      struct scatterlist *sg)
+{
+	struct pci_dev *dev = c_dev->priv_dev->dev;
+	dma_addr_t dma;
+
+	dma = pci_map_page(dev, sg_page(sg), sg->offset, sg->length,
+			   PCI_DMA_TODEVICE);
+	if (pci_dma_mapping_error(dev, dma))
+		return -ENOMEM;
+
+	buff->dev_buffer.h_dma_addr = dma;
+	return 0;
+}
 #endif
 
 /******************************************************************************
@@ -338,6 +383,8 @@ int32_t memcpy_to_dev(crypto_mem_info_t *mem)
 		case BT_IP:
 			memcpy(dst->d_v_addr, src->req_ptr, src->len);
 		case BT_OP:
+		case BT_RES:
+		case BT_HOST:
 			break;
 		}
 	}
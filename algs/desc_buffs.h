@@ -39,7 +39,11 @@
 typedef enum buffer_type {
 	BT_DESC,
 	BT_IP,
-	BT_OP
+	BT_OP,
+	/* Input already resident in the device pool, nothing to copy */
+	BT_RES,
+	/* Input SEC reads from host memory mapped by the caller (SEC_DMA) */
+	BT_HOST
 } buffer_type_t;
 
 typedef struct dev_buffer {
@@ -161,6 +165,30 @@ typedef struct dh_keygen_buffers {
     buffer_info_t   ab_buff;
 }dh_keygen_buffers_t;
 
+typedef struct pkha_modexp_buffers {
+	buffer_info_t desc_buff;
+	buffer_info_t n_buff;
+	buffer_info_t e_buff;
+	buffer_info_t a_buff;
+	buffer_info_t b_buff;
+} pkha_modexp_buffers_t;
+
+typedef struct pkha_ecmul_buffers {
+	buffer_info_t desc_buff;
+	buffer_info_t q_buff;
+	buffer_info_t p_buff;
+	buffer_info_t ab_buff;
+	buffer_info_t k_buff;
+	buffer_info_t out_buff;
+} pkha_ecmul_buffers_t;
+
+typedef struct pkha_prime_buffers {
+	buffer_info_t desc_buff;
+	buffer_info_t n_buff;
+	buffer_info_t rounds_buff;
+	buffer_info_t seed_buff;
+} pkha_prime_buffers_t;
+
 typedef struct rng_init_buffers {
 	buffer_info_t desc_buff;
 	buffer_info_t pers_str_buff;
@@ -213,6 +241,9 @@ typedef union crypto_buffers {
 	dsa_keygen_buffers_t dsa_keygen;
 	dh_key_buffers_t dh_key;
 	dh_keygen_buffers_t dh_keygen;
+	pkha_modexp_buffers_t pkha_modexp;
+	pkha_ecmul_buffers_t pkha_ecmul;
+	pkha_prime_buffers_t pkha_prime;
 	rng_init_buffers_t rng_init;
 	rng_self_test_buffers_t rng_self_test;
 	rng_buffers_t rng;
@@ -241,6 +272,19 @@ void host_to_dev(crypto_mem_info_t *mem_info);
 #ifdef SEC_DMA
 int32_t map_crypto_mem(crypto_mem_info_t *crypto_mem);
 int32_t unmap_crypto_mem(crypto_mem_info_t *crypto_mem);
+int32_t map_host_buff(fsl_crypto_dev_t *c_dev, buffer_info_t *buff,
+		      struct scatterlist *sg);
+
+/* SEC reads the inputs straight from host memory, except the resident ones
+ * which already sit in the device pool */
+static inline dev_dma_addr_t sec_dma_ip_addr(buffer_info_t *buff,
+					     dev_p_addr_t offset)
+{
+	if (BT_RES == buff->bt)
+		return buff->dev_buffer.d_p_addr;
+
+	return buff->dev_buffer.h_p_addr + offset;
+}
 #endif
 int32_t dealloc_crypto_mem(crypto_mem_info_t *mem_info);
 int32_t alloc_crypto_mem(crypto_mem_info_t *mem_info);
@@ -43,6 +43,8 @@
 #include "desc.h"
 #include "memmgr.h"
 #include "crypto_ctx.h"
+#include "ring_balance.h"
+#include "ecc_curves.h"
 #ifdef VIRTIO_C2X0
 #include "fsl_c2x0_virtio.h"
 #endif
@@ -135,31 +137,39 @@ static int dh_key_cp_req(struct dh_key_req_s *req, crypto_mem_info_t *mem_info,
 			 bool ecdh)
 {
 	dh_key_buffers_t *mem = (dh_key_buffers_t *) (mem_info->buffers);
+	bool res_curve = false;
+
 	dh_key_init_len(req, mem_info, ecdh);
+	if (ecdh)
+		res_curve = ecc_curve_res_buffs(mem_info->dev,
+						&mem->q_buff, req->q,
+						NULL, NULL, NULL, NULL,
+						&mem->ab_buff, req->ab);
 
 	/* Alloc mem requrd for crypto operation */
 	print_debug("Calling alloc_crypto_mem\n");
 	if (-ENOMEM == alloc_crypto_mem(mem_info))
 		return -ENOMEM;
 #ifdef USE_HOST_DMA
-	memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
+	if (!res_curve)
+		memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
 	memcpy(mem->w_buff.v_mem, req->pub_key, mem->w_buff.len);
 	memcpy(mem->s_buff.v_mem, req->s, mem->s_buff.len);
 
-	if (ecdh)
-		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
-	else
+	if (!ecdh)
 		mem->ab_buff.v_mem = NULL;
+	else if (!res_curve)
+		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
 #else
-	mem->q_buff.req_ptr = req->q;
+	if (!res_curve)
+		mem->q_buff.req_ptr = req->q;
 	mem->w_buff.req_ptr = req->pub_key;
 	mem->s_buff.req_ptr = req->s;
 
-	if (ecdh) {
-		mem->ab_buff.req_ptr = req->ab;
-	} else {
+	if (!ecdh)
 		mem->ab_buff.req_ptr = NULL;
-	}
+	else if (!res_curve)
+		mem->ab_buff.req_ptr = req->ab;
 #endif
 	mem->z_buff.v_mem = req->z;
 	return 0;
@@ -168,31 +178,42 @@ static int dh_key_cp_req(struct dh_key_req_s *req, crypto_mem_info_t *mem_info,
 static int dh_keygen_cp_req(struct dh_keygen_req_s *req, crypto_mem_info_t *mem_info, bool ecdh)
 {
     dh_keygen_buffers_t *mem    =   (dh_keygen_buffers_t *)(mem_info->buffers);
+    bool res_curve = false;
+
     dh_keygen_init_len(req, mem_info, ecdh);
+    if(ecdh)
+        res_curve = ecc_curve_res_buffs(mem_info->dev,
+                                        &mem->q_buff, req->q,
+                                        &mem->r_buff, req->r,
+                                        &mem->g_buff, req->g,
+                                        &mem->ab_buff, req->ab);
 
     /* Alloc mem requrd for crypto operation */
     print_debug("Calling alloc_crypto_mem\n");
     if(-ENOMEM == alloc_crypto_mem(mem_info))
         return -ENOMEM;
 #ifdef USE_HOST_DMA
-    memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
-    memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
-    memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+    if(!res_curve) {
+        memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
+        memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
+        memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+    }
 
-    if(ecdh)
-       memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
-    else
+    if(!ecdh)
        mem->ab_buff.v_mem     =   NULL;
+    else if(!res_curve)
+       memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
 #else
-    mem->q_buff.req_ptr         =   req->q;
-    mem->r_buff.req_ptr         =   req->r;
-    mem->g_buff.req_ptr         =   req->g;
+    if(!res_curve) {
+        mem->q_buff.req_ptr     =   req->q;
+        mem->r_buff.req_ptr     =   req->r;
+        mem->g_buff.req_ptr     =   req->g;
+    }
 
-    if(ecdh) {
-       mem->ab_buff.req_ptr     =   req->ab;
-    } else {
+    if(!ecdh)
        mem->ab_buff.req_ptr     =   NULL;
-    }
+    else if(!res_curve)
+       mem->ab_buff.req_ptr     =   req->ab;
 #endif
     mem->prvkey_buff.v_mem     =   req->prvkey;
     mem->pubkey_buff.v_mem     =   req->pubkey;
@@ -264,10 +285,10 @@ static void constr_ecdh_key_desc(crypto_mem_info_t *mem_info, bool ecc_bin)
 		      HDR_ONE);
 
 #ifdef SEC_DMA
-        ASSIGN64(ecdh_key_desc->q_dma, (mem->q_buff.dev_buffer.h_p_addr + offset));
+        ASSIGN64(ecdh_key_desc->q_dma, sec_dma_ip_addr(&mem->q_buff, offset));
         ASSIGN64(ecdh_key_desc->w_dma, (mem->w_buff.dev_buffer.h_p_addr + offset));
         ASSIGN64(ecdh_key_desc->s_dma, (mem->s_buff.dev_buffer.h_p_addr + offset));
-        ASSIGN64(ecdh_key_desc->ab_dma, (mem->ab_buff.dev_buffer.h_p_addr + offset));
+        ASSIGN64(ecdh_key_desc->ab_dma, sec_dma_ip_addr(&mem->ab_buff, offset));
 #else
 	ASSIGN64(ecdh_key_desc->q_dma, mem->q_buff.dev_buffer.d_p_addr);
 	ASSIGN64(ecdh_key_desc->w_dma, mem->w_buff.dev_buffer.d_p_addr);
@@ -314,10 +335,10 @@ static void constr_ecdh_keygen_desc(crypto_mem_info_t *mem_info, bool ecc_bin)
     init_job_desc(&ecdh_keygen_desc->desc_hdr, (start_idx << HDR_START_IDX_SHIFT) | (desc_size & HDR_DESCLEN_MASK) | HDR_ONE);
 
 #ifdef SEC_DMA
-    ASSIGN64(ecdh_keygen_desc->q_dma, (mem->q_buff.dev_buffer.h_p_addr + offset));
-    ASSIGN64(ecdh_keygen_desc->r_dma, (mem->r_buff.dev_buffer.h_p_addr + offset));
-    ASSIGN64(ecdh_keygen_desc->g_dma, (mem->g_buff.dev_buffer.h_p_addr + offset));
-    ASSIGN64(ecdh_keygen_desc->ab_dma, (mem->ab_buff.dev_buffer.h_p_addr + offset));
+    ASSIGN64(ecdh_keygen_desc->q_dma, sec_dma_ip_addr(&mem->q_buff, offset));
+    ASSIGN64(ecdh_keygen_desc->r_dma, sec_dma_ip_addr(&mem->r_buff, offset));
+    ASSIGN64(ecdh_keygen_desc->g_dma, sec_dma_ip_addr(&mem->g_buff, offset));
+    ASSIGN64(ecdh_keygen_desc->ab_dma, sec_dma_ip_addr(&mem->ab_buff, offset));
 #else
     ASSIGN64(ecdh_keygen_desc->q_dma, mem->q_buff.dev_buffer.d_p_addr);
     ASSIGN64(ecdh_keygen_desc->r_dma, mem->r_buff.dev_buffer.d_p_addr);
@@ -444,6 +465,7 @@ int dh_op(struct pkc_request *req)
 	int32_t ret = 0;
 	crypto_op_ctx_t *crypto_ctx = NULL;
 	fsl_crypto_dev_t *c_dev = NULL;
+	crypto_dev_sess_t *c_sess = NULL;
 	dev_dma_addr_t sec_dma = 0;
 	uint32_t r_id = 0;
 	dh_key_buffers_t *dh_key_buffs = NULL;
@@ -457,13 +479,11 @@ int dh_op(struct pkc_request *req)
 
 #ifndef VIRTIO_C2X0
 	if (NULL != req->base.tfm) {
-		crypto_dev_sess_t *c_sess;
-		dh_completion_cb = pkc_request_complete;
-		ecdh_completion_cb = pkc_request_complete;
+		dh_completion_cb = crypto_dev_sess_complete;
+		ecdh_completion_cb = crypto_dev_sess_complete;
 		/* Get the session context from input request */
 		c_sess = (crypto_dev_sess_t *)crypto_pkc_ctx(crypto_pkc_reqtfm(req));
-		c_dev = c_sess->c_dev;
-		r_id = c_sess->r_id;
+		r_id = crypto_dev_sess_ring(c_sess, &c_dev);
 #ifndef HIGH_PERF
 		if (-1 == check_device(c_dev))
 			return -1;
@@ -472,30 +492,12 @@ int dh_op(struct pkc_request *req)
 	else
 #endif
     {
-        /* By default using first device --
-         * Logic here will be replaced with LB */
-#ifdef VIRTIO_C2X0
-        if(NULL == (c_dev = get_device_rr()))
-            return -1;
-#else
-        c_dev = get_crypto_dev(1);
-        if (!c_dev) {
-                print_error("Could not retrieve the device structure.\n");
-                return -1;
-        }
-#endif  
-
-#ifndef HIGH_PERF    
-        if(0 == (r_id = get_ring_rr(c_dev)))
+        /* Least loaded device and application ring */
+        if(NULL == (c_dev = get_device_ll(&r_id)))
             return -1;
-
+#ifndef HIGH_PERF
         atomic_inc(&c_dev->active_jobs);
-#else
-        r_id =
-            ((atomic_inc_return(&c_dev->crypto_dev_sess_cnt) -
-                1) % (c_dev->num_of_rings - 1)) + 1;
 #endif
-
     }
 
 #ifdef SEC_DMA
@@ -639,6 +641,10 @@ int dh_op(struct pkc_request *req)
 	crypto_ctx->rid = r_id;
 	crypto_ctx->desc = sec_dma;
 	crypto_ctx->c_dev = c_dev;
+	if (sess_job_start(crypto_ctx, c_sess)) {
+		ret = -1;
+		goto error;
+	}
 
 	if (ecdh) {
 		crypto_ctx->op_done = ecdh_op_done;
@@ -669,7 +675,7 @@ int dh_op(struct pkc_request *req)
 	atomic_dec(&c_dev->active_jobs);
 #endif
 	/* Now enqueue the job into the app ring */
-	if (app_ring_enqueue(c_dev, r_id, sec_dma)) {
+	if (app_ring_enqueue_job(c_dev, r_id, sec_dma, crypto_ctx)) {
 		ret = -1;
 		goto error1;
 	}
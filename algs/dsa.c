@@ -43,6 +43,14 @@
 #include "desc.h"
 #include "memmgr.h"
 #include "crypto_ctx.h"
+#include "ring_balance.h"
+#include "ecc_curves.h"
+#ifdef ECDSA_PRESIG
+#include "ecdsa_presig.h"
+#endif
+#ifdef PKC_CACHE
+#include "pkc_cache.h"
+#endif
 #ifdef VIRTIO_C2X0
 #include "fsl_c2x0_virtio.h"
 #endif
@@ -82,6 +90,10 @@ static void ecdsa_op_done(void *ctx, int32_t res)
 	dealloc_crypto_mem(&(crypto_ctx->crypto_mem));
 
 #ifndef VIRTIO_C2X0
+#ifdef PKC_CACHE
+	if (!res && crypto_ctx->req.pkc->base.tfm)
+		pkc_cache_insert(crypto_ctx->req.pkc);
+#endif
 	ecdsa_completion_cb(crypto_ctx->req.pkc, res);
 
 	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
@@ -164,7 +176,15 @@ static int dsa_sign_cp_req(struct dsa_sign_req_s *req,
 			   crypto_mem_info_t *mem_info, bool ecdsa)
 {
 	dsa_sign_buffers_t *mem = &(mem_info->c_buffers.dsa_sign);
+	bool res_curve = false;
+
 	dsa_sign_init_len(req, mem_info, ecdsa);
+	if (ecdsa)
+		res_curve = ecc_curve_res_buffs(mem_info->dev,
+						&mem->q_buff, req->q,
+						&mem->r_buff, req->r,
+						&mem->g_buff, req->g,
+						&mem->ab_buff, req->ab);
 
 	print_debug("Calling alloc_crypto_mem\n");
 	mem_info->buffers = (buffer_info_t *) mem;
@@ -172,29 +192,32 @@ static int dsa_sign_cp_req(struct dsa_sign_req_s *req,
 		return -ENOMEM;
 
 #ifdef USE_HOST_DMA
-	memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
-	memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
-	memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+	if (!res_curve) {
+		memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
+		memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
+		memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+	}
 	memcpy(mem->priv_key_buff.v_mem, req->priv_key, mem->priv_key_buff.len);
 	memcpy(mem->m_buff.v_mem, req->m, mem->m_buff.len);
 
-	if (ecdsa)
-		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
-	else
+	if (!ecdsa)
 		mem->ab_buff.v_mem = NULL;
+	else if (!res_curve)
+		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
 #else
-	mem->q_buff.req_ptr = req->q;
-	mem->r_buff.req_ptr = req->r;
-	mem->g_buff.req_ptr = req->g;
+	if (!res_curve) {
+		mem->q_buff.req_ptr = req->q;
+		mem->r_buff.req_ptr = req->r;
+		mem->g_buff.req_ptr = req->g;
+	}
 	mem->priv_key_buff.req_ptr = req->priv_key;
 	mem->m_buff.req_ptr = req->m;
 	mem->tmp_buff.req_ptr = mem->tmp_buff.v_mem;
 
-	if (ecdsa) {
-		mem->ab_buff.req_ptr = req->ab;
-	} else {
+	if (!ecdsa)
 		mem->ab_buff.req_ptr = NULL;
-	}
+	else if (!res_curve)
+		mem->ab_buff.req_ptr = req->ab;
 #endif
 	mem->c_buff.v_mem = req->c;
 	mem->d_buff.v_mem = req->d;
@@ -206,7 +229,15 @@ static int dsa_verify_cp_req(struct dsa_verify_req_s *req,
 			     crypto_mem_info_t *mem_info, bool ecdsa)
 {
 	dsa_verify_buffers_t *mem = &(mem_info->c_buffers.dsa_verify);
+	bool res_curve = false;
+
 	dsa_verify_init_len(req, mem_info, ecdsa);
+	if (ecdsa)
+		res_curve = ecc_curve_res_buffs(mem_info->dev,
+						&mem->q_buff, req->q,
+						&mem->r_buff, req->r,
+						&mem->g_buff, req->g,
+						&mem->ab_buff, req->ab);
 
 	print_debug("Calling alloc_crypto_mem\n");
 	mem_info->buffers = (buffer_info_t *) mem;
@@ -214,34 +245,37 @@ static int dsa_verify_cp_req(struct dsa_verify_req_s *req,
 		return -ENOMEM;
 
 #ifdef USE_HOST_DMA
-	memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
-	memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
-	memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+	if (!res_curve) {
+		memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
+		memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
+		memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+	}
 	memcpy(mem->pub_key_buff.v_mem, req->pub_key, mem->pub_key_buff.len);
 	memcpy(mem->m_buff.v_mem, req->m, mem->m_buff.len);
 	memcpy(mem->c_buff.v_mem, req->c, mem->c_buff.len);
 	memcpy(mem->d_buff.v_mem, req->d, mem->d_buff.len);
 
-	if (ecdsa)
-		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
-	else
+	if (!ecdsa)
 		mem->ab_buff.v_mem = NULL;
+	else if (!res_curve)
+		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
 
 #else
-	mem->q_buff.req_ptr = req->q;
-	mem->r_buff.req_ptr = req->r;
-	mem->g_buff.req_ptr = req->g;
+	if (!res_curve) {
+		mem->q_buff.req_ptr = req->q;
+		mem->r_buff.req_ptr = req->r;
+		mem->g_buff.req_ptr = req->g;
+	}
 	mem->pub_key_buff.req_ptr = req->pub_key;
 	mem->m_buff.req_ptr = req->m;
 	mem->c_buff.req_ptr = req->c;
 	mem->d_buff.req_ptr = req->d;
 	mem->tmp_buff.req_ptr = mem->tmp_buff.v_mem;
 
-	if (ecdsa) {
-		mem->ab_buff.req_ptr = req->ab;
-	} else {
+	if (!ecdsa)
 		mem->ab_buff.req_ptr = NULL;
-	}
+	else if (!res_curve)
+		mem->ab_buff.req_ptr = req->ab;
 #endif
 	return 0;
 }
@@ -250,32 +284,43 @@ static int dsa_keygen_cp_req(struct dsa_keygen_req_s *req,
 			     crypto_mem_info_t *mem_info, bool ecdsa)
 {
 	dsa_keygen_buffers_t *mem = &(mem_info->c_buffers.dsa_keygen);
+	bool res_curve = false;
 
 	dsa_keygen_init_len(req, mem_info, ecdsa);
+	if (ecdsa)
+		res_curve = ecc_curve_res_buffs(mem_info->dev,
+						&mem->q_buff, req->q,
+						&mem->r_buff, req->r,
+						&mem->g_buff, req->g,
+						&mem->ab_buff, req->ab);
+
 	print_debug("Calling alloc_crypto_mem\n");
 	mem_info->buffers = (buffer_info_t *) mem;
 	if (-ENOMEM == alloc_crypto_mem(mem_info))
 		return -ENOMEM;
 
 #ifdef USE_HOST_DMA
-	memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
-	memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
-	memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+	if (!res_curve) {
+		memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
+		memcpy(mem->r_buff.v_mem, req->r, mem->r_buff.len);
+		memcpy(mem->g_buff.v_mem, req->g, mem->g_buff.len);
+	}
 
-	if (ecdsa)
-		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
-	else
+	if (!ecdsa)
 		mem->ab_buff.v_mem = NULL;
+	else if (!res_curve)
+		memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
 #else
-	mem->q_buff.req_ptr = req->q;
-	mem->r_buff.req_ptr = req->r;
-	mem->g_buff.req_ptr = req->g;
+	if (!res_curve) {
+		mem->q_buff.req_ptr = req->q;
+		mem->r_buff.req_ptr = req->r;
+		mem->g_buff.req_ptr = req->g;
+	}
 
-	if (ecdsa) {
-		mem->ab_buff.req_ptr = req->ab;
-	} else {
+	if (!ecdsa)
 		mem->ab_buff.req_ptr = NULL;
-	}
+	else if (!res_curve)
+		mem->ab_buff.req_ptr = req->ab;
 #endif
 	mem->prvkey_buff.v_mem = req->prvkey;
 	mem->pubkey_buff.v_mem = req->pubkey;
@@ -469,12 +514,12 @@ static void constr_ecdsa_sign_desc(crypto_mem_info_t *mem_info, bool ecc_bin)
 		      HDR_ONE);
 
 #ifdef SEC_DMA
-	ASSIGN64(ecdsa_sign_desc->q_dma, (mem->q_buff.dev_buffer.h_p_addr + offset));
-	ASSIGN64(ecdsa_sign_desc->r_dma, (mem->r_buff.dev_buffer.h_p_addr + offset));
-	ASSIGN64(ecdsa_sign_desc->g_dma, (mem->g_buff.dev_buffer.h_p_addr + offset));
+	ASSIGN64(ecdsa_sign_desc->q_dma, sec_dma_ip_addr(&mem->q_buff, offset));
+	ASSIGN64(ecdsa_sign_desc->r_dma, sec_dma_ip_addr(&mem->r_buff, offset));
+	ASSIGN64(ecdsa_sign_desc->g_dma, sec_dma_ip_addr(&mem->g_buff, offset));
 	ASSIGN64(ecdsa_sign_desc->s_dma, (mem->priv_key_buff.dev_buffer.h_p_addr + offset));
 	ASSIGN64(ecdsa_sign_desc->f_dma, (mem->m_buff.dev_buffer.h_p_addr + offset));
-	ASSIGN64(ecdsa_sign_desc->ab_dma, (mem->ab_buff.dev_buffer.h_p_addr + offset));
+	ASSIGN64(ecdsa_sign_desc->ab_dma, sec_dma_ip_addr(&mem->ab_buff, offset));
 #else
 	ASSIGN64(ecdsa_sign_desc->q_dma, mem->q_buff.dev_buffer.d_p_addr);
 	ASSIGN64(ecdsa_sign_desc->r_dma, mem->r_buff.dev_buffer.d_p_addr);
@@ -546,12 +591,12 @@ static void constr_ecdsa_verify_desc(crypto_mem_info_t *mem_info, bool ecc_bin)
 		      HDR_ONE);
 
 #ifdef SEC_DMA
-	ASSIGN64(ecdsa_verify_desc->q_dma, (mem->q_buff.dev_buffer.h_p_addr + offset));
-	ASSIGN64(ecdsa_verify_desc->r_dma, (mem->r_buff.dev_buffer.h_p_addr + offset));
-	ASSIGN64(ecdsa_verify_desc->g_dma, (mem->g_buff.dev_buffer.h_p_addr + offset));
+	ASSIGN64(ecdsa_verify_desc->q_dma, sec_dma_ip_addr(&mem->q_buff, offset));
+	ASSIGN64(ecdsa_verify_desc->r_dma, sec_dma_ip_addr(&mem->r_buff, offset));
+	ASSIGN64(ecdsa_verify_desc->g_dma, sec_dma_ip_addr(&mem->g_buff, offset));
 	ASSIGN64(ecdsa_verify_desc->w_dma, (mem->pub_key_buff.dev_buffer.h_p_addr + offset));
 	ASSIGN64(ecdsa_verify_desc->f_dma, (mem->m_buff.dev_buffer.h_p_addr + offset));
-	ASSIGN64(ecdsa_verify_desc->ab_dma, (mem->ab_buff.dev_buffer.h_p_addr + offset));
+	ASSIGN64(ecdsa_verify_desc->ab_dma, sec_dma_ip_addr(&mem->ab_buff, offset));
 	ASSIGN64(ecdsa_verify_desc->c_dma, (mem->c_buff.dev_buffer.h_p_addr + offset));
 	ASSIGN64(ecdsa_verify_desc->d_dma, (mem->d_buff.dev_buffer.h_p_addr + offset));
 #else
@@ -614,10 +659,10 @@ static void constr_ecdsa_keygen_desc(crypto_mem_info_t *mem_info, bool ecc_bin)
 		      (desc_size & HDR_DESCLEN_MASK) | HDR_ONE);
 
 #ifdef SEC_DMA
-        ASSIGN64(ecdsa_keygen_desc->q_dma, (mem->q_buff.dev_buffer.h_p_addr + offset));
-        ASSIGN64(ecdsa_keygen_desc->r_dma, (mem->r_buff.dev_buffer.h_p_addr + offset));
-        ASSIGN64(ecdsa_keygen_desc->ab_dma, (mem->ab_buff.dev_buffer.h_p_addr + offset));
-        ASSIGN64(ecdsa_keygen_desc->g_dma, (mem->g_buff.dev_buffer.h_p_addr + offset));
+        ASSIGN64(ecdsa_keygen_desc->q_dma, sec_dma_ip_addr(&mem->q_buff, offset));
+        ASSIGN64(ecdsa_keygen_desc->r_dma, sec_dma_ip_addr(&mem->r_buff, offset));
+        ASSIGN64(ecdsa_keygen_desc->ab_dma, sec_dma_ip_addr(&mem->ab_buff, offset));
+        ASSIGN64(ecdsa_keygen_desc->g_dma, sec_dma_ip_addr(&mem->g_buff, offset));
 #else
 	ASSIGN64(ecdsa_keygen_desc->q_dma, mem->q_buff.dev_buffer.d_p_addr);
 	ASSIGN64(ecdsa_keygen_desc->r_dma, mem->r_buff.dev_buffer.d_p_addr);
@@ -719,6 +764,118 @@ static void dsa_keygen_init_crypto_mem(crypto_mem_info_t *crypto_mem,
 	dsa_keygen_buffs->pubkey_buff.bt = BT_OP;
 }
 
+#ifdef ECDSA_PRESIG
+/* Completion of driver internal requests, which carry no tfm */
+static void ecdsa_int_op_done(void *ctx, int32_t res)
+{
+	crypto_op_ctx_t *crypto_ctx = ctx;
+
+	dealloc_crypto_mem(&(crypto_ctx->crypto_mem));
+	pkc_request_complete(crypto_ctx->req.pkc, res);
+	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
+}
+
+/*******************************************************************************
+ * Function     : ecdsa_int_keygen
+ *
+ * Arguments    : c_dev - device to run the job on
+ *		  r_id  - app ring to post the job to
+ *		  req   - ECDSA_KEYGEN request, completed through
+ *			  req->base.complete
+ *
+ * Return Value : -EINPROGRESS if the job is posted, error code otherwise
+ *
+ * Description  : Posts a key generation job on behalf of the driver itself,
+ *		  on a ring chosen by the caller.
+ *
+ ******************************************************************************/
+int ecdsa_int_keygen(fsl_crypto_dev_t *c_dev, uint32_t r_id,
+		     struct pkc_request *req)
+{
+	crypto_op_ctx_t *crypto_ctx = NULL;
+	dsa_keygen_buffers_t *dsa_keygen_buffs = NULL;
+	dev_dma_addr_t sec_dma = 0;
+	int32_t ret = -EINPROGRESS;
+#ifdef SEC_DMA
+	dev_p_addr_t offset = c_dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr;
+#endif
+
+#ifndef HIGH_PERF
+	atomic_inc(&c_dev->active_jobs);
+#endif
+	crypto_ctx = get_crypto_ctx(c_dev->ctx_pool);
+	if (unlikely(!crypto_ctx)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	crypto_ctx->ctx_pool = c_dev->ctx_pool;
+	crypto_ctx->crypto_mem.dev = c_dev;
+	crypto_ctx->crypto_mem.pool = c_dev->ring_pairs[r_id].ip_pool;
+
+	dsa_keygen_init_crypto_mem(&crypto_ctx->crypto_mem, true);
+	if (-ENOMEM == dsa_keygen_cp_req(&req->req_u.dsa_keygen,
+					 &crypto_ctx->crypto_mem, true)) {
+		free_crypto_ctx(c_dev->ctx_pool, crypto_ctx);
+		ret = -ENOMEM;
+		goto out;
+	}
+	host_to_dev(&crypto_ctx->crypto_mem);
+#ifdef SEC_DMA
+	map_crypto_mem(&(crypto_ctx->crypto_mem));
+#endif
+	constr_ecdsa_keygen_desc(&crypto_ctx->crypto_mem,
+				 ECC_BINARY == req->curve_type);
+
+	dsa_keygen_buffs = &(crypto_ctx->crypto_mem.c_buffers.dsa_keygen);
+#ifdef SEC_DMA
+	sec_dma = dsa_keygen_buffs->desc_buff.dev_buffer.h_p_addr + offset;
+#else
+	sec_dma = dsa_keygen_buffs->desc_buff.dev_buffer.d_p_addr;
+#endif
+	store_priv_data(dsa_keygen_buffs->desc_buff.v_mem,
+			(unsigned long)crypto_ctx);
+
+#ifndef SEC_DMA
+#ifndef USE_HOST_DMA
+	memcpy_to_dev(&crypto_ctx->crypto_mem);
+#endif
+#endif
+	crypto_ctx->req.pkc = req;
+	crypto_ctx->oprn = DSA;
+	crypto_ctx->rid = r_id;
+	crypto_ctx->desc = sec_dma;
+	crypto_ctx->c_dev = c_dev;
+	crypto_ctx->op_done = ecdsa_int_op_done;
+
+#ifdef USE_HOST_DMA
+	crypto_ctx->crypto_mem.dest_buff_dma =
+	    crypto_ctx->crypto_mem.buffers[BT_DESC].dev_buffer.h_map_p_addr;
+	if (-1 == dma_to_dev(get_dma_chnl(), &crypto_ctx->crypto_mem,
+			     dma_tx_complete_cb, crypto_ctx)) {
+		ret = -1;
+		goto out_free;
+	}
+#else
+	sec_dma = set_sec_affinity(c_dev, r_id, sec_dma);
+	if (app_ring_enqueue(c_dev, r_id, sec_dma)) {
+		ret = -1;
+		goto out_free;
+	}
+#endif
+	goto out;
+
+out_free:
+	dealloc_crypto_mem(&crypto_ctx->crypto_mem);
+	free_crypto_ctx(c_dev->ctx_pool, crypto_ctx);
+out:
+#ifndef HIGH_PERF
+	atomic_dec(&c_dev->active_jobs);
+#endif
+	return ret;
+}
+#endif /* ECDSA_PRESIG */
+
 #ifdef VIRTIO_C2X0
 int dsa_op(struct pkc_request *req, struct virtio_c2x0_job_ctx *virtio_job)
 #else
@@ -728,6 +885,7 @@ int dsa_op(struct pkc_request *req)
 	int32_t ret = 0;
 	crypto_op_ctx_t *crypto_ctx = NULL;
 	fsl_crypto_dev_t *c_dev = NULL;
+	crypto_dev_sess_t *c_sess = NULL;
 	dev_dma_addr_t sec_dma = 0;
 	uint32_t r_id = 0;
 	dsa_sign_buffers_t *dsa_sign_buffs = NULL;
@@ -742,43 +900,40 @@ int dsa_op(struct pkc_request *req)
 
 #ifndef VIRTIO_C2X0
 	if (NULL != req->base.tfm) {
-		crypto_dev_sess_t *c_sess;
-		dsa_completion_cb = pkc_request_complete;
-		ecdsa_completion_cb = pkc_request_complete;
+		dsa_completion_cb = crypto_dev_sess_complete;
+		ecdsa_completion_cb = crypto_dev_sess_complete;
+#ifdef PKC_CACHE
+		/* Same signature verified recently, no job needed */
+		if ((ECDSA_VERIFY == req->type) && !pkc_cache_lookup(req))
+			return crypto_dev_sess_answer(req, 0);
+#endif
 		/* Get the session context from input request */
 		c_sess = crypto_pkc_ctx(crypto_pkc_reqtfm(req));
-		c_dev = c_sess->c_dev;
-		r_id = c_sess->r_id;
+		r_id = crypto_dev_sess_ring(c_sess, &c_dev);
 #ifndef HIGH_PERF
 		if (-1 == check_device(c_dev))
 			return -1;
+#endif
+#ifdef ECDSA_PRESIG
+		/* Signed on the host from a precomputed (k^-1, r) pair */
+		if ((ECDSA_SIGN == req->type) &&
+		    (req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP) &&
+		    !ecdsa_presig_sign(c_dev, req)) {
+#ifndef HIGH_PERF
+			atomic_dec(&c_dev->active_jobs);
+#endif
+			return crypto_dev_sess_answer(req, 0);
+		}
 #endif
 	}
 	else
 #endif
 	{
-		/* By default using first device --
-		 * Logic here will be replaced with LB */
-#ifdef VIRTIO_C2X0
-		if(NULL == (c_dev = get_device_rr()))
-			return -1;
-#else
-		c_dev = get_crypto_dev(1);
-		if (!c_dev) {
-			print_error("Could not retrieve the device structure.\n");
-			return -1;
-		}
-
-#endif
-#ifndef HIGH_PERF	
-		if(0 == (r_id = get_ring_rr(c_dev)))
+		/* Least loaded device and application ring */
+		if (NULL == (c_dev = get_device_ll(&r_id)))
 			return -1;
-
+#ifndef HIGH_PERF
 		atomic_inc(&c_dev->active_jobs);
-#else
-        r_id = atomic_inc_return(&c_dev->crypto_dev_sess_cnt);
-        r_id = 1 + r_id % (c_dev->num_of_rings - 1);
-
 #endif
 	}
 #ifdef SEC_DMA
@@ -935,6 +1090,10 @@ int dsa_op(struct pkc_request *req)
 	crypto_ctx->rid = r_id;
 	crypto_ctx->desc = sec_dma;
 	crypto_ctx->c_dev = c_dev;
+	if (sess_job_start(crypto_ctx, c_sess)) {
+		ret = -1;
+		goto error;
+	}
 
 	if (ecdsa) {
 		crypto_ctx->op_done = ecdsa_op_done;
@@ -966,7 +1125,7 @@ int dsa_op(struct pkc_request *req)
 	atomic_dec(&c_dev->active_jobs);
 #endif
 	/* Now enqueue the job into the app ring */
-	if (app_ring_enqueue(c_dev, r_id, sec_dma)) {
+	if (app_ring_enqueue_job(c_dev, r_id, sec_dma, crypto_ctx)) {
 		ret = -1;
 		goto error1;
 	}
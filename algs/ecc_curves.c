@@ -0,0 +1,540 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <linux/crypto.h>
+
+#include "common.h"
+#include "fsl_c2x0_crypto_layer.h"
+#include "fsl_c2x0_driver.h"
+#include "desc_buffs.h"
+#include "memmgr.h"
+#include "ecc_curves.h"
+
+/* Parameters are stored in the SEC layout used by the ECDSA/ECDH
+ * descriptors, i.e. the same byte strings the callers pass in q/r/g/ab. */
+static const uint8_t p256_q[] = {
+	0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff
+};
+
+static const uint8_t p256_r[] = {
+	0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xbc, 0xe6, 0xfa, 0xad,
+	0xa7, 0x17, 0x9e, 0x84, 0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63,
+	0x25, 0x51
+};
+
+static const uint8_t p256_g[] = {
+	0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42, 0x47, 0xf8, 0xbc,
+	0xe6, 0xe5, 0x63, 0xa4, 0x40, 0xf2, 0x77, 0x03, 0x7d, 0x81,
+	0x2d, 0xeb, 0x33, 0xa0, 0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98,
+	0xc2, 0x96, 0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f, 0x9b,
+	0x8e, 0xe7, 0xeb, 0x4a, 0x7c, 0x0f, 0x9e, 0x16, 0x2b, 0xce,
+	0x33, 0x57, 0x6b, 0x31, 0x5e, 0xce, 0xcb, 0xb6, 0x40, 0x68,
+	0x37, 0xbf, 0x51, 0xf5
+};
+
+static const uint8_t p256_ab[] = {
+	0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xfc, 0x5a, 0xc6, 0x35, 0xd8, 0xaa, 0x3a, 0x93, 0xe7,
+	0xb3, 0xeb, 0xbd, 0x55, 0x76, 0x98, 0x86, 0xbc, 0x65, 0x1d,
+	0x06, 0xb0, 0xcc, 0x53, 0xb0, 0xf6, 0x3b, 0xce, 0x3c, 0x3e,
+	0x27, 0xd2, 0x60, 0x4b
+};
+
+static const uint8_t p384_q[] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xfe, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff
+};
+
+static const uint8_t p384_r[] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xc7, 0x63, 0x4d, 0x81, 0xf4, 0x37,
+	0x2d, 0xdf, 0x58, 0x1a, 0x0d, 0xb2, 0x48, 0xb0, 0xa7, 0x7a,
+	0xec, 0xec, 0x19, 0x6a, 0xcc, 0xc5, 0x29, 0x73
+};
+
+static const uint8_t p384_g[] = {
+	0xaa, 0x87, 0xca, 0x22, 0xbe, 0x8b, 0x05, 0x37, 0x8e, 0xb1,
+	0xc7, 0x1e, 0xf3, 0x20, 0xad, 0x74, 0x6e, 0x1d, 0x3b, 0x62,
+	0x8b, 0xa7, 0x9b, 0x98, 0x59, 0xf7, 0x41, 0xe0, 0x82, 0x54,
+	0x2a, 0x38, 0x55, 0x02, 0xf2, 0x5d, 0xbf, 0x55, 0x29, 0x6c,
+	0x3a, 0x54, 0x5e, 0x38, 0x72, 0x76, 0x0a, 0xb7, 0x36, 0x17,
+	0xde, 0x4a, 0x96, 0x26, 0x2c, 0x6f, 0x5d, 0x9e, 0x98, 0xbf,
+	0x92, 0x92, 0xdc, 0x29, 0xf8, 0xf4, 0x1d, 0xbd, 0x28, 0x9a,
+	0x14, 0x7c, 0xe9, 0xda, 0x31, 0x13, 0xb5, 0xf0, 0xb8, 0xc0,
+	0x0a, 0x60, 0xb1, 0xce, 0x1d, 0x7e, 0x81, 0x9d, 0x7a, 0x43,
+	0x1d, 0x7c, 0x90, 0xea, 0x0e, 0x5f
+};
+
+static const uint8_t p384_ab[] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xfe, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xfc, 0xb3, 0x31,
+	0x2f, 0xa7, 0xe2, 0x3e, 0xe7, 0xe4, 0x98, 0x8e, 0x05, 0x6b,
+	0xe3, 0xf8, 0x2d, 0x19, 0x18, 0x1d, 0x9c, 0x6e, 0xfe, 0x81,
+	0x41, 0x12, 0x03, 0x14, 0x08, 0x8f, 0x50, 0x13, 0x87, 0x5a,
+	0xc6, 0x56, 0x39, 0x8d, 0x8a, 0x2e, 0xd1, 0x9d, 0x2a, 0x85,
+	0xc8, 0xed, 0xd3, 0xec, 0x2a, 0xef
+};
+
+static const uint8_t p521_q[] = {
+	0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static const uint8_t p521_r[] = {
+	0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xfa, 0x51, 0x86, 0x87, 0x83, 0xbf, 0x2f,
+	0x96, 0x6b, 0x7f, 0xcc, 0x01, 0x48, 0xf7, 0x09, 0xa5, 0xd0,
+	0x3b, 0xb5, 0xc9, 0xb8, 0x89, 0x9c, 0x47, 0xae, 0xbb, 0x6f,
+	0xb7, 0x1e, 0x91, 0x38, 0x64, 0x09
+};
+
+static const uint8_t p521_g[] = {
+	0x00, 0xc6, 0x85, 0x8e, 0x06, 0xb7, 0x04, 0x04, 0xe9, 0xcd,
+	0x9e, 0x3e, 0xcb, 0x66, 0x23, 0x95, 0xb4, 0x42, 0x9c, 0x64,
+	0x81, 0x39, 0x05, 0x3f, 0xb5, 0x21, 0xf8, 0x28, 0xaf, 0x60,
+	0x6b, 0x4d, 0x3d, 0xba, 0xa1, 0x4b, 0x5e, 0x77, 0xef, 0xe7,
+	0x59, 0x28, 0xfe, 0x1d, 0xc1, 0x27, 0xa2, 0xff, 0xa8, 0xde,
+	0x33, 0x48, 0xb3, 0xc1, 0x85, 0x6a, 0x42, 0x9b, 0xf9, 0x7e,
+	0x7e, 0x31, 0xc2, 0xe5, 0xbd, 0x66, 0x01, 0x18, 0x39, 0x29,
+	0x6a, 0x78, 0x9a, 0x3b, 0xc0, 0x04, 0x5c, 0x8a, 0x5f, 0xb4,
+	0x2c, 0x7d, 0x1b, 0xd9, 0x98, 0xf5, 0x44, 0x49, 0x57, 0x9b,
+	0x44, 0x68, 0x17, 0xaf, 0xbd, 0x17, 0x27, 0x3e, 0x66, 0x2c,
+	0x97, 0xee, 0x72, 0x99, 0x5e, 0xf4, 0x26, 0x40, 0xc5, 0x50,
+	0xb9, 0x01, 0x3f, 0xad, 0x07, 0x61, 0x35, 0x3c, 0x70, 0x86,
+	0xa2, 0x72, 0xc2, 0x40, 0x88, 0xbe, 0x94, 0x76, 0x9f, 0xd1,
+	0x66, 0x50
+};
+
+static const uint8_t p521_ab[] = {
+	0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x00, 0x51, 0x95, 0x3e,
+	0xb9, 0x61, 0x8e, 0x1c, 0x9a, 0x1f, 0x92, 0x9a, 0x21, 0xa0,
+	0xb6, 0x85, 0x40, 0xee, 0xa2, 0xda, 0x72, 0x5b, 0x99, 0xb3,
+	0x15, 0xf3, 0xb8, 0xb4, 0x89, 0x91, 0x8e, 0xf1, 0x09, 0xe1,
+	0x56, 0x19, 0x39, 0x51, 0xec, 0x7e, 0x93, 0x7b, 0x16, 0x52,
+	0xc0, 0xbd, 0x3b, 0xb1, 0xbf, 0x07, 0x35, 0x73, 0xdf, 0x88,
+	0x3d, 0x2c, 0x34, 0xf1, 0xef, 0x45, 0x1f, 0xd4, 0x6b, 0x50,
+	0x3f, 0x00
+};
+
+static const uint8_t b283_q[] = {
+	0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x10, 0xa1
+};
+
+static const uint8_t b283_r[] = {
+	0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0x90,
+	0x39, 0x96, 0x60, 0xfc, 0x93, 0x8a, 0x90, 0x16, 0x5b, 0x04,
+	0x2a, 0x7c, 0xef, 0xad, 0xb3, 0x07
+};
+
+static const uint8_t b283_g[] = {
+	0x05, 0xf9, 0x39, 0x25, 0x8d, 0xb7, 0xdd, 0x90, 0xe1, 0x93,
+	0x4f, 0x8c, 0x70, 0xb0, 0xdf, 0xec, 0x2e, 0xed, 0x25, 0xb8,
+	0x55, 0x7e, 0xac, 0x9c, 0x80, 0xe2, 0xe1, 0x98, 0xf8, 0xcd,
+	0xbe, 0xcd, 0x86, 0xb1, 0x20, 0x53, 0x03, 0x67, 0x68, 0x54,
+	0xfe, 0x24, 0x14, 0x1c, 0xb9, 0x8f, 0xe6, 0xd4, 0xb2, 0x0d,
+	0x02, 0xb4, 0x51, 0x6f, 0xf7, 0x02, 0x35, 0x0e, 0xdd, 0xb0,
+	0x82, 0x67, 0x79, 0xc8, 0x13, 0xf0, 0xdf, 0x45, 0xbe, 0x81,
+	0x12, 0xf4
+};
+
+static const uint8_t b283_ab[] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x03, 0xd8, 0xc9, 0x3d,
+	0x3b, 0x0e, 0xa8, 0x1d, 0x92, 0x94, 0x03, 0x4d, 0x7e, 0xe3,
+	0x13, 0x5d, 0x0a, 0xc5, 0xfc, 0x8d, 0x9c, 0xb0, 0x27, 0x6f,
+	0x72, 0x11, 0xf8, 0x80, 0xf0, 0xd8, 0x1c, 0xa4, 0xc6, 0xe8,
+	0x7b, 0x38
+};
+
+static const uint8_t b409_q[] = {
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x01
+};
+
+static const uint8_t b409_r[] = {
+	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0xe2, 0xaa, 0xd6,
+	0xa6, 0x12, 0xf3, 0x33, 0x07, 0xbe, 0x5f, 0xa4, 0x7c, 0x3c,
+	0x9e, 0x05, 0x2f, 0x83, 0x81, 0x64, 0xcd, 0x37, 0xd9, 0xa2,
+	0x11, 0x73
+};
+
+static const uint8_t b409_g[] = {
+	0x01, 0x5d, 0x48, 0x60, 0xd0, 0x88, 0xdd, 0xb3, 0x49, 0x6b,
+	0x0c, 0x60, 0x64, 0x75, 0x62, 0x60, 0x44, 0x1c, 0xde, 0x4a,
+	0xf1, 0x77, 0x1d, 0x4d, 0xb0, 0x1f, 0xfe, 0x5b, 0x34, 0xe5,
+	0x97, 0x03, 0xdc, 0x25, 0x5a, 0x86, 0x8a, 0x11, 0x80, 0x51,
+	0x56, 0x03, 0xae, 0xab, 0x60, 0x79, 0x4e, 0x54, 0xbb, 0x79,
+	0x96, 0xa7, 0x00, 0x61, 0xb1, 0xcf, 0xab, 0x6b, 0xe5, 0xf3,
+	0x2b, 0xbf, 0xa7, 0x83, 0x24, 0xed, 0x10, 0x6a, 0x76, 0x36,
+	0xb9, 0xc5, 0xa7, 0xbd, 0x19, 0x8d, 0x01, 0x58, 0xaa, 0x4f,
+	0x54, 0x88, 0xd0, 0x8f, 0x38, 0x51, 0x4f, 0x1f, 0xdf, 0x4b,
+	0x4f, 0x40, 0xd2, 0x18, 0x1b, 0x36, 0x81, 0xc3, 0x64, 0xba,
+	0x02, 0x73, 0xc7, 0x06
+};
+
+static const uint8_t b409_ab[] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x01, 0x01, 0x49, 0xb8, 0xb7, 0xbe, 0xbd, 0x9b, 0x63,
+	0x65, 0x3e, 0xf1, 0xcd, 0x8c, 0x6a, 0x5d, 0xd1, 0x05, 0xa2,
+	0xaa, 0xac, 0x36, 0xfe, 0x2e, 0xae, 0x43, 0xcf, 0x28, 0xce,
+	0x1c, 0xb7, 0xc8, 0x30, 0xc1, 0xec, 0xdb, 0xfa, 0x41, 0x3a,
+	0xb0, 0x7f, 0xe3, 0x5a, 0x57, 0x81, 0x1a, 0xe4, 0xf8, 0x8d,
+	0x30, 0xac, 0x63, 0xfb
+};
+
+static const uint8_t b571_q[] = {
+	0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x04, 0x25
+};
+
+static const uint8_t b571_r[] = {
+	0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xe6, 0x61, 0xce, 0x18,
+	0xff, 0x55, 0x98, 0x73, 0x08, 0x05, 0x9b, 0x18, 0x68, 0x23,
+	0x85, 0x1e, 0xc7, 0xdd, 0x9c, 0xa1, 0x16, 0x1d, 0xe9, 0x3d,
+	0x51, 0x74, 0xd6, 0x6e, 0x83, 0x82, 0xe9, 0xbb, 0x2f, 0xe8,
+	0x4e, 0x47
+};
+
+static const uint8_t b571_g[] = {
+	0x03, 0x03, 0x00, 0x1d, 0x34, 0xb8, 0x56, 0x29, 0x6c, 0x16,
+	0xc0, 0xd4, 0x0d, 0x3c, 0xd7, 0x75, 0x0a, 0x93, 0xd1, 0xd2,
+	0x95, 0x5f, 0xa8, 0x0a, 0xa5, 0xf4, 0x0f, 0xc8, 0xdb, 0x7b,
+	0x2a, 0xbd, 0xbd, 0xe5, 0x39, 0x50, 0xf4, 0xc0, 0xd2, 0x93,
+	0xcd, 0xd7, 0x11, 0xa3, 0x5b, 0x67, 0xfb, 0x14, 0x99, 0xae,
+	0x60, 0x03, 0x86, 0x14, 0xf1, 0x39, 0x4a, 0xbf, 0xa3, 0xb4,
+	0xc8, 0x50, 0xd9, 0x27, 0xe1, 0xe7, 0x76, 0x9c, 0x8e, 0xec,
+	0x2d, 0x19, 0x03, 0x7b, 0xf2, 0x73, 0x42, 0xda, 0x63, 0x9b,
+	0x6d, 0xcc, 0xff, 0xfe, 0xb7, 0x3d, 0x69, 0xd7, 0x8c, 0x6c,
+	0x27, 0xa6, 0x00, 0x9c, 0xbb, 0xca, 0x19, 0x80, 0xf8, 0x53,
+	0x39, 0x21, 0xe8, 0xa6, 0x84, 0x42, 0x3e, 0x43, 0xba, 0xb0,
+	0x8a, 0x57, 0x62, 0x91, 0xaf, 0x8f, 0x46, 0x1b, 0xb2, 0xa8,
+	0xb3, 0x53, 0x1d, 0x2f, 0x04, 0x85, 0xc1, 0x9b, 0x16, 0xe2,
+	0xf1, 0x51, 0x6e, 0x23, 0xdd, 0x3c, 0x1a, 0x48, 0x27, 0xaf,
+	0x1b, 0x8a, 0xc1, 0x5b
+};
+
+static const uint8_t b571_ab[] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x01, 0x06, 0x39, 0x5d, 0xb2, 0x2a, 0xb5, 0x94, 0xb1,
+	0x86, 0x8c, 0xed, 0x95, 0x25, 0x78, 0xb6, 0x53, 0x9f, 0xab,
+	0xa6, 0x94, 0x06, 0xd9, 0xb2, 0x98, 0x61, 0x23, 0xa1, 0x85,
+	0xc8, 0x58, 0x32, 0xe2, 0x5f, 0xd5, 0xb6, 0x38, 0x33, 0xd5,
+	0x14, 0x42, 0xab, 0xf1, 0xa9, 0xc0, 0x5f, 0xf0, 0xec, 0xbd,
+	0x88, 0xd7, 0xf7, 0x79, 0x97, 0xf4, 0xdc, 0x91, 0x56, 0xaa,
+	0xf1, 0xce, 0x08, 0x16, 0x46, 0x86, 0xdd, 0xff, 0x75, 0x11,
+	0x6f, 0xbc, 0x9a, 0x7a
+};
+
+#define ECC_CURVE(_name, _type, _pfx)			\
+	{						\
+		.name = _name,				\
+		.type = _type,				\
+		.q = _pfx##_q,				\
+		.r = _pfx##_r,				\
+		.g = _pfx##_g,				\
+		.ab = _pfx##_ab,			\
+		.q_len = sizeof(_pfx##_q),		\
+		.r_len = sizeof(_pfx##_r),		\
+		.g_len = sizeof(_pfx##_g),		\
+		.ab_len = sizeof(_pfx##_ab),		\
+	}
+
+static const ecc_curve_t ecc_curves[ECC_CURVE_MAX] = {
+	[ECC_CURVE_P256] = ECC_CURVE("P-256", ECC_PRIME, p256),
+	[ECC_CURVE_P384] = ECC_CURVE("P-384", ECC_PRIME, p384),
+	[ECC_CURVE_P521] = ECC_CURVE("P-521", ECC_PRIME, p521),
+	[ECC_CURVE_B283] = ECC_CURVE("B-283", ECC_BINARY, b283),
+	[ECC_CURVE_B409] = ECC_CURVE("B-409", ECC_BINARY, b409),
+	[ECC_CURVE_B571] = ECC_CURVE("B-571", ECC_BINARY, b571),
+};
+
+static uint32_t ecc_curve_len(const ecc_curve_t *curve)
+{
+	return ALIGN_LEN_TO_DMA(curve->q_len) + ALIGN_LEN_TO_DMA(curve->r_len) +
+	    ALIGN_LEN_TO_DMA(curve->g_len) + ALIGN_LEN_TO_DMA(curve->ab_len);
+}
+
+static uint8_t *ecc_curve_cp(uint8_t **mem, const uint8_t *src, uint32_t len)
+{
+	uint8_t *dst = *mem;
+
+	memcpy(dst, src, len);
+	*mem += ALIGN_LEN_TO_DMA(len);
+
+	return dst;
+}
+
+/*******************************************************************************
+ * Function     : load_ecc_curves
+ *
+ * Arguments    : c_dev - crypto device
+ *
+ * Return Value : 0 on success, -ENOMEM otherwise
+ *
+ * Description  : Reserves one block of the device input pool for the named
+ *                curves and copies their parameters into it and into the
+ *                firmware view of the pool. Has to be called after the
+ *                handshake, once the firmware pool address is known.
+ *
+ ******************************************************************************/
+int32_t load_ecc_curves(fsl_crypto_dev_t *c_dev)
+{
+	ecc_curve_res_t *res;
+	uint8_t *blk, *mem;
+	void *d_v_addr;
+	uint32_t len = 0;
+	uint32_t i;
+
+	for (i = 0; i < ECC_CURVE_MAX; i++)
+		len += ecc_curve_len(&ecc_curves[i]);
+
+	res = kzalloc(sizeof(ecc_curve_res_t) * ECC_CURVE_MAX, GFP_KERNEL);
+	if (!res) {
+		print_error("Mem alloc failed for curve registry\n");
+		return -ENOMEM;
+	}
+
+	blk = alloc_buffer(c_dev->ip_pool.drv_map_pool.pool, len, 1);
+	if (!blk) {
+		print_error("No input pool memory for curve registry\n");
+		kfree(res);
+		return -ENOMEM;
+	}
+
+	mem = blk;
+	for (i = 0; i < ECC_CURVE_MAX; i++) {
+		res[i].curve = &ecc_curves[i];
+		res[i].q = ecc_curve_cp(&mem, ecc_curves[i].q, ecc_curves[i].q_len);
+		res[i].r = ecc_curve_cp(&mem, ecc_curves[i].r, ecc_curves[i].r_len);
+		res[i].g = ecc_curve_cp(&mem, ecc_curves[i].g, ecc_curves[i].g_len);
+		res[i].ab = ecc_curve_cp(&mem, ecc_curves[i].ab, ecc_curves[i].ab_len);
+	}
+
+	/* The firmware pool mirrors the driver pool at the same offsets */
+	d_v_addr = c_dev->ip_pool.fw_pool.host_map_v_addr +
+	    (blk - (uint8_t *)c_dev->ip_pool.drv_map_pool.v_addr);
+	memcpy(d_v_addr, blk, len);
+
+	c_dev->ecc_curves = res;
+	print_debug("Loaded %d curves, %d bytes at %p\n", ECC_CURVE_MAX, len,
+		    blk);
+
+	return 0;
+}
+
+/*******************************************************************************
+ * Function     : cleanup_ecc_curves
+ *
+ * Arguments    : c_dev - crypto device
+ *
+ * Return Value : -
+ *
+ * Description  : Forgets the resident curves. The pool block itself goes away
+ *                with the input pool.
+ *
+ ******************************************************************************/
+void cleanup_ecc_curves(fsl_crypto_dev_t *c_dev)
+{
+	kfree(c_dev->ecc_curves);
+	c_dev->ecc_curves = NULL;
+}
+
+/*******************************************************************************
+ * Function     : ecc_curve_get
+ *
+ * Arguments    : id - named curve
+ *
+ * Return Value : Host copy of the curve parameters, NULL for an unknown id
+ *
+ * Description  : Gives the parameters of a named curve, for the users which
+ *                need them without a device: the presignature pool and the
+ *                kernel crypto API templates.
+ *
+ ******************************************************************************/
+const ecc_curve_t *ecc_curve_get(ecc_curve_id_t id)
+{
+	return (id < ECC_CURVE_MAX) ? &ecc_curves[id] : NULL;
+}
+
+/*******************************************************************************
+ * Function     : ecc_curve_lookup
+ *
+ * Arguments    : c_dev - crypto device
+ *                q, r, g, ab - domain parameters of the request; r and g may
+ *                be NULL for operations which do not use them
+ *
+ * Return Value : Resident copy of the curve or NULL
+ *
+ * Description  : Finds the named curve matching the request parameters.
+ *
+ ******************************************************************************/
+ecc_curve_res_t *ecc_curve_lookup(fsl_crypto_dev_t *c_dev,
+				  uint8_t *q, uint32_t q_len,
+				  uint8_t *r, uint32_t r_len,
+				  uint8_t *g, uint32_t g_len,
+				  uint8_t *ab, uint32_t ab_len)
+{
+	ecc_curve_res_t *res = c_dev->ecc_curves;
+	const ecc_curve_t *curve;
+	uint32_t i;
+
+	if (!res || !q || !ab)
+		return NULL;
+
+	for (i = 0; i < ECC_CURVE_MAX; i++) {
+		curve = res[i].curve;
+
+		if (q_len != curve->q_len || ab_len != curve->ab_len)
+			continue;
+		if (memcmp(q, curve->q, q_len) || memcmp(ab, curve->ab, ab_len))
+			continue;
+
+		/* Same field and coefficients but custom order/generator */
+		if (r && (r_len != curve->r_len || memcmp(r, curve->r, r_len)))
+			return NULL;
+		if (g && (g_len != curve->g_len || memcmp(g, curve->g, g_len)))
+			return NULL;
+
+		return &res[i];
+	}
+
+	return NULL;
+}
+
+static void ecc_curve_res_buff(buffer_info_t *buff, uint8_t *res_mem)
+{
+	buff->bt = BT_RES;
+	buff->v_mem = res_mem;
+	buff->req_ptr = res_mem;
+}
+
+/*******************************************************************************
+ * Function     : ecc_curve_res_buffs
+ *
+ * Arguments    : c_dev - crypto device
+ *                *_buff - request buffers, lengths already set
+ *                q, r, g, ab - request parameters; r_buff/g_buff may be NULL
+ *                for operations which do not use them
+ *
+ * Return Value : true if the buffers now refer to a resident curve
+ *
+ * Description  : Looks the request curve up in the registry and, on a hit,
+ *                turns the parameter buffers into BT_RES buffers so that
+ *                nothing is allocated or copied for them.
+ *
+ ******************************************************************************/
+bool ecc_curve_res_buffs(fsl_crypto_dev_t *c_dev,
+			 buffer_info_t *q_buff, uint8_t *q,
+			 buffer_info_t *r_buff, uint8_t *r,
+			 buffer_info_t *g_buff, uint8_t *g,
+			 buffer_info_t *ab_buff, uint8_t *ab)
+{
+	ecc_curve_res_t *res;
+
+	res = ecc_curve_lookup(c_dev, q, q_buff->len,
+			       r_buff ? r : NULL, r_buff ? r_buff->len : 0,
+			       g_buff ? g : NULL, g_buff ? g_buff->len : 0,
+			       ab, ab_buff->len);
+	if (!res)
+		return false;
+
+	print_debug("Using resident curve %s\n", res->curve->name);
+
+	ecc_curve_res_buff(q_buff, res->q);
+	ecc_curve_res_buff(ab_buff, res->ab);
+	if (r_buff)
+		ecc_curve_res_buff(r_buff, res->r);
+	if (g_buff)
+		ecc_curve_res_buff(g_buff, res->g);
+
+	return true;
+}
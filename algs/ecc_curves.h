@@ -0,0 +1,103 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FSL_PKC_ECC_CURVES_H
+#define FSL_PKC_ECC_CURVES_H
+
+/* Named curves kept resident in the device input pool */
+typedef enum ecc_curve_id {
+	ECC_CURVE_P256,
+	ECC_CURVE_P384,
+	ECC_CURVE_P521,
+	ECC_CURVE_B283,
+	ECC_CURVE_B409,
+	ECC_CURVE_B571,
+	ECC_CURVE_MAX
+} ecc_curve_id_t;
+
+/*******************************************************************************
+Description :	Domain parameters of a named curve in the layout SEC expects.
+Fields      :	name	: Curve name
+		type	: ECC_PRIME / ECC_BINARY
+		q	: Prime or irreducible polynomial, length L
+		r	: Order of the base point, length N
+		g	: Base point (x, y), length 2L
+		ab	: Curve coefficients (a, b), length 2L
+*******************************************************************************/
+typedef struct ecc_curve {
+	const char *name;
+	enum curve_t type;
+	const uint8_t *q;
+	const uint8_t *r;
+	const uint8_t *g;
+	const uint8_t *ab;
+	uint32_t q_len;
+	uint32_t r_len;
+	uint32_t g_len;
+	uint32_t ab_len;
+} ecc_curve_t;
+
+/*******************************************************************************
+Description :	Per device copy of a named curve inside the input pool.
+Fields      :	curve	: Curve the copy belongs to
+		q/r/g/ab: Host addresses of the parameters in the input pool.
+			  The same offsets in the firmware pool hold the
+			  device resident copy.
+*******************************************************************************/
+struct ecc_curve_res {
+	const ecc_curve_t *curve;
+	uint8_t *q;
+	uint8_t *r;
+	uint8_t *g;
+	uint8_t *ab;
+};
+
+typedef struct ecc_curve_res ecc_curve_res_t;
+
+const ecc_curve_t *ecc_curve_get(ecc_curve_id_t id);
+int32_t load_ecc_curves(fsl_crypto_dev_t *c_dev);
+void cleanup_ecc_curves(fsl_crypto_dev_t *c_dev);
+ecc_curve_res_t *ecc_curve_lookup(fsl_crypto_dev_t *c_dev,
+				  uint8_t *q, uint32_t q_len,
+				  uint8_t *r, uint32_t r_len,
+				  uint8_t *g, uint32_t g_len,
+				  uint8_t *ab, uint32_t ab_len);
+bool ecc_curve_res_buffs(fsl_crypto_dev_t *c_dev,
+			 buffer_info_t *q_buff, uint8_t *q,
+			 buffer_info_t *r_buff, uint8_t *r,
+			 buffer_info_t *g_buff, uint8_t *g,
+			 buffer_info_t *ab_buff, uint8_t *ab);
+
+#endif
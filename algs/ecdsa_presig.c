@@ -0,0 +1,708 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <linux/crypto.h>
+#include <linux/mpi.h>
+#include <linux/random.h>
+
+#include "common.h"
+#include "fsl_c2x0_crypto_layer.h"
+#include "fsl_c2x0_driver.h"
+#include "algs.h"
+#include "ecdsa_presig.h"
+
+/* The point multiplication k.G of an ECDSA signature does not depend on the
+ * message, so it is done ahead of time by ECC keygen jobs (k, k.G) posted on
+ * idle ring capacity. A sign request then only needs
+ *	s = k^-1 (e + d.r) mod n
+ * on the host. Every pair is used exactly once and wiped when consumed.
+ * The kernel MPI routines are not constant time, so the host steps that
+ * involve k or the private key d run on values blinded by a fresh random
+ * factor. */
+
+static uint32_t presig_high = 64;
+static uint32_t presig_low = 16;
+static uint32_t presig_batch = 8;
+static uint32_t presig_interval_ms = 10;
+
+module_param(presig_high, uint, S_IRUGO);
+MODULE_PARM_DESC(presig_high, "ECDSA presignatures kept per curve (0: off)");
+
+module_param(presig_low, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(presig_low, "ECDSA presignature count that starts a refill");
+
+module_param(presig_batch, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(presig_batch, "Max keygen jobs posted per refill interval");
+
+module_param(presig_interval_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(presig_interval_ms, "ECDSA presignature refill interval");
+
+/* Keygen job feeding a pool. The buffer holds the private key k (N bytes)
+ * followed by the public point k.G (2L bytes). */
+struct presig_job {
+	struct pkc_request req;
+	struct list_head list;
+	ecdsa_presig_pool_t *pool;
+	int32_t result;
+	uint8_t buf[];
+};
+
+static void presig_mpi_free(MPI a)
+{
+	if (!a)
+		return;
+	memzero_explicit(a->d, a->alloced * sizeof(mpi_limb_t));
+	mpi_free(a);
+}
+
+/* Writes a left padded to len bytes */
+static int presig_mpi_write(MPI a, uint8_t *out, uint32_t len)
+{
+	unsigned int nbytes;
+	uint8_t *buf;
+	int sign;
+	int ret = 0;
+
+	buf = mpi_get_buffer(a, &nbytes, &sign);
+	if (!buf)
+		return -ENOMEM;
+
+	if (nbytes > len) {
+		ret = -EINVAL;
+	} else {
+		memset(out, 0, len - nbytes);
+		memcpy(out + len - nbytes, buf, nbytes);
+	}
+	memzero_explicit(buf, nbytes);
+	kfree(buf);
+	return ret;
+}
+
+/* Leftmost nbits of the hash, as in FIPS 186 */
+static MPI presig_hash_to_int(const uint8_t *m, uint32_t m_len,
+			      unsigned int nbits)
+{
+	unsigned int n_bytes = (nbits + 7) / 8;
+	MPI e;
+
+	if (m_len * 8 <= nbits)
+		return mpi_read_raw_data(m, m_len);
+
+	e = mpi_read_raw_data(m, n_bytes);
+	if (e && (n_bytes * 8 > nbits))
+		mpi_rshift(e, e, n_bytes * 8 - nbits);
+
+	return e;
+}
+
+/* Random blinding factor in [1, n - 1], NULL on failure */
+static MPI presig_blind(MPI n, uint32_t n_len)
+{
+	uint8_t buf[ECDSA_PRESIG_MAX_LEN + 8];
+	MPI raw, b;
+
+	/* 64 extra bits make the bias of the reduction negligible */
+	get_random_bytes(buf, n_len + 8);
+	raw = mpi_read_raw_data(buf, n_len + 8);
+	memzero_explicit(buf, sizeof(buf));
+	b = mpi_alloc(0);
+	if (!raw || !b)
+		goto error;
+
+	mpi_mod(b, raw, n);
+	if (!mpi_cmp_ui(b, 0))
+		goto error;
+
+	presig_mpi_free(raw);
+	return b;
+
+error:
+	presig_mpi_free(b);
+	presig_mpi_free(raw);
+	return NULL;
+}
+
+/* kinv = k^-1 mod n. The inversion only sees k.b for a random b */
+static int presig_invert(MPI kinv, MPI k, MPI n, uint32_t n_len)
+{
+	MPI b, kb = NULL, kbinv = NULL;
+	int ret = -ENOMEM;
+
+	b = presig_blind(n, n_len);
+	kb = mpi_alloc(0);
+	kbinv = mpi_alloc(0);
+	if (!b || !kb || !kbinv)
+		goto out;
+
+	mpi_mulm(kb, k, b, n);
+	if (!mpi_invm(kbinv, kb, n)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	mpi_mulm(kinv, kbinv, b, n);
+	ret = 0;
+
+out:
+	presig_mpi_free(kbinv);
+	presig_mpi_free(kb);
+	presig_mpi_free(b);
+	return ret;
+}
+
+/* s = k^-1 (e + d.r) mod n, computed as b^-1 (k^-1 ((b.d).r + b.e)) for a
+ * random b so that no reduction sees d unblinded */
+static int presig_sign_mpi(MPI s, MPI kinv, MPI r, MPI d, MPI e, MPI n,
+			   uint32_t n_len)
+{
+	MPI b, binv = NULL, t = NULL, u = NULL;
+	int ret = -ENOMEM;
+
+	b = presig_blind(n, n_len);
+	binv = mpi_alloc(0);
+	t = mpi_alloc(0);
+	u = mpi_alloc(0);
+	if (!b || !binv || !t || !u)
+		goto out;
+
+	ret = -EINVAL;
+	if (!mpi_invm(binv, b, n))
+		goto out;
+
+	mpi_mulm(t, b, d, n);
+	mpi_mulm(u, t, r, n);
+	mpi_mulm(t, b, e, n);
+	mpi_addm(t, t, u, n);
+	mpi_mulm(u, kinv, t, n);
+	mpi_mulm(s, u, binv, n);
+	if (mpi_cmp_ui(s, 0))
+		ret = 0;
+
+out:
+	presig_mpi_free(u);
+	presig_mpi_free(t);
+	presig_mpi_free(binv);
+	presig_mpi_free(b);
+	return ret;
+}
+
+/* App ring with the most room, provided it is at most a quarter full */
+static uint32_t presig_idle_ring(fsl_crypto_dev_t *c_dev)
+{
+	uint32_t rid, occ, best = 0, best_occ = U32_MAX;
+
+	for (rid = 1; rid < c_dev->num_of_rings; rid++) {
+		if (atomic_read(&c_dev->ring_pairs[rid].block))
+			continue;
+		occ = ring_occupancy(c_dev, rid);
+		if (occ < best_occ) {
+			best = rid;
+			best_occ = occ;
+		}
+	}
+
+	if (best && (best_occ * 4 > c_dev->ring_pairs[best].depth))
+		return 0;
+
+	return best;
+}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0))
+static void presig_keygen_done(void *data, int err)
+{
+	struct presig_job *job = data;
+#else
+static void presig_keygen_done(struct crypto_async_request *areq, int err)
+{
+	struct presig_job *job = areq->data;
+#endif
+	ecdsa_presig_pool_t *pool = job->pool;
+	unsigned long flags;
+
+	job->result = err;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	list_add_tail(&job->list, &pool->done);
+	if (!pool->dying)
+		schedule_delayed_work(&pool->refill, 0);
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+static void presig_job_free(ecdsa_presig_pool_t *pool, struct presig_job *job)
+{
+	const ecc_curve_t *curve = ecc_curve_get(pool->id);
+
+	memzero_explicit(job->buf, curve->r_len + 2 * curve->q_len);
+	kfree(job);
+	atomic_dec(&pool->inflight);
+}
+
+/*******************************************************************************
+ * Function     : presig_fold
+ *
+ * Arguments    : pool - pool the job belongs to
+ *		  job  - completed keygen job
+ *
+ * Return Value : void
+ *
+ * Description  : Turns (k, k.G) into (k^-1 mod n, x(k.G) mod n) and adds it
+ *		  to the pool. Pairs with r == 0 are dropped.
+ *
+ ******************************************************************************/
+static void presig_fold(ecdsa_presig_pool_t *pool, struct presig_job *job)
+{
+	const ecc_curve_t *curve = ecc_curve_get(pool->id);
+	uint32_t n_len = curve->r_len;
+	uint8_t entry[2 * ECDSA_PRESIG_MAX_LEN];
+	MPI n = NULL, k = NULL, x = NULL, kinv = NULL, r = NULL;
+	unsigned long flags;
+	uint32_t tail;
+
+	if (job->result) {
+		print_debug("Presig keygen failed: %d\n", job->result);
+		goto out;
+	}
+
+	n = mpi_read_raw_data(curve->r, n_len);
+	k = mpi_read_raw_data(job->buf, n_len);
+	x = mpi_read_raw_data(job->buf + n_len, curve->q_len);
+	kinv = mpi_alloc(0);
+	r = mpi_alloc(0);
+	if (!n || !k || !x || !kinv || !r)
+		goto out;
+
+	if (presig_invert(kinv, k, n, n_len))
+		goto out;
+
+	mpi_mod(r, x, n);
+	if (!mpi_cmp_ui(r, 0))
+		goto out;
+
+	if (presig_mpi_write(kinv, entry, n_len) ||
+	    presig_mpi_write(r, entry + n_len, n_len))
+		goto out;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (pool->count < presig_high) {
+		tail = (pool->head + pool->count) % presig_high;
+		memcpy(pool->entries + tail * 2 * n_len, entry, 2 * n_len);
+		pool->count++;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+out:
+	memzero_explicit(entry, sizeof(entry));
+	presig_mpi_free(r);
+	presig_mpi_free(kinv);
+	presig_mpi_free(x);
+	presig_mpi_free(k);
+	presig_mpi_free(n);
+	presig_job_free(pool, job);
+}
+
+static int presig_post(ecdsa_presig_pool_t *pool, uint32_t rid)
+{
+	const ecc_curve_t *curve = ecc_curve_get(pool->id);
+	struct dsa_keygen_req_s *kg;
+	struct presig_job *job;
+
+	job = kzalloc(sizeof(*job) + curve->r_len + 2 * curve->q_len,
+		      GFP_KERNEL | GFP_DMA);
+	if (!job)
+		return -ENOMEM;
+
+	job->pool = pool;
+	job->req.type = ECDSA_KEYGEN;
+	job->req.curve_type = curve->type;
+	job->req.base.complete = presig_keygen_done;
+	job->req.base.data = job;
+
+	/* Domain parameters are matched to the resident copy on submission */
+	kg = &job->req.req_u.dsa_keygen;
+	kg->q = (uint8_t *)curve->q;
+	kg->r = (uint8_t *)curve->r;
+	kg->g = (uint8_t *)curve->g;
+	kg->ab = (uint8_t *)curve->ab;
+	kg->q_len = curve->q_len;
+	kg->r_len = curve->r_len;
+	kg->g_len = curve->g_len;
+	kg->ab_len = curve->ab_len;
+	kg->prvkey = job->buf;
+	kg->prvkey_len = curve->r_len;
+	kg->pubkey = job->buf + curve->r_len;
+	kg->pubkey_len = 2 * curve->q_len;
+
+	atomic_inc(&pool->inflight);
+	if (-EINPROGRESS != ecdsa_int_keygen(pool->c_dev, rid, &job->req)) {
+		presig_job_free(pool, job);
+		return -1;
+	}
+	return 0;
+}
+
+static void presig_drain(ecdsa_presig_pool_t *pool, bool fold)
+{
+	struct presig_job *job, *tmp;
+	unsigned long flags;
+	LIST_HEAD(done);
+
+	spin_lock_irqsave(&pool->lock, flags);
+	list_splice_init(&pool->done, &done);
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	list_for_each_entry_safe(job, tmp, &done, list) {
+		list_del(&job->list);
+		if (fold)
+			presig_fold(pool, job);
+		else
+			presig_job_free(pool, job);
+	}
+}
+
+/*******************************************************************************
+ * Function     : presig_refill
+ *
+ * Arguments    : work - refill work of the pool
+ *
+ * Return Value : void
+ *
+ * Description  : Folds the completed keygen jobs into the pool and posts up
+ *		  to presig_batch new ones while the pool is below presig_high
+ *		  and some app ring is idle. Re-arms itself every
+ *		  presig_interval_ms until the pool is full.
+ *
+ ******************************************************************************/
+static void presig_refill(struct work_struct *work)
+{
+	ecdsa_presig_pool_t *pool =
+	    container_of(to_delayed_work(work), ecdsa_presig_pool_t, refill);
+	fsl_crypto_dev_t *c_dev = pool->c_dev;
+	uint32_t i, rid;
+
+	presig_drain(pool, true);
+
+	if (pool->dying || !device_alive(c_dev))
+		return;
+
+	for (i = 0; i < presig_batch; i++) {
+		if (pool->count + atomic_read(&pool->inflight) >= presig_high)
+			return;
+
+		rid = presig_idle_ring(c_dev);
+		if (!rid || presig_post(pool, rid))
+			break;
+	}
+
+	schedule_delayed_work(&pool->refill,
+			      msecs_to_jiffies(presig_interval_ms));
+}
+
+/*******************************************************************************
+ * Function     : ecdsa_presig_sign
+ *
+ * Arguments    : c_dev - device of the session
+ *		  req   - ECDSA_SIGN request
+ *
+ * Return Value : 0 if the request is signed, error code otherwise, in which
+ *		  case the caller posts it to the device as usual
+ *
+ * Description  : Signs the request with a presignature of its curve. Only
+ *		  named curves have a pool.
+ *
+ ******************************************************************************/
+int ecdsa_presig_sign(fsl_crypto_dev_t *c_dev, struct pkc_request *req)
+{
+	struct dsa_sign_req_s *sign = &req->req_u.dsa_sign;
+	uint8_t entry[2 * ECDSA_PRESIG_MAX_LEN];
+	MPI n = NULL, kinv = NULL, r = NULL, d = NULL, e = NULL;
+	MPI s = NULL;
+	ecdsa_presig_pool_t *pool;
+	ecc_curve_res_t *res;
+	uint8_t *slot;
+	unsigned long flags;
+	uint32_t n_len;
+	int ret = -ENOMEM;
+
+	if (!c_dev->presig)
+		return -EINVAL;
+
+	res = ecc_curve_lookup(c_dev, sign->q, sign->q_len, sign->r,
+			       sign->r_len, sign->g, sign->g_len,
+			       sign->ab, sign->ab_len);
+	if (!res)
+		return -EINVAL;
+
+	pool = &c_dev->presig[res - c_dev->ecc_curves];
+	n_len = res->curve->r_len;
+	if (sign->d_len != n_len)
+		return -EINVAL;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (!pool->count) {
+		if (!pool->dying)
+			schedule_delayed_work(&pool->refill, 0);
+		spin_unlock_irqrestore(&pool->lock, flags);
+		return -EAGAIN;
+	}
+	slot = pool->entries + pool->head * 2 * n_len;
+	memcpy(entry, slot, 2 * n_len);
+	memzero_explicit(slot, 2 * n_len);
+	pool->head = (pool->head + 1) % presig_high;
+	if ((--pool->count < presig_low) && !pool->dying)
+		schedule_delayed_work(&pool->refill, 0);
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	n = mpi_read_raw_data(res->curve->r, n_len);
+	kinv = mpi_read_raw_data(entry, n_len);
+	r = mpi_read_raw_data(entry + n_len, n_len);
+	d = mpi_read_raw_data(sign->priv_key, sign->priv_key_len);
+	s = mpi_alloc(0);
+	if (!n || !kinv || !r || !d || !s)
+		goto out;
+
+	e = presig_hash_to_int(sign->m, sign->m_len, mpi_get_nbits(n));
+	if (!e)
+		goto out;
+
+	ret = presig_sign_mpi(s, kinv, r, d, e, n, n_len);
+	if (ret)
+		goto out;
+
+	ret = presig_mpi_write(r, sign->c, n_len);
+	if (!ret)
+		ret = presig_mpi_write(s, sign->d, n_len);
+
+out:
+	memzero_explicit(entry, sizeof(entry));
+	presig_mpi_free(s);
+	presig_mpi_free(e);
+	presig_mpi_free(d);
+	presig_mpi_free(r);
+	presig_mpi_free(kinv);
+	presig_mpi_free(n);
+	return ret;
+}
+
+/* RFC 6979 A.2.5, P-256 with SHA-256, message "sample" */
+static const uint8_t presig_kat_d[] = {
+	0xC9, 0xAF, 0xA9, 0xD8, 0x45, 0xBA, 0x75, 0x16, 0x6B, 0x5C, 0x21, 0x57,
+	0x67, 0xB1, 0xD6, 0x93, 0x4E, 0x50, 0xC3, 0xDB, 0x36, 0xE8, 0x9B, 0x12,
+	0x7B, 0x8A, 0x62, 0x2B, 0x12, 0x0F, 0x67, 0x21
+};
+static const uint8_t presig_kat_k[] = {
+	0xA6, 0xE3, 0xC5, 0x7D, 0xD0, 0x1A, 0xBE, 0x90, 0x08, 0x65, 0x38, 0x39,
+	0x83, 0x55, 0xDD, 0x4C, 0x3B, 0x17, 0xAA, 0x87, 0x33, 0x82, 0xB0, 0xF2,
+	0x4D, 0x61, 0x29, 0x49, 0x3D, 0x8A, 0xAD, 0x60
+};
+static const uint8_t presig_kat_h[] = {
+	0xAF, 0x2B, 0xDB, 0xE1, 0xAA, 0x9B, 0x6E, 0xC1, 0xE2, 0xAD, 0xE1, 0xD6,
+	0x94, 0xF4, 0x1F, 0xC7, 0x1A, 0x83, 0x1D, 0x02, 0x68, 0xE9, 0x89, 0x15,
+	0x62, 0x11, 0x3D, 0x8A, 0x62, 0xAD, 0xD1, 0xBF
+};
+static const uint8_t presig_kat_r[] = {
+	0xEF, 0xD4, 0x8B, 0x2A, 0xAC, 0xB6, 0xA8, 0xFD, 0x11, 0x40, 0xDD, 0x9C,
+	0xD4, 0x5E, 0x81, 0xD6, 0x9D, 0x2C, 0x87, 0x7B, 0x56, 0xAA, 0xF9, 0x91,
+	0xC3, 0x4D, 0x0E, 0xA8, 0x4E, 0xAF, 0x37, 0x16
+};
+static const uint8_t presig_kat_s[] = {
+	0xF7, 0xCB, 0x1C, 0x94, 0x2D, 0x65, 0x7C, 0x41, 0xD4, 0x36, 0xC7, 0xA1,
+	0xB6, 0xE2, 0x9F, 0x65, 0xF3, 0xE9, 0x00, 0xDB, 0xB9, 0xAF, 0xF4, 0x06,
+	0x4D, 0xC4, 0xAB, 0x2F, 0x84, 0x3A, 0xCD, 0xA8
+};
+
+/*******************************************************************************
+ * Function     : presig_self_test
+ *
+ * Arguments    : void
+ *
+ * Return Value : 0 if the host signing steps give the known answer
+ *
+ * Description  : Runs the blinded inversion and signing of a presignature
+ *		  on a known P-256 vector. k.G is not computed: x(k.G) mod n
+ *		  is the known r.
+ *
+ ******************************************************************************/
+static int presig_self_test(void)
+{
+	const ecc_curve_t *curve = ecc_curve_get(ECC_CURVE_P256);
+	MPI n, k, d, e, r, kinv = NULL, s = NULL, want = NULL;
+	int ret = -ENOMEM;
+
+	n = mpi_read_raw_data(curve->r, curve->r_len);
+	k = mpi_read_raw_data(presig_kat_k, sizeof(presig_kat_k));
+	d = mpi_read_raw_data(presig_kat_d, sizeof(presig_kat_d));
+	r = mpi_read_raw_data(presig_kat_r, sizeof(presig_kat_r));
+	want = mpi_read_raw_data(presig_kat_s, sizeof(presig_kat_s));
+	kinv = mpi_alloc(0);
+	s = mpi_alloc(0);
+	e = NULL;
+	if (!n || !k || !d || !r || !want || !kinv || !s)
+		goto out;
+
+	e = presig_hash_to_int(presig_kat_h, sizeof(presig_kat_h),
+			       mpi_get_nbits(n));
+	if (!e)
+		goto out;
+
+	ret = presig_invert(kinv, k, n, curve->r_len);
+	if (!ret)
+		ret = presig_sign_mpi(s, kinv, r, d, e, n, curve->r_len);
+	if (!ret && mpi_cmp(s, want))
+		ret = -EINVAL;
+
+out:
+	presig_mpi_free(s);
+	presig_mpi_free(kinv);
+	presig_mpi_free(e);
+	presig_mpi_free(want);
+	presig_mpi_free(r);
+	presig_mpi_free(d);
+	presig_mpi_free(k);
+	presig_mpi_free(n);
+	return ret;
+}
+
+/*******************************************************************************
+ * Function     : init_ecdsa_presig
+ *
+ * Arguments    : c_dev - crypto device
+ *
+ * Return Value : 0 on success, -ENOMEM otherwise
+ *
+ * Description  : Allocates a pool per named curve and starts filling it.
+ *		  Signing stays on the device if the host steps fail their
+ *		  known answer test.
+ *
+ ******************************************************************************/
+int32_t init_ecdsa_presig(fsl_crypto_dev_t *c_dev)
+{
+	ecdsa_presig_pool_t *pool;
+	uint32_t i;
+
+	if (!presig_high)
+		return 0;
+
+	if (presig_self_test()) {
+		print_error("ECDSA presignature self test failed, pools disabled\n");
+		return 0;
+	}
+
+	c_dev->presig = kcalloc(ECC_CURVE_MAX, sizeof(*pool), GFP_KERNEL);
+	if (!c_dev->presig)
+		return -ENOMEM;
+
+	for (i = 0; i < ECC_CURVE_MAX; i++) {
+		pool = &c_dev->presig[i];
+		pool->entries = kzalloc(presig_high * 2 *
+					ecc_curve_get(i)->r_len, GFP_KERNEL);
+		if (!pool->entries)
+			goto error;
+
+		pool->c_dev = c_dev;
+		pool->id = i;
+		spin_lock_init(&pool->lock);
+		atomic_set(&pool->inflight, 0);
+		INIT_LIST_HEAD(&pool->done);
+		INIT_DELAYED_WORK(&pool->refill, presig_refill);
+	}
+
+	for (i = 0; i < ECC_CURVE_MAX; i++)
+		schedule_delayed_work(&c_dev->presig[i].refill, 0);
+
+	return 0;
+
+error:
+	while (i--)
+		kfree(c_dev->presig[i].entries);
+	kfree(c_dev->presig);
+	c_dev->presig = NULL;
+	return -ENOMEM;
+}
+
+/*******************************************************************************
+ * Function     : cleanup_ecdsa_presig
+ *
+ * Arguments    : c_dev - crypto device
+ *
+ * Return Value : void
+ *
+ * Description  : Stops the refill, waits for the keygen jobs still on the
+ *		  device and wipes the pools.
+ *
+ ******************************************************************************/
+void cleanup_ecdsa_presig(fsl_crypto_dev_t *c_dev)
+{
+	ecdsa_presig_pool_t *pool;
+	unsigned long flags;
+	uint32_t i, wait = 100;
+	bool busy;
+
+	if (!c_dev->presig)
+		return;
+
+	for (i = 0; i < ECC_CURVE_MAX; i++) {
+		pool = &c_dev->presig[i];
+		spin_lock_irqsave(&pool->lock, flags);
+		pool->dying = true;
+		spin_unlock_irqrestore(&pool->lock, flags);
+		cancel_delayed_work_sync(&pool->refill);
+	}
+
+	do {
+		busy = false;
+		for (i = 0; i < ECC_CURVE_MAX; i++) {
+			presig_drain(&c_dev->presig[i], false);
+			if (atomic_read(&c_dev->presig[i].inflight))
+				busy = true;
+		}
+		if (busy)
+			msleep(10);
+	} while (busy && --wait);
+
+	if (busy) {
+		/* Late completions still reference the pools */
+		print_error("Presig keygen jobs lost, pools not freed\n");
+		c_dev->presig = NULL;
+		return;
+	}
+
+	for (i = 0; i < ECC_CURVE_MAX; i++) {
+		pool = &c_dev->presig[i];
+		memzero_explicit(pool->entries,
+				 presig_high * 2 * ecc_curve_get(i)->r_len);
+		kfree(pool->entries);
+	}
+	kfree(c_dev->presig);
+	c_dev->presig = NULL;
+}
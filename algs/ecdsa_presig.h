@@ -0,0 +1,79 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FSL_PKC_ECDSA_PRESIG_H
+#define FSL_PKC_ECDSA_PRESIG_H
+
+#include "ecc_curves.h"
+
+/* Largest order length of the named curves (B-571/P-521) */
+#define ECDSA_PRESIG_MAX_LEN	72
+
+/*******************************************************************************
+Description :	Per device, per named curve pool of ECDSA presignatures.
+Fields      :	c_dev	: Device the keygen jobs are posted to
+		id	: Named curve
+		lock	: Protects entries/head/count and the done list
+		entries	: Ring of ready (k^-1 mod n, r) pairs, 2 * r_len bytes
+			  each, presig_high deep
+		head	: Index of the oldest ready entry
+		count	: Number of ready entries
+		inflight: Keygen jobs posted and not yet folded into the ring
+		done	: Completed keygen jobs waiting for the refill work
+		refill	: Converts completed jobs and posts new ones
+		dying	: Set on cleanup, stops the refill
+*******************************************************************************/
+typedef struct ecdsa_presig_pool {
+	fsl_crypto_dev_t *c_dev;
+	ecc_curve_id_t id;
+
+	spinlock_t lock;
+	uint8_t *entries;
+	uint32_t head;
+	uint32_t count;
+
+	atomic_t inflight;
+	struct list_head done;
+	struct delayed_work refill;
+	bool dying;
+} ecdsa_presig_pool_t;
+
+int32_t init_ecdsa_presig(fsl_crypto_dev_t *c_dev);
+void cleanup_ecdsa_presig(fsl_crypto_dev_t *c_dev);
+int ecdsa_presig_sign(fsl_crypto_dev_t *c_dev, struct pkc_request *req);
+int ecdsa_int_keygen(fsl_crypto_dev_t *c_dev, uint32_t r_id,
+		     struct pkc_request *req);
+
+#endif
@@ -49,6 +49,12 @@
 typedef struct crypto_dev_sess crypto_dev_sess_t;
 extern int fill_crypto_dev_sess_ctx(crypto_dev_sess_t *, uint32_t);
 
+#ifdef SEC_DMA
+static uint32_t hash_sg_min = 512;
+module_param(hash_sg_min, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(hash_sg_min, "Source entries from this size on are read in place, smaller ones copied");
+#endif
+
 /*****************************************************************************
  * Function     : hash_cra_init
  *
@@ -363,6 +369,19 @@ static void hash_init_crypto_mem(crypto_mem_info_t *crypto_mem,
 	hash_buffs->output_buff.bt = BT_OP;
 }
 
+/* Counts the link table entries for src. A single entry is copied as is,
+ * without a table, unless it is big enough to be read in place */
+static int hash_sg_count(struct scatterlist *src, int nbytes, bool *chained)
+{
+	int nents = __sg_count(src, nbytes, chained);
+
+#ifdef SEC_DMA
+	if (1 == nents && src->length >= hash_sg_min)
+		return 1;
+#endif
+	return 1 == nents ? 0 : nents;
+}
+
 static void hash_init_len(struct ahash_request *req, struct hash_lengths *len,
 			  crypto_mem_info_t *mem_info)
 {
@@ -387,6 +406,10 @@ static void hash_init_len(struct ahash_request *req, struct hash_lengths *len,
 
 		for (; i < (len->src_nents + len->addon_nents); i++) {
 			mem->input_buffs[i].len = sg->length;
+#ifdef SEC_DMA
+			if (sg->length >= hash_sg_min)
+				mem->input_buffs[i].bt = BT_HOST;
+#endif
 			sg = scatterwalk_sg_next(sg);
 		}
 	} else {
@@ -447,6 +470,15 @@ static int hash_cp_req(struct ahash_request *req, struct hash_lengths *len,
 		}
 
 		for (; i < (len->src_nents + len->addon_nents); i++) {
+#ifdef SEC_DMA
+			if (BT_HOST == mem->input_buffs[i].bt) {
+				if (map_host_buff(mem_info->dev,
+						  &mem->input_buffs[i], sg))
+					return -ENOMEM;
+				sg = scatterwalk_sg_next(sg);
+				continue;
+			}
+#endif
 			sg_map_copy(mem->input_buffs[i].v_mem, sg, sg->length,
 				    sg->offset);
 			sg = scatterwalk_sg_next(sg);
@@ -917,7 +949,7 @@ int ahash_digest(struct ahash_request *req)
 	crypto_ctx->crypto_mem.pool = c_dev->ring_pairs[r_id].ip_pool;
 	print_debug("IP Buffer pool address: %p\n", crypto_ctx->crypto_mem.pool);
 
-	len.src_nents = sg_count(req->src, req->nbytes, &chained);
+	len.src_nents = hash_sg_count(req->src, req->nbytes, &chained);
 	len.addon_nents = 0;
 	len.output_len = digestsize;
 	len.src_len = 0;
@@ -2224,7 +2256,7 @@ int ahash_update_first(struct ahash_request *req)
 		print_debug("IP Buffer pool address: %p\n", crypto_ctx->crypto_mem.pool);
 
 		len.src_nents =
-		    sg_count(req->src, req->nbytes - (*next_buflen), &chained);
+		    hash_sg_count(req->src, req->nbytes - (*next_buflen), &chained);
 		len.addon_nents = 0;
 		len.output_len = ctx->ctx_len;
 		len.src_len = 0;
@@ -0,0 +1,303 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <linux/crypto.h>
+#include <linux/jhash.h>
+#include <linux/hash.h>
+
+#include "common.h"
+#include "pkc_cache.h"
+
+/* Results of RSA_PUB and ECDSA_VERIFY requests, keyed on the exact bytes of
+ * the key and the input. The hash only picks the bucket, a hit needs every
+ * field to compare equal, so a verify is never answered for a different
+ * signature. Only successful results are kept. */
+
+#define PKC_CACHE_HASH_BITS	8
+#define PKC_CACHE_MAX_DATA	4096
+
+static uint32_t pkc_cache_entries = 256;
+static uint32_t pkc_cache_ttl_ms = 60000;
+static unsigned long pkc_cache_hits;
+static unsigned long pkc_cache_misses;
+
+module_param(pkc_cache_entries, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(pkc_cache_entries, "Max cached RSA_PUB/ECDSA_VERIFY results (0: off)");
+
+module_param(pkc_cache_ttl_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(pkc_cache_ttl_ms, "Lifetime of a cached result");
+
+module_param(pkc_cache_hits, ulong, S_IRUGO);
+MODULE_PARM_DESC(pkc_cache_hits, "Requests completed from the cache");
+
+module_param(pkc_cache_misses, ulong, S_IRUGO);
+MODULE_PARM_DESC(pkc_cache_misses, "Cacheable requests sent to the device");
+
+static DEFINE_SPINLOCK(pkc_cache_lock);
+static struct hlist_head pkc_cache_tbl[1 << PKC_CACHE_HASH_BITS];
+static LIST_HEAD(pkc_cache_lru);
+static uint32_t pkc_cache_count;
+
+struct pkc_cache_key {
+	uint32_t nr;
+	const uint8_t *ptr[PKC_CACHE_MAX_FIELDS];
+	uint32_t len[PKC_CACHE_MAX_FIELDS];
+	uint8_t *out;
+	uint32_t out_len;
+};
+
+static inline void key_add(struct pkc_cache_key *key, const uint8_t *ptr,
+			   uint32_t len)
+{
+	key->ptr[key->nr] = ptr;
+	key->len[key->nr] = len;
+	key->nr++;
+}
+
+/* Returns false for requests that are not cached */
+static bool pkc_cache_key(struct pkc_request *req, struct pkc_cache_key *key)
+{
+	struct rsa_pub_req_s *pub = &req->req_u.rsa_pub_req;
+	struct dsa_verify_req_s *ver = &req->req_u.dsa_verify;
+
+	key->nr = 0;
+	switch (req->type) {
+	case RSA_PUB:
+		key_add(key, pub->n, pub->n_len);
+		key_add(key, pub->e, pub->e_len);
+		key_add(key, pub->f, pub->f_len);
+		key->out = pub->g;
+		key->out_len = pub->g_len;
+		return true;
+	case ECDSA_VERIFY:
+		key_add(key, ver->q, ver->q_len);
+		key_add(key, ver->r, ver->r_len);
+		key_add(key, ver->g, ver->g_len);
+		key_add(key, ver->pub_key, ver->pub_key_len);
+		key_add(key, ver->m, ver->m_len);
+		key_add(key, ver->c, ver->d_len);
+		key_add(key, ver->d, ver->d_len);
+		key_add(key, ver->ab, ver->ab_len);
+		key->out = NULL;
+		key->out_len = 0;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static uint32_t pkc_cache_hash(struct pkc_request *req,
+			       struct pkc_cache_key *key)
+{
+	uint32_t h = jhash_2words(req->type, req->curve_type, 0);
+	uint32_t i;
+
+	for (i = 0; i < key->nr; i++)
+		h = jhash(key->ptr[i], key->len[i], h ^ key->len[i]);
+
+	return h;
+}
+
+static bool pkc_cache_match(struct pkc_cache_entry *e, uint32_t hash,
+			    struct pkc_request *req, struct pkc_cache_key *key)
+{
+	uint8_t *data = e->data;
+	uint32_t i;
+
+	if (e->hash != hash || e->type != req->type ||
+	    e->curve != req->curve_type || e->nr != key->nr ||
+	    e->out_len != key->out_len)
+		return false;
+
+	for (i = 0; i < key->nr; i++) {
+		if (e->len[i] != key->len[i] ||
+		    memcmp(data, key->ptr[i], key->len[i]))
+			return false;
+		data += key->len[i];
+	}
+	return true;
+}
+
+/* Offset of the output in the entry data */
+static uint32_t pkc_cache_in_len(struct pkc_cache_entry *e)
+{
+	uint32_t i, len = 0;
+
+	for (i = 0; i < e->nr; i++)
+		len += e->len[i];
+
+	return len;
+}
+
+/* Called with pkc_cache_lock held */
+static void pkc_cache_del(struct pkc_cache_entry *e)
+{
+	hlist_del(&e->node);
+	list_del(&e->lru);
+	pkc_cache_count--;
+	kfree(e);
+}
+
+static struct pkc_cache_entry *pkc_cache_find(uint32_t hash,
+					      struct pkc_request *req,
+					      struct pkc_cache_key *key)
+{
+	struct hlist_head *head = &pkc_cache_tbl[hash_32(hash, PKC_CACHE_HASH_BITS)];
+	struct pkc_cache_entry *e;
+	struct hlist_node *pos;
+
+	for (pos = head->first; pos; pos = pos->next) {
+		e = hlist_entry(pos, struct pkc_cache_entry, node);
+		if (pkc_cache_match(e, hash, req, key))
+			return e;
+	}
+	return NULL;
+}
+
+/*******************************************************************************
+ * Function     : pkc_cache_lookup
+ *
+ * Arguments    : req - RSA_PUB or ECDSA_VERIFY request
+ *
+ * Return Value : 0 when the request was answered from the cache, the RSA_PUB
+ *		  output is filled in. -ENOENT otherwise.
+ *
+ ******************************************************************************/
+int pkc_cache_lookup(struct pkc_request *req)
+{
+	struct pkc_cache_key key;
+	struct pkc_cache_entry *e;
+	uint32_t hash;
+	int ret = -ENOENT;
+
+	if (!pkc_cache_entries || !pkc_cache_key(req, &key))
+		return -ENOENT;
+
+	hash = pkc_cache_hash(req, &key);
+
+	spin_lock_bh(&pkc_cache_lock);
+	e = pkc_cache_find(hash, req, &key);
+	if (e && time_after(jiffies, e->expires)) {
+		pkc_cache_del(e);
+		e = NULL;
+	}
+
+	if (e) {
+		list_move(&e->lru, &pkc_cache_lru);
+		if (key.out_len)
+			memcpy(key.out, e->data + pkc_cache_in_len(e), key.out_len);
+		pkc_cache_hits++;
+		ret = 0;
+	} else {
+		pkc_cache_misses++;
+	}
+	spin_unlock_bh(&pkc_cache_lock);
+
+	return ret;
+}
+
+/*******************************************************************************
+ * Function     : pkc_cache_insert
+ *
+ * Arguments    : req - Request completed successfully by the device
+ *
+ * Return Value : None
+ *
+ * Description  : Adds the result, evicting the least recently used entry
+ *		  when the cache is full. Called from the completion path.
+ *
+ ******************************************************************************/
+void pkc_cache_insert(struct pkc_request *req)
+{
+	struct pkc_cache_key key;
+	struct pkc_cache_entry *e, *old;
+	uint32_t hash, len = 0, i;
+	uint8_t *data;
+
+	if (!pkc_cache_entries || !pkc_cache_key(req, &key))
+		return;
+
+	for (i = 0; i < key.nr; i++)
+		len += key.len[i];
+	len += key.out_len;
+	if (len > PKC_CACHE_MAX_DATA)
+		return;
+
+	e = kmalloc(sizeof(*e) + len, GFP_ATOMIC);
+	if (!e)
+		return;
+
+	hash = pkc_cache_hash(req, &key);
+	e->hash = hash;
+	e->expires = jiffies + msecs_to_jiffies(pkc_cache_ttl_ms);
+	e->type = req->type;
+	e->curve = req->curve_type;
+	e->nr = key.nr;
+	e->out_len = key.out_len;
+
+	data = e->data;
+	for (i = 0; i < key.nr; i++) {
+		e->len[i] = key.len[i];
+		memcpy(data, key.ptr[i], key.len[i]);
+		data += key.len[i];
+	}
+	if (key.out_len)
+		memcpy(data, key.out, key.out_len);
+
+	spin_lock_bh(&pkc_cache_lock);
+	old = pkc_cache_find(hash, req, &key);
+	if (old)
+		pkc_cache_del(old);
+
+	while (pkc_cache_count && pkc_cache_count >= pkc_cache_entries)
+		pkc_cache_del(list_entry(pkc_cache_lru.prev,
+					 struct pkc_cache_entry, lru));
+
+	hlist_add_head(&e->node,
+		       &pkc_cache_tbl[hash_32(hash, PKC_CACHE_HASH_BITS)]);
+	list_add(&e->lru, &pkc_cache_lru);
+	pkc_cache_count++;
+	spin_unlock_bh(&pkc_cache_lock);
+}
+
+void pkc_cache_flush(void)
+{
+	struct pkc_cache_entry *e, *tmp;
+
+	spin_lock_bh(&pkc_cache_lock);
+	list_for_each_entry_safe(e, tmp, &pkc_cache_lru, lru)
+		pkc_cache_del(e);
+	spin_unlock_bh(&pkc_cache_lock);
+}
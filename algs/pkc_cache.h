@@ -0,0 +1,72 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FSL_PKC_CACHE_H
+#define FSL_PKC_CACHE_H
+
+/* Inputs taking part in the cache key of a request */
+#define PKC_CACHE_MAX_FIELDS	8
+
+/*******************************************************************************
+Description :	Cached result of a successful RSA_PUB or ECDSA_VERIFY request.
+Fields      :	node	: Hash bucket linkage
+		lru	: LRU linkage, most recently used first
+		hash	: Hash of type, curve and input fields
+		expires	: Entry is stale after this jiffy
+		type	: Request type
+		curve	: Curve type of the request
+		nr	: Number of input fields
+		len	: Length of each input field
+		out_len	: Length of the output (RSA_PUB g, 0 for a verify)
+		data	: Input fields back to back, followed by the output
+*******************************************************************************/
+struct pkc_cache_entry {
+	struct hlist_node node;
+	struct list_head lru;
+	uint32_t hash;
+	unsigned long expires;
+	enum pkc_req_type type;
+	enum curve_t curve;
+	uint32_t nr;
+	uint32_t len[PKC_CACHE_MAX_FIELDS];
+	uint32_t out_len;
+	uint8_t data[];
+};
+
+int pkc_cache_lookup(struct pkc_request *req);
+void pkc_cache_insert(struct pkc_request *req);
+void pkc_cache_flush(void);
+
+#endif
@@ -0,0 +1,485 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <linux/crypto.h>
+
+#include "common.h"
+#include "fsl_c2x0_crypto_layer.h"
+#include "fsl_c2x0_driver.h"
+#include "algs.h"
+#include "pkha.h"
+#include "pkha_desc.h"
+#include "desc.h"
+#include "memmgr.h"
+#include "crypto_ctx.h"
+#include "ring_balance.h"
+#include "dma.h"
+
+static void pkha_op_done(void *ctx, int32_t res)
+{
+	crypto_op_ctx_t *crypto_ctx = ctx;
+
+	print_debug("[PKHA OP DONE ]\n");
+
+	dealloc_crypto_mem(&(crypto_ctx->crypto_mem));
+	crypto_dev_sess_complete(crypto_ctx->req.pkc, res);
+	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
+}
+
+static void pkha_prime_test_done(void *ctx, int32_t res)
+{
+	/* A composite candidate halts the job with our own status */
+	if (PKHA_STATUS_SRC_JUMP == PKHA_STATUS_SRC(res) &&
+	    PKHA_PRIME_TEST_COMPOSITE == PKHA_STATUS_USER(res))
+		res = -EBADMSG;
+
+	pkha_op_done(ctx, res);
+}
+
+/* Address SEC reads an input (or the descriptor) from */
+static inline dev_dma_addr_t pkha_ip_addr(crypto_mem_info_t *mem_info,
+					  buffer_info_t *buff)
+{
+#ifdef SEC_DMA
+	return sec_dma_ip_addr(buff,
+		mem_info->dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr);
+#else
+	return buff->dev_buffer.d_p_addr;
+#endif
+}
+
+/* MODEXP functions */
+static void pkha_modexp_init_crypto_mem(crypto_mem_info_t *crypto_mem)
+{
+	pkha_modexp_buffers_t *mem = &(crypto_mem->c_buffers.pkha_modexp);
+
+	crypto_mem->count = sizeof(pkha_modexp_buffers_t) / sizeof(buffer_info_t);
+	memset(mem, 0, sizeof(pkha_modexp_buffers_t));
+
+	/* Mark the op buffer */
+	mem->n_buff.bt = BT_IP;
+	mem->e_buff.bt = BT_IP;
+	mem->a_buff.bt = BT_IP;
+	mem->b_buff.bt = BT_OP;
+}
+
+static int pkha_modexp_cp_req(struct rsa_pub_req_s *req,
+			      crypto_mem_info_t *mem_info)
+{
+	pkha_modexp_buffers_t *mem = &(mem_info->c_buffers.pkha_modexp);
+
+	if (!req->n_len || !req->e_len || req->f_len > req->n_len ||
+	    req->g_len < req->n_len)
+		return -EINVAL;
+
+	mem->desc_buff.len = PKHA_MODEXP_DESC_LEN;
+	mem->n_buff.len = req->n_len;
+	mem->e_buff.len = req->e_len;
+	mem->a_buff.len = req->f_len;
+	mem->b_buff.len = req->n_len;
+
+	mem_info->buffers = (buffer_info_t *)mem;
+	if (-ENOMEM == alloc_crypto_mem(mem_info))
+		return -ENOMEM;
+#ifdef USE_HOST_DMA
+	memcpy(mem->n_buff.v_mem, req->n, mem->n_buff.len);
+	memcpy(mem->e_buff.v_mem, req->e, mem->e_buff.len);
+	memcpy(mem->a_buff.v_mem, req->f, mem->a_buff.len);
+#else
+	mem->n_buff.req_ptr = req->n;
+	mem->e_buff.req_ptr = req->e;
+	mem->a_buff.req_ptr = req->f;
+#endif
+	mem->b_buff.v_mem = req->g;
+
+	return 0;
+}
+
+static void constr_pkha_modexp_desc(crypto_mem_info_t *mem_info)
+{
+	pkha_modexp_buffers_t *mem = &(mem_info->c_buffers.pkha_modexp);
+	u32 desc[PKHA_MODEXP_DESC_LEN / CAAM_CMD_SZ];
+
+	pkha_modexp_desc(desc,
+			 pkha_ip_addr(mem_info, &mem->n_buff), mem->n_buff.len,
+			 pkha_ip_addr(mem_info, &mem->a_buff), mem->a_buff.len,
+			 pkha_ip_addr(mem_info, &mem->e_buff), mem->e_buff.len,
+			 mem->b_buff.dev_buffer.d_p_addr);
+	change_desc_endianness((uint32_t *) mem->desc_buff.v_mem, desc,
+			       desc_len(desc));
+
+#ifdef DEBUG_DESC
+	print_error("[PKHA_MODEXP]	Descriptor words");
+	dump_desc(mem->desc_buff.v_mem, desc_len(desc), __func__);
+#endif
+}
+
+/* ECMUL functions */
+static void pkha_ecmul_init_crypto_mem(crypto_mem_info_t *crypto_mem)
+{
+	pkha_ecmul_buffers_t *mem = &(crypto_mem->c_buffers.pkha_ecmul);
+
+	crypto_mem->count = sizeof(pkha_ecmul_buffers_t) / sizeof(buffer_info_t);
+	memset(mem, 0, sizeof(pkha_ecmul_buffers_t));
+
+	/* Mark the op buffer */
+	mem->q_buff.bt = BT_IP;
+	mem->p_buff.bt = BT_IP;
+	mem->ab_buff.bt = BT_IP;
+	mem->k_buff.bt = BT_IP;
+	mem->out_buff.bt = BT_OP;
+}
+
+static int pkha_ecmul_cp_req(struct keygen_req_s *req,
+			     crypto_mem_info_t *mem_info)
+{
+	pkha_ecmul_buffers_t *mem = &(mem_info->c_buffers.pkha_ecmul);
+
+	if (!req->q_len || !req->priv_key_len ||
+	    req->g_len != 2 * req->q_len || req->ab_len != 2 * req->q_len ||
+	    req->pub_key_len != 2 * req->q_len)
+		return -EINVAL;
+
+	mem->desc_buff.len = PKHA_ECMUL_DESC_LEN;
+	mem->q_buff.len = req->q_len;
+	mem->p_buff.len = req->g_len;
+	mem->ab_buff.len = req->ab_len;
+	mem->k_buff.len = req->priv_key_len;
+	mem->out_buff.len = req->pub_key_len;
+
+	mem_info->buffers = (buffer_info_t *)mem;
+	if (-ENOMEM == alloc_crypto_mem(mem_info))
+		return -ENOMEM;
+#ifdef USE_HOST_DMA
+	memcpy(mem->q_buff.v_mem, req->q, mem->q_buff.len);
+	memcpy(mem->p_buff.v_mem, req->g, mem->p_buff.len);
+	memcpy(mem->ab_buff.v_mem, req->ab, mem->ab_buff.len);
+	memcpy(mem->k_buff.v_mem, req->priv_key, mem->k_buff.len);
+#else
+	mem->q_buff.req_ptr = req->q;
+	mem->p_buff.req_ptr = req->g;
+	mem->ab_buff.req_ptr = req->ab;
+	mem->k_buff.req_ptr = req->priv_key;
+#endif
+	mem->out_buff.v_mem = req->pub_key;
+
+	return 0;
+}
+
+static void constr_pkha_ecmul_desc(crypto_mem_info_t *mem_info, bool f2m)
+{
+	pkha_ecmul_buffers_t *mem = &(mem_info->c_buffers.pkha_ecmul);
+	u32 desc[PKHA_ECMUL_DESC_LEN / CAAM_CMD_SZ];
+
+	pkha_ecmul_desc(desc, f2m,
+			pkha_ip_addr(mem_info, &mem->q_buff), mem->q_buff.len,
+			pkha_ip_addr(mem_info, &mem->p_buff),
+			pkha_ip_addr(mem_info, &mem->ab_buff),
+			pkha_ip_addr(mem_info, &mem->k_buff), mem->k_buff.len,
+			mem->out_buff.dev_buffer.d_p_addr);
+	change_desc_endianness((uint32_t *) mem->desc_buff.v_mem, desc,
+			       desc_len(desc));
+
+#ifdef DEBUG_DESC
+	print_error("[PKHA_ECMUL]	Descriptor words");
+	dump_desc(mem->desc_buff.v_mem, desc_len(desc), __func__);
+#endif
+}
+
+/* PRIME TEST functions */
+static void pkha_prime_init_crypto_mem(crypto_mem_info_t *crypto_mem)
+{
+	pkha_prime_buffers_t *mem = &(crypto_mem->c_buffers.pkha_prime);
+
+	crypto_mem->count = sizeof(pkha_prime_buffers_t) / sizeof(buffer_info_t);
+	memset(mem, 0, sizeof(pkha_prime_buffers_t));
+
+	/* Mark the op buffer */
+	mem->n_buff.bt = BT_IP;
+	mem->rounds_buff.bt = BT_IP;
+	mem->seed_buff.bt = BT_IP;
+}
+
+static int pkha_prime_cp_req(struct rsa_pub_req_s *req,
+			     crypto_mem_info_t *mem_info)
+{
+	pkha_prime_buffers_t *mem = &(mem_info->c_buffers.pkha_prime);
+
+	if (!req->n_len || 1 != req->e_len || !req->e[0])
+		return -EINVAL;
+
+	mem->desc_buff.len = PKHA_PRIME_TEST_DESC_LEN;
+	mem->n_buff.len = req->n_len;
+	mem->rounds_buff.len = req->e_len;
+	mem->seed_buff.len = req->n_len;
+
+	mem_info->buffers = (buffer_info_t *)mem;
+	if (-ENOMEM == alloc_crypto_mem(mem_info))
+		return -ENOMEM;
+#ifdef USE_HOST_DMA
+	memcpy(mem->n_buff.v_mem, req->n, mem->n_buff.len);
+	memcpy(mem->rounds_buff.v_mem, req->e, mem->rounds_buff.len);
+#else
+	mem->n_buff.req_ptr = req->n;
+	mem->rounds_buff.req_ptr = req->e;
+#endif
+	/* Written by the RNG within the job */
+	mem->seed_buff.req_ptr = mem->seed_buff.v_mem;
+
+	return 0;
+}
+
+static void constr_pkha_prime_desc(crypto_mem_info_t *mem_info)
+{
+	pkha_prime_buffers_t *mem = &(mem_info->c_buffers.pkha_prime);
+	u32 desc[PKHA_PRIME_TEST_DESC_LEN / CAAM_CMD_SZ];
+
+	pkha_prime_test_desc(desc,
+			     pkha_ip_addr(mem_info, &mem->n_buff),
+			     mem->n_buff.len,
+			     mem->seed_buff.dev_buffer.d_p_addr,
+			     pkha_ip_addr(mem_info, &mem->rounds_buff));
+	change_desc_endianness((uint32_t *) mem->desc_buff.v_mem, desc,
+			       desc_len(desc));
+
+#ifdef DEBUG_DESC
+	print_error("[PKHA_PRIME_TEST]	Descriptor words");
+	dump_desc(mem->desc_buff.v_mem, desc_len(desc), __func__);
+#endif
+}
+
+/* Allocates the context and buffers of one request and builds its job
+ * descriptor, ready to be enqueued at crypto_ctx->desc */
+static int pkha_prep(fsl_crypto_dev_t *c_dev, uint32_t r_id,
+		     ctx_pool_t *ctx_pool, pkha_op_t op,
+		     struct pkc_request *req, crypto_op_ctx_t **ctx_out)
+{
+	crypto_op_ctx_t *crypto_ctx;
+	crypto_mem_info_t *mem_info;
+	int ret;
+
+	crypto_ctx = get_crypto_ctx(ctx_pool);
+	if (unlikely(!crypto_ctx)) {
+		print_error("Mem alloc failed....\n");
+		return -ENOMEM;
+	}
+
+	crypto_ctx->ctx_pool = ctx_pool;
+	mem_info = &crypto_ctx->crypto_mem;
+	mem_info->dev = c_dev;
+	mem_info->pool = c_dev->ring_pairs[r_id].ip_pool;
+
+	switch (op) {
+	case PKHA_MODEXP:
+		pkha_modexp_init_crypto_mem(mem_info);
+		ret = pkha_modexp_cp_req(&req->req_u.rsa_pub_req, mem_info);
+		break;
+	case PKHA_ECMUL:
+		pkha_ecmul_init_crypto_mem(mem_info);
+		ret = pkha_ecmul_cp_req(&req->req_u.keygen, mem_info);
+		break;
+	case PKHA_PRIME_TEST:
+		pkha_prime_init_crypto_mem(mem_info);
+		ret = pkha_prime_cp_req(&req->req_u.rsa_pub_req, mem_info);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+	if (ret) {
+		free_crypto_ctx(ctx_pool, crypto_ctx);
+		return ret;
+	}
+
+	/* Convert the buffers to dev */
+	host_to_dev(mem_info);
+#ifdef SEC_DMA
+	map_crypto_mem(mem_info);
+#endif
+
+	switch (op) {
+	case PKHA_MODEXP:
+		constr_pkha_modexp_desc(mem_info);
+		break;
+	case PKHA_ECMUL:
+		constr_pkha_ecmul_desc(mem_info, ECC_BINARY == req->curve_type);
+		break;
+	case PKHA_PRIME_TEST:
+		constr_pkha_prime_desc(mem_info);
+		break;
+	}
+
+	store_priv_data(mem_info->buffers[BT_DESC].v_mem,
+			(unsigned long)crypto_ctx);
+
+#ifdef USE_HOST_DMA
+	mem_info->dest_buff_dma =
+	    mem_info->buffers[BT_DESC].dev_buffer.h_map_p_addr;
+#endif
+#ifndef SEC_DMA
+#ifndef USE_HOST_DMA
+	memcpy_to_dev(mem_info);
+#endif
+#endif
+
+	crypto_ctx->req.pkc = req;
+	crypto_ctx->oprn = PKHA;
+	crypto_ctx->rid = r_id;
+	crypto_ctx->op_done = (PKHA_PRIME_TEST == op) ?
+				pkha_prime_test_done : pkha_op_done;
+	crypto_ctx->desc = pkha_ip_addr(mem_info, &mem_info->buffers[BT_DESC]);
+	crypto_ctx->c_dev = c_dev;
+
+	*ctx_out = crypto_ctx;
+	return 0;
+}
+
+/* Releases a prepared request that never reached the ring */
+static void pkha_unprep(crypto_op_ctx_t *crypto_ctx)
+{
+#ifdef SEC_DMA
+	unmap_crypto_mem(&crypto_ctx->crypto_mem);
+#endif
+	dealloc_crypto_mem(&crypto_ctx->crypto_mem);
+	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
+}
+
+int pkha_op_batch(pkha_op_t op, struct pkc_request **reqs, uint32_t nr)
+{
+	crypto_dev_sess_t *c_sess;
+	fsl_crypto_dev_t *c_dev;
+	crypto_op_ctx_t *ctxs[PKHA_BATCH_MAX];
+#ifndef USE_HOST_DMA
+	dev_dma_addr_t descs[PKHA_BATCH_MAX];
+#endif
+	ctx_pool_t *ctx_pool;
+	uint32_t r_id, sess_cnt;
+	uint32_t done = 0, cnt, sent, i;
+	int ret = 0;
+
+	if (!nr)
+		return 0;
+
+	/* All the requests belong to the session of the first one */
+	c_sess = (crypto_dev_sess_t *) crypto_pkc_ctx(crypto_pkc_reqtfm(reqs[0]));
+	r_id = crypto_dev_sess_ring(c_sess, &c_dev);
+#ifndef HIGH_PERF
+	if (-1 == check_device(c_dev))
+		return -1;
+#endif
+
+	sess_cnt = atomic_read(&c_dev->crypto_dev_sess_cnt);
+	ctx_pool = &c_dev->ctx_pool[sess_cnt % NR_CTX_POOLS];
+
+	while (done < nr) {
+		cnt = min_t(uint32_t, nr - done, PKHA_BATCH_MAX);
+
+		for (i = 0; i < cnt; i++) {
+			ret = pkha_prep(c_dev, r_id, ctx_pool, op,
+					reqs[done + i], &ctxs[i]);
+			if (ret)
+				break;
+			if (sess_job_start(ctxs[i], c_sess)) {
+				pkha_unprep(ctxs[i]);
+				ret = -1;
+				break;
+			}
+#ifndef USE_HOST_DMA
+			descs[i] = set_sec_affinity(c_dev, r_id, ctxs[i]->desc);
+#endif
+		}
+		cnt = i;
+
+#ifdef USE_HOST_DMA
+		for (sent = 0; sent < cnt; sent++) {
+			if (-1 == dma_to_dev(get_dma_chnl(),
+					     &ctxs[sent]->crypto_mem,
+					     dma_tx_complete_cb, ctxs[sent])) {
+				print_error("DMA to dev failed....\n");
+				break;
+			}
+		}
+#else
+		sent = cnt ? app_ring_enqueue_batch(c_dev, r_id, descs, ctxs,
+							 cnt) : 0;
+#endif
+		for (i = sent; i < cnt; i++)
+			pkha_unprep(ctxs[i]);
+
+		done += sent;
+		if (ret || sent < cnt)
+			break;
+	}
+
+#ifndef HIGH_PERF
+	atomic_dec(&c_dev->active_jobs);
+#endif
+	if (done)
+		return done;
+
+	return ret ? ret : -EBUSY;
+}
+EXPORT_SYMBOL(pkha_op_batch);
+
+static int pkha_single_op(pkha_op_t op, struct pkc_request *req)
+{
+	int ret = pkha_op_batch(op, &req, 1);
+
+	return (1 == ret) ? -EINPROGRESS : ret;
+}
+
+int pkha_modexp_op(struct pkc_request *req)
+{
+	if (RSA_PUB != req->type)
+		return -EINVAL;
+
+	return pkha_single_op(PKHA_MODEXP, req);
+}
+
+int pkha_ecmul_op(struct pkc_request *req)
+{
+	if (ECC_KEYGEN != req->type)
+		return -EINVAL;
+
+	return pkha_single_op(PKHA_ECMUL, req);
+}
+
+int pkha_prime_test_op(struct pkc_request *req)
+{
+	if (RSA_PUB != req->type)
+		return -EINVAL;
+
+	return pkha_single_op(PKHA_PRIME_TEST, req);
+}
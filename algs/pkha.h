@@ -0,0 +1,62 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FSL_PKC_PKHA_H
+#define FSL_PKC_PKHA_H
+
+/* Requests prepared and handed to the ring under one lock hold */
+#define PKHA_BATCH_MAX	16
+
+typedef enum pkha_op {
+	PKHA_MODEXP,
+	PKHA_ECMUL,
+	PKHA_PRIME_TEST
+} pkha_op_t;
+
+/*******************************************************************************
+ * pkc(modexp) takes RSA_PUB requests:	g = f ^ e mod n
+ * pkc(ecmul) takes ECC_KEYGEN requests:	pub_key = priv_key . g
+ *	over the curve given by q and ab, curve_type ECC_PRIME or ECC_BINARY
+ * pkc(prime_test) takes RSA_PUB requests:	n is the candidate and e the
+ *	one byte round count. Completes with 0 for a probable prime and
+ *	-EBADMSG for a composite.
+ *
+ * pkha_op_batch() submits nr requests of the same tfm with a single ring
+ * doorbell. Returns how many were accepted, each of them completes through
+ * its callback, or an error if none was.
+ ******************************************************************************/
+int pkha_op_batch(pkha_op_t op, struct pkc_request **reqs, uint32_t nr);
+
+#endif
@@ -0,0 +1,406 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <linux/crypto.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "common.h"
+#include "fsl_c2x0_crypto_layer.h"
+#include "fsl_c2x0_driver.h"
+#include "algs.h"
+#include "ring_balance.h"
+
+/* A ring is hot when its smoothed occupancy is at least this... */
+#define RB_MIN_OCC	4
+/* ...and its score is this many times the best ring's */
+#define RB_HOT_RATIO	2
+
+static uint32_t ring_balance_ms = 1000;
+module_param(ring_balance_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(ring_balance_ms, "Session to ring rebalancing interval (0: off)");
+
+static struct delayed_work ring_balance_work;
+
+/* Expected time to drain the ring, in periods scaled by 8 */
+static uint32_t ring_score(fsl_h_rsrc_ring_pair_t *rp)
+{
+	return rp->rb_occ / (rp->rb_rate + 1);
+}
+
+static void ring_balance_dev(fsl_crypto_dev_t *c_dev)
+{
+	fsl_h_rsrc_ring_pair_t *rp;
+	uint32_t rid, done, best = 0, best_score = U32_MAX;
+
+	for (rid = 1; rid < c_dev->num_of_rings; rid++) {
+		rp = &c_dev->ring_pairs[rid];
+
+		/* EWMA with 1/8 weight, rb_occ kept scaled by 8 */
+		rp->rb_occ = rp->rb_occ - (rp->rb_occ >> 3) +
+			     ring_occupancy(c_dev, rid);
+		done = be32_to_cpu(rp->s_c_counters->jobs_processed);
+		rp->rb_rate = done - rp->rb_done;
+		rp->rb_done = done;
+
+		if (!atomic_read(&rp->block) && ring_score(rp) < best_score) {
+			best_score = ring_score(rp);
+			best = rid;
+		}
+	}
+
+	for (rid = 1; rid < c_dev->num_of_rings; rid++) {
+		rp = &c_dev->ring_pairs[rid];
+		atomic_set(&rp->rb_move, rid != best &&
+			   rp->rb_occ >= (RB_MIN_OCC << 3) &&
+			   ring_score(rp) > RB_HOT_RATIO * best_score);
+	}
+	c_dev->rb_target = best;
+}
+
+static void ring_balance(struct work_struct *work)
+{
+	fsl_crypto_dev_t *c_dev;
+	uint32_t i, no_of_devices = get_no_of_devices();
+
+	for (i = 1; i <= no_of_devices; i++) {
+		c_dev = get_crypto_dev(i);
+		if (c_dev && c_dev->num_of_rings > 2 && device_alive(c_dev))
+			ring_balance_dev(c_dev);
+	}
+
+	schedule_delayed_work(&ring_balance_work,
+			      msecs_to_jiffies(ring_balance_ms));
+}
+
+/* Completions of an ordered striped session that may be held back */
+#define SESS_ORDER_WINDOW	512
+
+struct sess_order {
+	spinlock_t lock;
+	/* Oldest request not delivered yet and next one to be submitted */
+	uint32_t head;
+	uint32_t tail;
+	bool delivering;
+	/* Slots kept by requests being resubmitted after a device reset */
+	uint32_t requeued;
+	struct {
+		struct pkc_request *req;
+		int32_t res;
+		bool done;
+		bool requeued;
+	} slot[SESS_ORDER_WINDOW];
+};
+
+/*******************************************************************************
+ * Function     : crypto_dev_sess_ring
+ *
+ * Arguments    : c_sess - session of the request being submitted
+ *		  c_dev  - returns the device to post the request on
+ *
+ * Return Value : Ring to post the request on
+ *
+ * Description  : A striped session takes the least loaded device and ring
+ *		  for every request. Otherwise rebinds the session to another
+ *		  alive device when its own is dead or being reset, moves it
+ *		  off a ring being reconfigured, or moves the session to the
+ *		  device's target ring when its ring is hot and still has a
+ *		  move to give away in this interval.
+ *
+ ******************************************************************************/
+uint32_t crypto_dev_sess_ring(crypto_dev_sess_t *c_sess,
+			      fsl_crypto_dev_t **c_dev)
+{
+	fsl_crypto_dev_t *dev = c_sess->c_dev;
+	uint32_t rid = c_sess->r_id;
+	uint32_t target;
+
+	if (c_sess->striped) {
+		*c_dev = get_device_ll(&rid);
+		if (*c_dev)
+			return rid;
+		rid = c_sess->r_id;
+	}
+
+	*c_dev = dev;
+
+	if (unlikely(!device_alive(dev))) {
+		dev = get_device_rr();
+		target = (dev && dev != *c_dev) ? get_ring_rr(dev) : 0;
+		if (target) {
+			print_debug("Session %p failed over to device %d ring %d\n",
+				    c_sess, dev->config->dev_no, target);
+			c_sess->c_dev = *c_dev = dev;
+			c_sess->r_id = rid = target;
+		}
+		return rid;
+	}
+
+	/* Leave a ring being reconfigured. Jobs of an ordered session that
+	 * are still on it complete first, new ones meet the blocked ring */
+	if (unlikely(atomic_read(&dev->ring_pairs[rid].block)) &&
+	    (c_sess->unordered || !atomic_read(&c_sess->inflight))) {
+		target = get_ring_rr(dev);
+		if (target) {
+			print_debug("Session %p left blocked ring %d for %d\n",
+				    c_sess, rid, target);
+			c_sess->r_id = rid = target;
+		}
+		return rid;
+	}
+
+	target = dev->rb_target;
+
+	if (!target || target == rid ||
+	    !atomic_read(&dev->ring_pairs[rid].rb_move) ||
+	    atomic_read(&dev->ring_pairs[target].block))
+		return rid;
+
+	/* Jobs on the old ring could complete after ones on the new ring */
+	if (!c_sess->unordered && atomic_read(&c_sess->inflight))
+		return rid;
+
+	if (1 == atomic_cmpxchg(&dev->ring_pairs[rid].rb_move, 1, 0)) {
+		print_debug("Session %p moved from ring %d to %d\n", c_sess,
+			    rid, target);
+		c_sess->r_id = rid = target;
+	}
+
+	return rid;
+}
+
+/* For callers that do not rely on completion order within the tfm */
+void crypto_dev_sess_set_unordered(struct crypto_pkc *tfm)
+{
+	crypto_dev_sess_t *c_sess = crypto_pkc_ctx(tfm);
+
+	c_sess->unordered = true;
+}
+EXPORT_SYMBOL(crypto_dev_sess_set_unordered);
+
+/*******************************************************************************
+ * Function     : crypto_dev_sess_set_striped
+ *
+ * Arguments    : tfm     - PKC transform with no request in flight
+ *		  ordered - deliver the completions in submission order
+ *
+ * Return Value : 0 on success, -ENOMEM
+ *
+ * Description  : Spreads the requests of the tfm over all the devices and
+ *		  rings. An ordered tfm holds back a completion until those
+ *		  of all the requests submitted before it are delivered, and
+ *		  refuses a request once SESS_ORDER_WINDOW of them are held.
+ *
+ ******************************************************************************/
+int crypto_dev_sess_set_striped(struct crypto_pkc *tfm, bool ordered)
+{
+	crypto_dev_sess_t *c_sess = crypto_pkc_ctx(tfm);
+
+	if (ordered && !c_sess->order) {
+		c_sess->order = kzalloc(sizeof(*c_sess->order), GFP_KERNEL);
+		if (!c_sess->order)
+			return -ENOMEM;
+		spin_lock_init(&c_sess->order->lock);
+	}
+	c_sess->striped = true;
+	c_sess->unordered = !ordered;
+
+	return 0;
+}
+EXPORT_SYMBOL(crypto_dev_sess_set_striped);
+
+void crypto_dev_sess_free(crypto_dev_sess_t *c_sess)
+{
+	kfree(c_sess->order);
+	c_sess->order = NULL;
+}
+
+/* Takes the slot of the next request in submission order, or gives a
+ * resubmitted request back the slot it had */
+int sess_order_add(struct sess_order *order, struct pkc_request *req)
+{
+	uint32_t seq, i;
+
+	spin_lock_bh(&order->lock);
+	if (order->requeued) {
+		for (seq = order->head; seq != order->tail; seq++) {
+			i = seq % SESS_ORDER_WINDOW;
+			if (order->slot[i].req == req &&
+			    order->slot[i].requeued) {
+				order->slot[i].requeued = false;
+				order->requeued--;
+				spin_unlock_bh(&order->lock);
+				return 0;
+			}
+		}
+	}
+	if (order->tail - order->head >= SESS_ORDER_WINDOW) {
+		spin_unlock_bh(&order->lock);
+		return -1;
+	}
+	i = order->tail++ % SESS_ORDER_WINDOW;
+	order->slot[i].req = req;
+	order->slot[i].done = false;
+	spin_unlock_bh(&order->lock);
+
+	return 0;
+}
+
+/*
+ * Marks the request done and delivers every completion no longer held back
+ * by an earlier request. A single context delivers at a time so that the
+ * completions are called in order even when responses of different devices
+ * are handled in parallel.
+ */
+static void sess_order_done(struct sess_order *order, struct pkc_request *req,
+			    int32_t res, bool deliver)
+{
+	struct pkc_request *r;
+	uint32_t seq, i = 0;
+
+	spin_lock_bh(&order->lock);
+	for (seq = order->head; seq != order->tail; seq++) {
+		i = seq % SESS_ORDER_WINDOW;
+		if (order->slot[i].req == req && !order->slot[i].done)
+			break;
+	}
+
+	if (seq == order->tail) {
+		/* Not submitted through the window, nothing to wait for */
+		spin_unlock_bh(&order->lock);
+		if (deliver)
+			pkc_request_complete(req, res);
+		return;
+	}
+
+	order->slot[i].done = true;
+	order->slot[i].res = res;
+	if (order->slot[i].requeued) {
+		order->slot[i].requeued = false;
+		order->requeued--;
+	}
+	if (!deliver)
+		order->slot[i].req = NULL;
+
+	if (order->delivering) {
+		spin_unlock_bh(&order->lock);
+		return;
+	}
+
+	order->delivering = true;
+	while (order->head != order->tail &&
+	       order->slot[order->head % SESS_ORDER_WINDOW].done) {
+		i = order->head++ % SESS_ORDER_WINDOW;
+		r = order->slot[i].req;
+		res = order->slot[i].res;
+		order->slot[i].req = NULL;
+		if (!r)
+			continue;
+		spin_unlock_bh(&order->lock);
+		pkc_request_complete(r, res);
+		spin_lock_bh(&order->lock);
+	}
+	order->delivering = false;
+	spin_unlock_bh(&order->lock);
+}
+
+void sess_order_cancel(struct sess_order *order, struct pkc_request *req)
+{
+	sess_order_done(order, req, 0, false);
+}
+
+/* The request is about to be submitted again: it keeps its slot, so its
+ * completion is still delivered after those submitted before it */
+void sess_order_requeue(struct sess_order *order, struct pkc_request *req)
+{
+	uint32_t seq, i;
+
+	spin_lock_bh(&order->lock);
+	for (seq = order->head; seq != order->tail; seq++) {
+		i = seq % SESS_ORDER_WINDOW;
+		if (order->slot[i].req == req && !order->slot[i].done) {
+			if (!order->slot[i].requeued) {
+				order->slot[i].requeued = true;
+				order->requeued++;
+			}
+			break;
+		}
+	}
+	spin_unlock_bh(&order->lock);
+}
+
+/* Completion of the PKC requests coming with a tfm */
+void crypto_dev_sess_complete(struct pkc_request *req, int32_t res)
+{
+	crypto_dev_sess_t *c_sess = crypto_pkc_ctx(crypto_pkc_reqtfm(req));
+
+	if (c_sess->order)
+		sess_order_done(c_sess->order, req, res, true);
+	else
+		pkc_request_complete(req, res);
+}
+
+/*
+ * A request of the session answered on the host, without a job. An ordered
+ * session queues it behind the requests submitted before it and the request
+ * is completed through the window, so -EINPROGRESS is returned in place of
+ * the result. -1 when the window is full, as for a job.
+ */
+int crypto_dev_sess_answer(struct pkc_request *req, int32_t res)
+{
+	crypto_dev_sess_t *c_sess = crypto_pkc_ctx(crypto_pkc_reqtfm(req));
+
+	if (!c_sess->order)
+		return res;
+	if (sess_order_add(c_sess->order, req))
+		return -1;
+
+	sess_order_done(c_sess->order, req, res, true);
+	return -EINPROGRESS;
+}
+
+void ring_balance_start(void)
+{
+	INIT_DELAYED_WORK(&ring_balance_work, ring_balance);
+	if (ring_balance_ms)
+		schedule_delayed_work(&ring_balance_work,
+				      msecs_to_jiffies(ring_balance_ms));
+}
+
+void ring_balance_stop(void)
+{
+	if (ring_balance_ms)
+		cancel_delayed_work_sync(&ring_balance_work);
+}
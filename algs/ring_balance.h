@@ -0,0 +1,69 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FSL_PKC_RING_BALANCE_H
+#define FSL_PKC_RING_BALANCE_H
+
+/*******************************************************************************
+ * A PKC session is bound to a ring by fill_crypto_dev_sess_ctx(). The binding
+ * is only a preference: every ring_balance_ms the rings of each device are
+ * scored by their smoothed occupancy over their completion rate, and a ring
+ * scoring well above the best ring of its device gives away one session per
+ * interval to that best ring. A session moves on its next submission, and
+ * only once all its jobs have completed unless it was marked unordered with
+ * crypto_dev_sess_set_unordered().
+ * A session whose device is dead or being reset moves to another alive
+ * device on its next submission.
+ * A session whose ring is being reconfigured moves to another ring of its
+ * device on its next submission, under the same ordering rule.
+ * A session striped with crypto_dev_sess_set_striped() is not bound at all:
+ * each of its requests goes to the least loaded device and ring, so a single
+ * batch consumer gets the throughput of every card. Its completions are
+ * delivered through crypto_dev_sess_complete(), in submission order if asked.
+ * A request answered without a job (cached result, host computed signature
+ * or software fallback) returns crypto_dev_sess_answer(), which holds it
+ * back behind the earlier requests of an ordered session.
+ ******************************************************************************/
+uint32_t crypto_dev_sess_ring(crypto_dev_sess_t *c_sess,
+			      fsl_crypto_dev_t **c_dev);
+void crypto_dev_sess_set_unordered(struct crypto_pkc *tfm);
+int crypto_dev_sess_set_striped(struct crypto_pkc *tfm, bool ordered);
+void crypto_dev_sess_free(crypto_dev_sess_t *c_sess);
+void crypto_dev_sess_complete(struct pkc_request *req, int32_t res);
+int crypto_dev_sess_answer(struct pkc_request *req, int32_t res);
+void ring_balance_start(void);
+void ring_balance_stop(void);
+
+#endif
@@ -36,6 +36,7 @@
 #include <linux/hw_random.h>
 #include <linux/completion.h>
 #include <linux/atomic.h>
+#include <linux/cpu.h>
 #include "common.h"
 #include "fsl_c2x0_crypto_layer.h"
 #include "fsl_c2x0_driver.h"
@@ -50,22 +51,59 @@
 static struct rng_ctx *r_ctx;
 static struct hwrng *rng;
 
-static int32_t get_device_n_ring(struct rng_ctx *ctx, uint32_t *r_id)
+/* Readers waiting for a refill of their CPU's buffer */
+static DECLARE_WAIT_QUEUE_HEAD(rng_wait);
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0))
+/* Dynamic hotplug state giving each CPU its buffers as it comes online */
+static int rng_hp_state;
+#endif
+
+static uint32_t rng_bufs = 2;
+module_param(rng_bufs, uint, S_IRUGO);
+MODULE_PARM_DESC(rng_bufs, "Random byte buffers per CPU, 2 to 8");
+
+static uint32_t rng_low_wm = RN_BUF_SIZE;
+module_param(rng_low_wm, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rng_low_wm, "Bytes left in a CPU's buffers that start their refill");
+
+static uint32_t rng_direct_min = 4 * RN_BUF_SIZE;
+module_param(rng_direct_min, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rng_direct_min, "Reads from this size on are generated in place, 0 disables");
+
+static uint32_t rng_direct_depth = 16;
+module_param(rng_direct_depth, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rng_direct_depth, "Jobs in flight for a read generated in place");
+
+static atomic64_t rng_refills;
+static atomic64_t rng_refill_ns;
+
+static int rng_stats_get(char *buf, const struct kernel_param *kp);
+
+static const struct kernel_param_ops rng_stats_ops = {
+	.get = rng_stats_get,
+};
+module_param_cb(rng_stats, &rng_stats_ops, NULL, S_IRUGO);
+MODULE_PARM_DESC(rng_stats, "Bytes served, reader stalls, refills and mean refill latency");
+
+static fsl_crypto_dev_t *get_device_n_ring(uint32_t *r_id)
 {
-	int32_t ret = -1;
+	fsl_crypto_dev_t *c_dev;
 
-	if (NULL == (ctx->c_dev = get_device_rr())) {
+	if (NULL == (c_dev = get_device_rr())) {
 		print_error("Could not get an active device.\n");
-	} else if (0 == (*r_id = get_ring_rr(ctx->c_dev))) {
+		return NULL;
+	}
+
+	atomic_inc(&c_dev->active_jobs);
+	if (0 == (*r_id = get_ring_rr(c_dev))) {
 		print_error("Could not get an app ring\n");
-	} else 
-		ret = 0;
+		atomic_dec(&c_dev->active_jobs);
+		return NULL;
+	}
 
-	atomic_inc(&ctx->c_dev->active_jobs);
-	return ret;	
-	
+	return c_dev;
 }
-
 static void rng_init_len(crypto_mem_info_t *mem_info)
 {
 	rng_buffers_t *mem = (rng_buffers_t *) (mem_info->buffers);
@@ -112,8 +150,17 @@ static void rng_done(void *ctx, int32_t res)
 
 	dealloc_crypto_mem(&(crypto_ctx->crypto_mem));
 
-	atomic_set(&crypto_ctx->req.rng->empty, BUF_NOT_EMPTY);
+	atomic64_inc(&rng_refills);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(),
+					   crypto_ctx->req.rng->stamp)),
+		     &rng_refill_ns);
+
+	/* A failed job left no random bytes behind. Release: a reader that
+	 * sees the buffer full must also see its bytes */
+	atomic_set_release(&crypto_ctx->req.rng->empty,
+			   res ? BUF_EMPTY : BUF_NOT_EMPTY);
 	complete(&crypto_ctx->req.rng->filled);
+	wake_up(&rng_wait);
 
 	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
 }
@@ -143,39 +190,37 @@ static void constr_rng_desc(crypto_mem_info_t *mem_info, struct rng_ctx *ctx)
 	change_desc_endianness(desc_buff, desc, desc_len(desc));
 }
 
-static int submit_job(struct rng_ctx *ctx, int to_current)
+/* Builds the job filling RN_BUF_SIZE bytes at out on the next device and
+ * ring; the caller sets the request and callback and calls rng_enqueue() */
+static crypto_op_ctx_t *rng_prepare(struct rng_ctx *ctx, uint8_t *out)
 {
-	int32_t ret = 0;
-	struct buf_data *bd = &ctx->bufs[!(to_current ^ ctx->current_buf)];
+	fsl_crypto_dev_t *c_dev = NULL;
 	crypto_op_ctx_t *crypto_ctx = NULL;
 	uint32_t r_id = 0;
-	dev_dma_addr_t sec_dma = 0;
 	rng_buffers_t *rng_buffs = NULL;
 
-	if (get_device_n_ring(ctx, &r_id))
-		return -1;
+	c_dev = get_device_n_ring(&r_id);
+	if (!c_dev)
+		return NULL;
 
-	crypto_ctx = get_crypto_ctx(ctx->c_dev->ctx_pool);
+	crypto_ctx = get_crypto_ctx(c_dev->ctx_pool);
 	print_debug("crypto_ctx addr: %p\n", crypto_ctx);
 
 	if (unlikely(!crypto_ctx)) {
 		print_error("Mem alloc failed....\n");
-		ret = -ENOMEM;
 		goto error;
 	}
 
-	crypto_ctx->ctx_pool = ctx->c_dev->ctx_pool;
-	crypto_ctx->crypto_mem.dev = ctx->c_dev;
-	crypto_ctx->crypto_mem.pool = ctx->c_dev->ring_pairs[r_id].ip_pool;
+	crypto_ctx->ctx_pool = c_dev->ctx_pool;
+	crypto_ctx->crypto_mem.dev = c_dev;
+	crypto_ctx->crypto_mem.pool = c_dev->ring_pairs[r_id].ip_pool;
 	print_debug("IP Buffer pool address: %p\n", crypto_ctx->crypto_mem.pool);
 
 	rng_init_crypto_mem(&crypto_ctx->crypto_mem);
 	rng_buffs = (rng_buffers_t *) crypto_ctx->crypto_mem.buffers;
 
-	if (-ENOMEM == rng_cp_output(bd->buf, &crypto_ctx->crypto_mem)) {
-		ret = -ENOMEM;
+	if (-ENOMEM == rng_cp_output(out, &crypto_ctx->crypto_mem))
 		goto error;
-	}
 
 	print_debug("RNG mem complete.....\n");
 
@@ -188,8 +233,6 @@ static int submit_job(struct rng_ctx *ctx, int to_current)
 	constr_rng_desc(&crypto_ctx->crypto_mem, ctx);
 	print_debug("Desc constr complete...\n");
 
-	sec_dma = rng_buffs->desc_buff.dev_buffer.d_p_addr;
-
 	/* Store the context */
 	print_debug("[Enq]Desc addr: %llx Hbuff addr: %p Crypto ctx:%p\n",
 	     (uint64_t)rng_buffs->desc_buff.dev_buffer.d_p_addr,
@@ -200,140 +243,421 @@ static int submit_job(struct rng_ctx *ctx, int to_current)
 
 	memcpy_to_dev(&crypto_ctx->crypto_mem);
 
-	crypto_ctx->req.rng = bd;
 	crypto_ctx->rid = r_id;
-	crypto_ctx->desc = sec_dma;
-	crypto_ctx->c_dev = ctx->c_dev;
+	crypto_ctx->desc = rng_buffs->desc_buff.dev_buffer.d_p_addr;
+	crypto_ctx->c_dev = c_dev;
+
+	return crypto_ctx;
+
+error:
+	atomic_dec(&c_dev->active_jobs);
+	if (crypto_ctx) {
+		if (crypto_ctx->crypto_mem.buffers)
+			dealloc_crypto_mem(&crypto_ctx->crypto_mem);
+
+		free_crypto_ctx(c_dev->ctx_pool, crypto_ctx);
+	}
+
+	return NULL;
+}
+
+/* The job may complete before this returns; on failure it is freed */
+static int rng_enqueue(crypto_op_ctx_t *crypto_ctx)
+{
+	fsl_crypto_dev_t *c_dev = crypto_ctx->c_dev;
+	dev_dma_addr_t sec_dma;
+
+	sec_dma = set_sec_affinity(c_dev, crypto_ctx->rid, crypto_ctx->desc);
+	atomic_dec(&c_dev->active_jobs);
+	if (-1 == app_ring_enqueue(c_dev, crypto_ctx->rid, sec_dma)) {
+		print_error("Application Ring Enqueue Failed\n");
+		dealloc_crypto_mem(&crypto_ctx->crypto_mem);
+		free_crypto_ctx(c_dev->ctx_pool, crypto_ctx);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Starts filling bd with random bytes; rng_done() marks it full */
+static int submit_job(struct rng_ctx *ctx, struct buf_data *bd)
+{
+	crypto_op_ctx_t *crypto_ctx = rng_prepare(ctx, bd->buf);
+
+	if (!crypto_ctx)
+		return -1;
 
+	crypto_ctx->req.rng = bd;
 	crypto_ctx->op_done = rng_done;
 
-	print_debug("submitting job %d\n", !(to_current ^ ctx->current_buf));
 	init_completion(&bd->filled);
+	/* Pending before the job can complete */
+	atomic_set(&bd->empty, BUF_PENDING);
+	bd->stamp = ktime_get();
 
-	sec_dma = set_sec_affinity(ctx->c_dev, r_id, sec_dma);
-	atomic_dec(&ctx->c_dev->active_jobs);
-	if (-1 == app_ring_enqueue(ctx->c_dev, r_id, sec_dma)) {
-		print_error("Application Ring Enqueue Failed\n");
+	if (-1 == rng_enqueue(crypto_ctx)) {
+		atomic_set(&bd->empty, BUF_EMPTY);
 		complete(&bd->filled);	/* don't wait on failed job */
-		ret = -1;
-		goto error1;
-	} else {
-		atomic_inc(&bd->empty);	/* note if pending */
+		return -1;
 	}
 
 	return 0;
+}
 
-error:
-	atomic_dec(&ctx->c_dev->active_jobs);
-error1:
-	if (crypto_ctx) {
-		if (crypto_ctx->crypto_mem.buffers)
-			dealloc_crypto_mem(&crypto_ctx->crypto_mem);
+static void rng_direct_done(void *ctx, int32_t res)
+{
+	crypto_op_ctx_t *crypto_ctx = ctx;
+	struct rng_direct *rd = crypto_ctx->req.rng_direct;
 
-		free_crypto_ctx(ctx->c_dev->ctx_pool, crypto_ctx);
+	dealloc_crypto_mem(&(crypto_ctx->crypto_mem));
+
+	if (res)
+		atomic_set(&rd->failed, 1);
+	/* rd is gone once the reader sees its last job done */
+	atomic_dec(&rd->pending);
+	wake_up(&rng_wait);
+
+	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
+}
+
+/*******************************************************************************
+ * Function     : rng_read_direct
+ *
+ * Arguments    : ctx - RNG context
+ *		  data - destination, in the kernel linear mapping
+ *		  len - bytes wanted
+ *
+ * Return Value : Bytes filled from the start of data, 0 if a job failed
+ *
+ * Description  : Fills the whole RN_BUF_SIZE chunks of data in place, each
+ *		  chunk a job of its own mapped straight onto the caller's
+ *		  memory. The jobs go round robin over the devices and their
+ *		  rings, up to rng_direct_depth at a time. Sleeps until every
+ *		  job is done, as the device writes into data until then.
+ *
+ ******************************************************************************/
+static size_t rng_read_direct(struct rng_ctx *ctx, uint8_t *data, size_t len)
+{
+	struct rng_direct rd;
+	crypto_op_ctx_t *crypto_ctx;
+	size_t off;
+
+	atomic_set(&rd.pending, 0);
+	atomic_set(&rd.failed, 0);
+
+	len -= len % RN_BUF_SIZE;
+	for (off = 0; off < len; off += RN_BUF_SIZE) {
+		wait_event(rng_wait, atomic_read(&rd.pending) <
+				     max_t(uint32_t, rng_direct_depth, 1));
+		if (atomic_read(&rd.failed))
+			break;
+
+		crypto_ctx = rng_prepare(ctx, data + off);
+		if (!crypto_ctx)
+			break;
+
+		crypto_ctx->req.rng_direct = &rd;
+		crypto_ctx->op_done = rng_direct_done;
+
+		atomic_inc(&rd.pending);
+		if (-1 == rng_enqueue(crypto_ctx)) {
+			atomic_dec(&rd.pending);
+			break;
+		}
 	}
 
-	return ret;
+	wait_event(rng_wait, !atomic_read(&rd.pending));
+	return atomic_read(&rd.failed) ? 0 : off;
+}
+
+/* Large reads of DMA-able memory are generated in place */
+static bool rng_direct_ok(uint8_t *data, size_t len)
+{
+	return rng_direct_min && len >= rng_direct_min &&
+	       len >= RN_BUF_SIZE && virt_addr_valid(data) &&
+	       virt_addr_valid(data + len - 1);
+}
+
+/* Sends the empty buffers for refill once the bytes left to read on the
+ * CPU fall to the low watermark, or at once when the reader is out of
+ * buffers to move on to */
+static void rng_prefetch(struct rng_ctx *ctx, struct rng_cache *cache)
+{
+	uint32_t left = 0;
+	unsigned int i;
+
+	for (i = 0; i < cache->nr; i++)
+		if (BUF_NOT_EMPTY == atomic_read(&cache->bufs[
+				(cache->cur + i) % cache->nr]->empty))
+			left += RN_BUF_SIZE;
+	if (left && BUF_NOT_EMPTY == atomic_read(&cache->bufs[cache->cur]->empty))
+		left -= cache->idx;
+
+	if (left > rng_low_wm &&
+	    BUF_EMPTY != atomic_read(&cache->bufs[cache->cur]->empty))
+		return;
+
+	for (i = 0; i < cache->nr; i++)
+		if (BUF_EMPTY == atomic_read(&cache->bufs[i]->empty))
+			submit_job(ctx, cache->bufs[i]);
+}
+
+/*******************************************************************************
+ * Function     : rng_cache_read
+ *
+ * Arguments    : ctx - RNG context
+ *		  data - destination
+ *		  max - bytes wanted
+ *		  stall - set to the buffer to wait for when it is not full
+ *
+ * Return Value : Bytes copied. 0 with no stall buffer when the CPU has
+ *		  no buffers
+ *
+ * Description  : Copies from the buffers of the local CPU, in rotation, with
+ *		  preemption off and no lock: the completion path only ever
+ *		  flips the state of a buffer from pending to full or empty.
+ *		  Refills are started ahead by rng_prefetch().
+ *
+ ******************************************************************************/
+static size_t rng_cache_read(struct rng_ctx *ctx, uint8_t *data, size_t max,
+			     struct buf_data **stall)
+{
+	struct rng_cache *cache = get_cpu_ptr(ctx->caches);
+	struct buf_data *bd;
+	size_t copied = 0, len;
+
+	/* Pairs with the release in rng_cache_alloc() */
+	if (!smp_load_acquire(&cache->nr)) {
+		put_cpu_ptr(ctx->caches);
+		return 0;
+	}
+
+	while (copied < max) {
+		bd = cache->bufs[cache->cur];
+		if (BUF_NOT_EMPTY != atomic_read_acquire(&bd->empty)) {
+			*stall = bd;
+			cache->stalls++;
+			break;
+		}
+
+		len = min(max - copied, (size_t)(RN_BUF_SIZE - cache->idx));
+		memcpy(data + copied, bd->buf + cache->idx, len);
+		copied += len;
+		cache->idx += len;
+
+		if (RN_BUF_SIZE == cache->idx) {
+			/* The copy is done before the refill can overwrite */
+			atomic_set_release(&bd->empty, BUF_EMPTY);
+			cache->cur = (cache->cur + 1) % cache->nr;
+			cache->idx = 0;
+		}
+	}
+
+	cache->bytes += copied;
+	rng_prefetch(ctx, cache);
+	put_cpu_ptr(ctx->caches);
+	return copied;
+}
+
+static int rng_stats_get(char *buf, const struct kernel_param *kp)
+{
+	struct rng_cache *cache;
+	unsigned long bytes = 0, stalls = 0;
+	u64 refills = atomic64_read(&rng_refills);
+	u64 ns = atomic64_read(&rng_refill_ns);
+	int cpu;
+
+	if (r_ctx && r_ctx->caches) {
+		for_each_possible_cpu(cpu) {
+			cache = per_cpu_ptr(r_ctx->caches, cpu);
+			bytes += cache->bytes;
+			stalls += cache->stalls;
+		}
+	}
+
+	return sprintf(buf, "bytes %lu\nstalls %lu\nrefills %llu\nrefill_ns %llu\n",
+		       bytes, stalls, refills,
+		       refills ? div64_u64(ns, refills) : 0);
 }
 
 static int rng_read(struct hwrng *rng, void *data, size_t max, bool wait)
 {
 	struct rng_ctx *ctx = r_ctx;
-	struct buf_data *bd = &ctx->bufs[ctx->current_buf];
-	int next_buf_idx, copied_idx;
-	int err;
-	spin_lock(&ctx->ctx_lock);
-
-	if (atomic_read(&bd->empty)) {
-		/* try to submit job if there wasn't one */
-		if (atomic_read(&bd->empty) == BUF_EMPTY) {
-			err = submit_job(ctx, 1);
-			/* if can't submit job, can't even wait */
-			if (err)
-				return 0;
-		}
-		/* no immediate data, so exit if not waiting */
-		if (!wait)
-			return 0;
+	struct buf_data *stall = NULL;
+	size_t copied;
 
-		/* waiting for pending job */
-		if (atomic_read(&bd->empty))
-			wait_for_completion(&bd->filled);
+	if (wait && rng_direct_ok(data, max)) {
+		copied = rng_read_direct(ctx, data, max);
+		if (copied)
+			return copied;
 	}
 
-	next_buf_idx = ctx->cur_buf_idx + max;
-	print_debug("start reading at buffer %d, idx %d\n", ctx->current_buf,
-		    ctx->cur_buf_idx);
+	for (;;) {
+		copied = rng_cache_read(ctx, data, max, &stall);
+		if (copied || !wait || !stall)
+			return copied;
 
-	/* if enough data in current buffer */
-	if (next_buf_idx < RN_BUF_SIZE) {
-		memcpy(data, bd->buf + ctx->cur_buf_idx, max);
-		ctx->cur_buf_idx = next_buf_idx;
-		spin_unlock(&ctx->ctx_lock);
-		return max;
+		/* A failed refill leaves the buffer empty, don't retry it */
+		if (wait_event_interruptible(rng_wait,
+				BUF_PENDING != atomic_read(&stall->empty)) ||
+		    BUF_EMPTY == atomic_read(&stall->empty))
+			return 0;
 	}
+}
 
-	/* else, copy what's left... */
-	copied_idx = RN_BUF_SIZE - ctx->cur_buf_idx;
-	memcpy(data, bd->buf + ctx->cur_buf_idx, copied_idx);
-	ctx->cur_buf_idx = 0;
-	atomic_set(&bd->empty, BUF_EMPTY);
+/**
+ note: Fills data with len random bytes for in-kernel bulk consumers, such
+       as DRBG seeding; the hwrng core never reads more than a few bytes at
+       a time. Sleeps.
+ data: destination, kmalloc'ed memory is generated in place
+ len: bytes wanted
+ return: 0, or -EAGAIN when no device could supply the bytes
+ */
+int fsl_rng_read(void *data, size_t len)
+{
+	uint8_t *p = data;
+	int ret;
+
+	if (!r_ctx || !r_ctx->caches)
+		return -EAGAIN;
+
+	while (len) {
+		ret = rng_read(rng, p, len, true);
+		if (ret <= 0)
+			return -EAGAIN;
+		p += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(fsl_rng_read);
+
+static void rng_free_caches(struct rng_ctx *ctx)
+{
+	struct rng_cache *cache;
+	struct buf_data *bd;
+	int cpu, i;
 
-	/* ...refill... */
-	submit_job(ctx, 1);
+	if (!ctx->caches)
+		return;
 
-	/* and use next buffer */
-	ctx->current_buf = !ctx->current_buf;
-	print_debug("switched to buffer %d\n", ctx->current_buf);
-	spin_unlock(&ctx->ctx_lock);
-	/* since there already is some data read, don't wait */
-	return copied_idx + rng_read(rng, data + copied_idx, max - copied_idx,
-				     true);
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0))
+	if (rng_hp_state > 0) {
+		cpuhp_remove_state_nocalls(rng_hp_state);
+		rng_hp_state = 0;
+	}
+#endif
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(ctx->caches, cpu);
+		for (i = 0; i < RNG_MAX_BUFS; i++) {
+			bd = cache->bufs[i];
+			if (!bd)
+				continue;
+			wait_event(rng_wait,
+				   BUF_PENDING != atomic_read(&bd->empty));
+			kfree(bd);
+		}
+	}
+
+	free_percpu(ctx->caches);
+	ctx->caches = NULL;
 }
 
 static void rng_cleanup(struct hwrng *rng)
 {
-	int i;
+	rng_free_caches(r_ctx);
+	kfree(r_ctx->sh_desc);
+	r_ctx->sh_desc = NULL;
+}
+
+/* Buffers live near their CPU; they are DMA targets so not percpu memory.
+ * Called on the CPU itself, nr is published last for its readers */
+static int rng_cache_alloc(struct rng_ctx *ctx, unsigned int cpu)
+{
+	struct rng_cache *cache = per_cpu_ptr(ctx->caches, cpu);
 	struct buf_data *bd;
-	spin_lock(&r_ctx->ctx_lock);
-	for (i = 0; i < 2; i++) {
-		bd = &r_ctx->bufs[i];
-		if (atomic_read(&bd->empty) == BUF_PENDING)
-			wait_for_completion(&bd->filled);
+	int i;
+
+	/* Kept over an offline/online cycle */
+	if (cache->nr)
+		return 0;
+
+	for (i = 0; i < rng_bufs; i++) {
+		bd = kzalloc_node(sizeof(*bd), GFP_KERNEL, cpu_to_node(cpu));
+		if (!bd)
+			goto error;
+		atomic_set(&bd->empty, BUF_EMPTY);
+		init_completion(&bd->filled);
+		cache->bufs[i] = bd;
 	}
 
-	kfree(r_ctx->sh_desc);
-	spin_unlock(&r_ctx->ctx_lock);
+	smp_store_release(&cache->nr, rng_bufs);
+	return 0;
+
+error:
+	while (i--) {
+		kfree(cache->bufs[i]);
+		cache->bufs[i] = NULL;
+	}
+	return -ENOMEM;
 }
 
-static int init_buf(struct rng_ctx *ctx, int buf_id)
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0))
+static int rng_cpu_online(unsigned int cpu)
 {
-#ifndef VIRTIO_C2X0
-	struct buf_data *bd = &ctx->bufs[buf_id];
+	return rng_cache_alloc(r_ctx, cpu);
+}
+#endif
 
-	atomic_set(&bd->empty, BUF_EMPTY);
-	if (submit_job(ctx, buf_id == ctx->current_buf))
+/* Only online CPUs get buffers, the ones brought up later get theirs from
+ * the hotplug state on kernels that have it. Nothing is filled here: the
+ * first read on a CPU starts its refills */
+static int rng_alloc_caches(struct rng_ctx *ctx)
+{
+	int ret = 0;
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(4, 10, 0))
+	int cpu;
+#endif
+
+	ctx->caches = alloc_percpu(struct rng_cache);
+	if (!ctx->caches)
+		return -1;
+
+	rng_bufs = clamp_t(uint32_t, rng_bufs, 2, RNG_MAX_BUFS);
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0))
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "crypto/rng-fsl:online",
+				rng_cpu_online, NULL);
+	if (ret < 0)
+		return -1;
+	rng_hp_state = ret;
+#else
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		ret = rng_cache_alloc(ctx, cpu);
+		if (ret)
+			break;
+	}
+	put_online_cpus();
+	if (ret)
 		return -1;
-	wait_for_completion(&bd->filled);
 #endif
+
 	return 0;
 }
 
 static int init_rng(struct hwrng *rng)
 {
 	struct rng_ctx *ctx = r_ctx;
-	spin_lock_init(&(ctx->ctx_lock));
 
 	if (-1 == rng_create_sh_desc(ctx))
 		return -1;
 
-	ctx->current_buf = 0;
-	ctx->cur_buf_idx = 0;
-
-	if (-1 == init_buf(ctx, 0))
-		return -1;
-	if (-1 == init_buf(ctx, 1))
+	if (-1 == rng_alloc_caches(ctx)) {
+		rng_cleanup(rng);
 		return -1;
+	}
 
 	return 0;
 }
@@ -371,8 +695,8 @@ int rng_init(void)
 	return 0;
 
 error:
-	rng_cleanup(rng);
 	kfree(rng);
+	rng = NULL;
 error1:
 	kfree(r_ctx);
 error2:
@@ -396,7 +720,7 @@ int32_t process_virtio_rng_job(struct virtio_c2x0_job_ctx *virtio_job)
 	bd = &ctx->bufs[buf_id];
 
 	atomic_set(&bd->empty, BUF_EMPTY);
-	ret = submit_job(ctx, buf_id == ctx->current_buf);
+	ret = submit_job(ctx, bd);
 	if (0 == ret) {
 		wait_for_completion(&bd->filled);
 		ret = copy_to_user(qemu_cmd->u.rng.rng_req.buf, bd->buf,
@@ -423,4 +747,10 @@ void rng_exit(void)
 	return;
 }
 
+int fsl_rng_read(void *data, size_t len)
+{
+	return -EAGAIN;
+}
+EXPORT_SYMBOL(fsl_rng_read);
+
 #endif /* RNG_OFFLOAD */
@@ -50,21 +50,43 @@
 struct buf_data {
 	u8 buf[RN_BUF_SIZE];
 	struct completion filled;
+	ktime_t stamp;		/* refill submission */
 #define BUF_NOT_EMPTY 0
 #define BUF_EMPTY 1
 #define BUF_PENDING 2	/* Empty,but with job pending -don't submit another */
 	atomic_t empty;
 };
 
-/* rng per-device context */
+#define RNG_MAX_BUFS	8
+
+/* rng per-CPU cache: reads are served from bufs[cur] at idx, moving on to
+ * the next of the nr buffers in rotation while drained ones are refilled.
+ * bytes and stalls are statistics of the readers of the CPU */
+struct rng_cache {
+	struct buf_data *bufs[RNG_MAX_BUFS];
+	unsigned int nr;
+	unsigned int cur;
+	unsigned int idx;
+	unsigned long bytes;
+	unsigned long stalls;
+};
+
+/* A read generated in place: jobs in flight and whether any failed */
+struct rng_direct {
+	atomic_t pending;
+	atomic_t failed;
+};
+
+/* rng context */
 struct rng_ctx {
-	fsl_crypto_dev_t *c_dev;
 	u32 *sh_desc;
 	u32 sh_desc_len;
+	struct rng_cache __percpu *caches;
+#ifdef VIRTIO_C2X0
 	unsigned int cur_buf_idx;
 	int current_buf;
 	struct buf_data bufs[2];
-	spinlock_t ctx_lock;
+#endif
 };
 
 extern atomic_t selected_devices;
@@ -104,5 +126,6 @@ static inline void init_rng_sh_desc(u32 *desc)
 
 int rng_init(void);
 void rng_exit(void);
+int fsl_rng_read(void *data, size_t len);
 
 #endif
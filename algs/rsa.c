@@ -34,6 +34,9 @@
  */
 
 #include <linux/crypto.h>
+#ifdef SW_FALLBACK
+#include <linux/mpi.h>
+#endif
 
 #include "common.h"
 #include "fsl_c2x0_crypto_layer.h"
@@ -43,10 +46,14 @@
 #include "desc.h"
 #include "memmgr.h"
 #include "crypto_ctx.h"
+#include "ring_balance.h"
 #ifdef VIRTIO_C2X0
 #include "fsl_c2x0_virtio.h"
 #endif
 #include "dma.h"
+#ifdef PKC_CACHE
+#include "pkc_cache.h"
+#endif
 
 /* Callback test functions */
 typedef void (*rsa_op_cb) (struct pkc_request *, int32_t result);
@@ -58,6 +65,9 @@ static void rsa_op_done(void *ctx, int32_t res)
 
 	print_debug("[RSA OP DONE ]\n");
 
+#ifdef SW_FALLBACK
+	ring_latency_update(crypto_ctx);
+#endif
 	dealloc_crypto_mem(&(crypto_ctx->crypto_mem));
 
 #ifdef VIRTIO_C2X0
@@ -65,6 +75,10 @@ static void rsa_op_done(void *ctx, int32_t res)
 	crypto_ctx->card_status = res;
 	print_debug("Updated card status to %d\n", crypto_ctx->card_status);
 #else
+#ifdef PKC_CACHE
+	if (!res && crypto_ctx->req.pkc->base.tfm)
+		pkc_cache_insert(crypto_ctx->req.pkc);
+#endif
 	rsa_completion_cb(crypto_ctx->req.pkc, res);
 	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
 #endif
@@ -583,6 +597,7 @@ int rsa_op(struct pkc_request *req)
 	int32_t ret = 0;
 	crypto_op_ctx_t *crypto_ctx = NULL;
 	fsl_crypto_dev_t *c_dev = NULL;
+	crypto_dev_sess_t *c_sess = NULL;
 
 	dev_dma_addr_t sec_dma = 0;
 	uint32_t sess_cnt;
@@ -600,13 +615,15 @@ int rsa_op(struct pkc_request *req)
 
 #ifndef VIRTIO_C2X0
 	if (NULL != req->base.tfm) {
-		crypto_dev_sess_t *c_sess;
-
-		rsa_completion_cb = pkc_request_complete;
+		rsa_completion_cb = crypto_dev_sess_complete;
+#ifdef PKC_CACHE
+		/* Same key and input verified recently, no job needed */
+		if ((RSA_PUB == req->type) && !pkc_cache_lookup(req))
+			return crypto_dev_sess_answer(req, 0);
+#endif
 		/* Get the session context from input request */
 		c_sess = (crypto_dev_sess_t *) crypto_pkc_ctx(crypto_pkc_reqtfm(req));
-		c_dev = c_sess->c_dev;
-		r_id = c_sess->r_id;
+		r_id = crypto_dev_sess_ring(c_sess, &c_dev);
 		sess_cnt = atomic_read(&c_dev->crypto_dev_sess_cnt);
 #ifndef HIGH_PERF
 		if (-1 == check_device(c_dev))
@@ -617,20 +634,12 @@ int rsa_op(struct pkc_request *req)
 	else
 #endif
 	{
-	/* By default using first device --
-	 * Logic here will be replaced with LB */
-#ifdef VIRTIO_C2X0
-	c_dev = get_device_rr();
-#else
-	c_dev = get_crypto_dev(1);
-#endif
+	/* Least loaded device and application ring */
+	c_dev = get_device_ll(&r_id);
 	if (!c_dev)
 		return -1;
 
-	/* Choose ring id with round robin. Start ring counter from 1 since
-	 * ring 0 is used for commands */
 	sess_cnt = atomic_inc_return(&c_dev->crypto_dev_sess_cnt);
-	r_id = 1 + sess_cnt % (c_dev->num_of_rings - 1);
 
 #ifndef HIGH_PERF
 	atomic_inc(&c_dev->active_jobs);
@@ -646,9 +655,10 @@ int rsa_op(struct pkc_request *req)
 	crypto_ctx = get_crypto_ctx(ctx_pool);
 	print_debug("crypto_ctx addr: %p\n", crypto_ctx);
 
+	/* Out of contexts and ring full are the transient failures, -EAGAIN */
 	if (unlikely(!crypto_ctx)) {
 		print_error("Mem alloc failed....\n");
-		ret = -ENOMEM;
+		ret = -EAGAIN;
 		goto out_no_ctx;
 	}
 
@@ -820,6 +830,10 @@ int rsa_op(struct pkc_request *req)
 	crypto_ctx->op_done = rsa_op_done;
 	crypto_ctx->desc = sec_dma;
 	crypto_ctx->c_dev = c_dev;
+	if (sess_job_start(crypto_ctx, c_sess)) {
+		ret = -1;
+		goto out_err;
+	}
 #ifdef VIRTIO_C2X0
 	/* Initialise card status as Unfinished */
 	crypto_ctx->card_status = -1;
@@ -828,6 +842,10 @@ int rsa_op(struct pkc_request *req)
 	   job structure for further refernce */
 	virtio_job->ctx = crypto_ctx;
 #endif
+#ifdef SW_FALLBACK
+	crypto_ctx->occ = ring_occupancy(c_dev, r_id);
+	crypto_ctx->stamp = ktime_get();
+#endif
 
 #ifdef USE_HOST_DMA
 	if (-1 ==
@@ -841,8 +859,8 @@ int rsa_op(struct pkc_request *req)
 	print_debug("Before app_ring_enqueue\n");
 	sec_dma = set_sec_affinity(c_dev, r_id, sec_dma);
 	/* Now enqueue the job into the app ring */
-	if (app_ring_enqueue(c_dev, r_id, sec_dma)) {
-		ret = -1;
+	if (app_ring_enqueue_job(c_dev, r_id, sec_dma, crypto_ctx)) {
+		ret = -EAGAIN;
 		goto out_err;
 	}
 #endif
@@ -862,6 +880,92 @@ out_no_ctx:
 	return ret;
 }
 
+#ifdef SW_FALLBACK
+/* Software path, used by the dispatcher when the device is saturated */
+static int rsa_sw_expmod(uint8_t *out, uint32_t out_len,
+			 const uint8_t *in, uint32_t in_len,
+			 const uint8_t *exp, uint32_t exp_len,
+			 const uint8_t *n, uint32_t n_len)
+{
+	MPI m_in, m_exp, m_n, m_out = NULL;
+	uint8_t *buf;
+	unsigned int nbytes;
+	int sign;
+	int ret = -ENOMEM;
+
+	m_in = mpi_read_raw_data(in, in_len);
+	m_exp = mpi_read_raw_data(exp, exp_len);
+	m_n = mpi_read_raw_data(n, n_len);
+	if (!m_in || !m_exp || !m_n)
+		goto out;
+
+	if (mpi_cmp(m_in, m_n) >= 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	m_out = mpi_alloc(0);
+	if (!m_out)
+		goto out;
+
+	ret = mpi_powm(m_out, m_in, m_exp, m_n);
+	if (ret)
+		goto out;
+
+	buf = mpi_get_buffer(m_out, &nbytes, &sign);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* Result is returned left padded to the output length, as SEC does */
+	if (nbytes > out_len) {
+		ret = -EINVAL;
+	} else {
+		memset(out, 0, out_len - nbytes);
+		memcpy(out + out_len - nbytes, buf, nbytes);
+	}
+	kfree(buf);
+out:
+	mpi_free(m_out);
+	mpi_free(m_n);
+	mpi_free(m_exp);
+	mpi_free(m_in);
+	return ret;
+}
+
+/*******************************************************************************
+ * Function     : rsa_sw_op
+ *
+ * Arguments    : req - RSA request
+ *
+ * Return Value : 0 on success, error code otherwise
+ *
+ * Description  : Synchronously computes the request on the CPU using the
+ *		  kernel MPI library. Only public and form1 private key
+ *		  operations are handled, CRT forms stay on the device.
+ *
+ ******************************************************************************/
+int rsa_sw_op(struct pkc_request *req)
+{
+	struct rsa_pub_req_s *pub = &req->req_u.rsa_pub_req;
+	struct rsa_priv_frm1_req_s *priv1 = &req->req_u.rsa_priv_f1;
+
+	switch (req->type) {
+	case RSA_PUB:
+		return rsa_sw_expmod(pub->g, pub->g_len, pub->f, pub->f_len,
+				     pub->e, pub->e_len, pub->n, pub->n_len);
+	case RSA_PRIV_FORM1:
+		return rsa_sw_expmod(priv1->f, priv1->f_len,
+				     priv1->g, priv1->g_len,
+				     priv1->d, priv1->d_len,
+				     priv1->n, priv1->n_len);
+	default:
+		return -EINVAL;
+	}
+}
+#endif
+
 #ifdef VIRTIO_C2X0
 int test_rsa_op(struct pkc_request *req,
 		void (*cb) (struct pkc_request *, int32_t result),
@@ -94,6 +94,10 @@
 #define DESC_ABLKCIPHER_DEC_LEN        (DESC_ABLKCIPHER_BASE + \
 					15 * CAAM_CMD_SZ)
 
+/* skcipher shared descriptors carry the key, xts one holds two */
+#define DESC_SKCIPHER_MAX_LEN          ((DESC_ABLKCIPHER_ENC_LEN + \
+					 2 * AES_MAX_KEY_SIZE) / CAAM_CMD_SZ)
+
 #define DESC_MAX_USED_BYTES            (DESC_AEAD_GIVENC_LEN + \
 					CAAM_MAX_KEY_SIZE)
 #define DESC_MAX_USED_LEN              (DESC_MAX_USED_BYTES / CAAM_CMD_SZ)
@@ -121,6 +125,15 @@ struct sym_ctx {
 	uint32_t alg_op;
 
 	uint32_t sh_desc_len;
+
+	/* skcipher: shared descriptors of the tfm, built by setkey and
+	 * already in device byte order */
+	uint32_t sh_desc_enc[DESC_SKCIPHER_MAX_LEN];
+	uint32_t sh_desc_dec[DESC_SKCIPHER_MAX_LEN];
+	uint32_t sh_desc_enc_len;
+	uint32_t sh_desc_dec_len;
+	/* CPU implementation for the requests SEC does not take */
+	struct crypto_skcipher *fallback;
 };
 
 typedef struct ablkcipher_dev_mem {
@@ -41,6 +41,11 @@
 #include "memmgr.h"
 #include "sg_sw_sec4.h"
 #include "crypto_ctx.h"
+#include "algs_reg.h"
+#ifdef SKCIPHER_OFFLOAD
+#include <asm/unaligned.h>
+#include "ring_balance.h"
+#endif
 #ifdef VIRTIO_C2X0
 #include <crypto/aes.h>
 #include <crypto/sha.h>
@@ -305,10 +310,9 @@ static void create_src_sg_table(symm_ablk_buffers_t *ablk_ctx,
 		sg_map_copy(ablk_ctx->src_sg[i].v_mem, sg, sg->length,
 			    sg->offset);
 #else
-		/* COPY REQ POINTER */
-		/* FIXME: DO WE NEED TO KMAP OF SG PAGE ??? */
-		ablk_ctx->src_sg[i].req_ptr =
-		    (uint8_t *) sg_page(sg) + sg->offset;
+		/* COPY REQ POINTER, UNLESS SEC READS THE BUFF IN PLACE */
+		if (BT_IP == ablk_ctx->src_sg[i].bt)
+			ablk_ctx->src_sg[i].req_ptr = sg_virt(sg);
 #endif
 		ASSIGN64(sec4_sg_ptr->ptr,
 			 ablk_ctx->src_sg[i].dev_buffer.d_p_addr);
@@ -363,7 +367,8 @@ static void fill_sg_len(symm_ablk_buffers_t *ablk_ctx, struct scatterlist *sg,
 	}
 }
 
-static int ablk_init_crypto_mem(crypto_mem_info_t *crypto_mem, uint32_t sgcnt)
+static int ablk_init_crypto_mem(crypto_mem_info_t *crypto_mem, uint32_t sgcnt,
+				gfp_t flags)
 {
 	symm_ablk_buffers_t *ablk_ctx = NULL;
 
@@ -375,7 +380,7 @@ static int ablk_init_crypto_mem(crypto_mem_info_t *crypto_mem, uint32_t sgcnt)
 	print_debug("TOTAL COUNT : %d\n", crypto_mem->count);
 
 	crypto_mem->c_buffers.symm_ablk =
-	    kzalloc(crypto_mem->count * sizeof(buffer_info_t), GFP_KERNEL);
+	    kzalloc(crypto_mem->count * sizeof(buffer_info_t), flags);
 
 	if (!crypto_mem->c_buffers.symm_ablk) {
 		print_error("MEMORY ALLOCATION FAILED!\n");
@@ -483,7 +488,7 @@ static int32_t fsl_ablkcipher(struct ablkcipher_request *req, bool encrypt)
 	dst_sgcnt = sg_count(req->dst, req->nbytes, &dst_chained);
 
 	/* INIT CRYPTO MEMORY */
-	ret = ablk_init_crypto_mem(crypto_mem, src_sgcnt);
+	ret = ablk_init_crypto_mem(crypto_mem, src_sgcnt, GFP_KERNEL);
 	if (-ENOMEM == ret) {
 		goto error;
 	}
@@ -670,3 +675,596 @@ int32_t fsl_ablkcipher_decrypt(struct ablkcipher_request *req)
 	return fsl_ablkcipher(req, false);
 }
 #endif /* VIRTIO_C2X0 */
+
+#ifdef SKCIPHER_OFFLOAD
+/*******************************************************************************
+ * skcipher cbc(aes), ctr(aes) and xts(aes).
+ *
+ * The jobs are built like the ablkcipher ones, but on the shared descriptors
+ * setkey leaves in the tfm, with the key inlined. Requests shorter than
+ * skcipher_min_len, and the ones SEC cannot do, go to the CPU implementation
+ * the tfm allocates as fallback.
+ ******************************************************************************/
+static uint32_t skcipher_min_len = 512;
+module_param(skcipher_min_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(skcipher_min_len, "Shorter skcipher requests are left to the CPU");
+
+/* Data unit of xts; SEC moves on to the next sector past it */
+#define SKC_XTS_SECTOR		(1 << 15)
+
+struct skc_req {
+	/* Next IV of a cbc decryption, before the job overwrites it */
+	uint8_t iv[AES_BLOCK_SIZE];
+	struct skcipher_request fallback;
+};
+
+static inline uint32_t skc_aai(struct sym_ctx *ctx)
+{
+	return ctx->class1_alg_type & OP_ALG_AAI_MASK;
+}
+
+/* change_desc_endianness() stores each word big endian: hand the key over as
+ * the big endian words it is made of to keep its bytes in order */
+static void skc_append_key(uint32_t *desc, struct sym_ctx *ctx)
+{
+	uint32_t key[2 * AES_MAX_KEY_SIZE / CAAM_CMD_SZ];
+	uint32_t i;
+
+	for (i = 0; i < ctx->keylen / CAAM_CMD_SZ; i++)
+		key[i] = get_unaligned_be32(ctx->key + i * CAAM_CMD_SZ);
+
+	append_key_as_imm(desc, key, ctx->keylen, ctx->keylen,
+			  CLASS_1 | KEY_DEST_CLASS_REG);
+}
+
+static void skc_append_iv(uint32_t *desc, struct sym_ctx *ctx)
+{
+	/* Sector size, in device byte order */
+	uint32_t sector[2] = { 0, SKC_XTS_SECTOR };
+
+	switch (skc_aai(ctx)) {
+	case OP_ALG_AAI_XTS:
+		/* Sector size at 0x28, sector index from the first half of
+		 * the iv at 0x20; the second half is zero and skipped */
+		append_load_as_imm(desc, sector, sizeof(sector),
+				   LDST_CLASS_1_CCB | LDST_SRCDST_BYTE_CONTEXT |
+				   (0x28 << LDST_OFFSET_SHIFT));
+		append_cmd(desc, CMD_SEQ_LOAD | LDST_SRCDST_BYTE_CONTEXT |
+			   LDST_CLASS_1_CCB | (0x20 << LDST_OFFSET_SHIFT) | 8);
+		append_seq_fifo_load(desc, 8, FIFOLD_CLASS_SKIP);
+		break;
+	case OP_ALG_AAI_CTR_MOD128:
+		/* Counter in the upper half of the context */
+		append_cmd(desc, CMD_SEQ_LOAD | LDST_SRCDST_BYTE_CONTEXT |
+			   LDST_CLASS_1_CCB | (16 << LDST_OFFSET_SHIFT) |
+			   AES_BLOCK_SIZE);
+		break;
+	default:
+		append_cmd(desc, CMD_SEQ_LOAD | LDST_SRCDST_BYTE_CONTEXT |
+			   LDST_CLASS_1_CCB | AES_BLOCK_SIZE);
+		break;
+	}
+}
+
+static void skc_set_sh_desc(struct sym_ctx *ctx)
+{
+	uint32_t desc[DESC_SKCIPHER_MAX_LEN];
+	uint32_t *key_jump_cmd, *jump_cmd;
+
+	/* Encrypt */
+	init_sh_desc(desc, HDR_SHARE_SERIAL);
+	key_jump_cmd = append_jump(desc, JUMP_JSL | JUMP_TEST_ALL |
+				   JUMP_COND_SHRD);
+	skc_append_key(desc, ctx);
+	set_jump_tgt_here(desc, key_jump_cmd);
+	append_cmd(desc, SET_OK_NO_PROP_ERRORS | CMD_LOAD);
+	skc_append_iv(desc, ctx);
+	append_operation(desc, ctx->class1_alg_type |
+			 OP_ALG_AS_INITFINAL | OP_ALG_ENCRYPT);
+	ablkcipher_append_src_dst(desc);
+
+	ctx->sh_desc_enc_len = desc_len(desc);
+	change_desc_endianness(ctx->sh_desc_enc, desc, ctx->sh_desc_enc_len);
+
+	/* Decrypt */
+	init_sh_desc(desc, HDR_SHARE_SERIAL);
+	key_jump_cmd = append_jump(desc, JUMP_JSL | JUMP_TEST_ALL |
+				   JUMP_COND_SHRD);
+	skc_append_key(desc, ctx);
+	jump_cmd = append_jump(desc, JUMP_TEST_ALL);
+	set_jump_tgt_here(desc, key_jump_cmd);
+	append_cmd(desc, SET_OK_NO_PROP_ERRORS | CMD_LOAD);
+	set_jump_tgt_here(desc, jump_cmd);
+	skc_append_iv(desc, ctx);
+	/* ctr decrypts with the encryption key schedule */
+	if (OP_ALG_AAI_CTR_MOD128 == skc_aai(ctx))
+		append_operation(desc, ctx->class1_alg_type |
+				 OP_ALG_AS_INITFINAL | OP_ALG_DECRYPT);
+	else
+		append_dec_op1(desc, ctx->class1_alg_type);
+	ablkcipher_append_src_dst(desc);
+	append_dec_shr_done(desc);
+
+	ctx->sh_desc_dec_len = desc_len(desc);
+	change_desc_endianness(ctx->sh_desc_dec, desc, ctx->sh_desc_dec_len);
+}
+
+static int skc_setkey(struct crypto_skcipher *skcipher, const uint8_t *key,
+		      unsigned int keylen)
+{
+	crypto_dev_sess_t *c_sess = crypto_skcipher_ctx(skcipher);
+	struct sym_ctx *ctx = &c_sess->u.symm;
+	int err;
+
+	/* The CPU implementation checks the key for both */
+	crypto_skcipher_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_skcipher_set_flags(ctx->fallback,
+				  crypto_skcipher_get_flags(skcipher) &
+				  CRYPTO_TFM_REQ_MASK);
+	err = crypto_skcipher_setkey(ctx->fallback, key, keylen);
+	if (err)
+		return err;
+
+	/* No xts with aes-192 in SEC, such keys stay with the CPU */
+	ctx->keylen = 0;
+	if (OP_ALG_AAI_XTS == skc_aai(ctx) && 2 * AES_KEYSIZE_192 == keylen)
+		return 0;
+
+	memcpy(ctx->key, key, keylen);
+	ctx->keylen = keylen;
+	skc_set_sh_desc(ctx);
+
+	return 0;
+}
+
+/* The output iv: last cipher block for cbc, counter past the data for ctr */
+static void skc_iv_out(struct skcipher_request *req, bool encrypt)
+{
+	struct crypto_skcipher *skcipher = crypto_skcipher_reqtfm(req);
+	crypto_dev_sess_t *c_sess = crypto_skcipher_ctx(skcipher);
+	struct skc_req *sreq = skcipher_request_ctx(req);
+	u64 lo, n;
+
+	switch (skc_aai(&c_sess->u.symm)) {
+	case OP_ALG_AAI_CBC:
+		if (encrypt)
+			scatterwalk_map_and_copy(req->iv, req->dst,
+						 req->cryptlen - AES_BLOCK_SIZE,
+						 AES_BLOCK_SIZE, 0);
+		else
+			memcpy(req->iv, sreq->iv, AES_BLOCK_SIZE);
+		break;
+	case OP_ALG_AAI_CTR_MOD128:
+		n = DIV_ROUND_UP(req->cryptlen, AES_BLOCK_SIZE);
+		lo = get_unaligned_be64(req->iv + 8);
+		put_unaligned_be64(lo + n, req->iv + 8);
+		if (lo + n < lo)
+			put_unaligned_be64(get_unaligned_be64(req->iv) + 1,
+					   req->iv);
+		break;
+	}
+}
+
+static void skc_op_done(void *ctx, int32_t res)
+{
+	bool dst_chained = false;
+	uint32_t dst_sgcnt = 0;
+	crypto_op_ctx_t *crypto_ctx = ctx;
+	struct skcipher_request *req = crypto_ctx->req.skc;
+	struct pci_dev *pci_dev = crypto_ctx->c_dev->priv_dev->dev;
+
+	dst_sgcnt = sg_count(req->dst, req->cryptlen, &dst_chained);
+	dma_unmap_sg_chained(&pci_dev->dev, req->dst, dst_sgcnt ? : 1,
+			     DMA_BIDIRECTIONAL, dst_chained);
+
+	dealloc_crypto_mem(&crypto_ctx->crypto_mem);
+	kfree(crypto_ctx->crypto_mem.c_buffers.symm_ablk);
+
+	if (res)
+		print_error("skcipher job failed: %x\n", res);
+	else
+		skc_iv_out(req, ABLK_ENCRYPT == crypto_ctx->oprn);
+
+	skcipher_request_complete(req, res ? -EIO : 0);
+	free_crypto_ctx(crypto_ctx->ctx_pool, crypto_ctx);
+}
+
+static int skc_sg_count(struct scatterlist *sg, int nbytes, bool *chained)
+{
+#ifdef SEC_DMA
+	/* Even a single entry is read in place rather than copied */
+	return __sg_count(sg, nbytes, chained);
+#else
+	return sg_count(sg, nbytes, chained);
+#endif
+}
+
+/* Returns -EINPROGRESS once the job is on the ring, -1 or -ENOMEM if the
+ * request has to go to the CPU */
+static int skc_submit(struct skcipher_request *req, bool encrypt)
+{
+	struct crypto_skcipher *skcipher = crypto_skcipher_reqtfm(req);
+	crypto_dev_sess_t *c_sess = crypto_skcipher_ctx(skcipher);
+	struct sym_ctx *ctx = &c_sess->u.symm;
+	struct skc_req *sreq = skcipher_request_ctx(req);
+	uint32_t ivsize = crypto_skcipher_ivsize(skcipher);
+	uint32_t r_id = c_sess->r_id;
+	fsl_crypto_dev_t *c_dev = c_sess->c_dev;
+	struct pci_dev *pci_dev = c_dev->priv_dev->dev;
+	gfp_t flags = (req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP) ?
+	    GFP_KERNEL : GFP_ATOMIC;
+	crypto_op_ctx_t *crypto_ctx = NULL;
+	crypto_mem_info_t *crypto_mem = NULL;
+	symm_ablk_buffers_t *ablk_ctx = NULL;
+	dev_dma_addr_t sec_dma = 0, src_dma = 0, dst_dma = 0;
+	uint32_t out_options = 0, in_options = 0;
+	uint32_t src_sgcnt = 0, dst_sgcnt = 0;
+	bool src_chained = false, dst_chained = false, dst_mapped = false;
+	uint32_t desc[DESC_JOB_IO_LEN / CAAM_CMD_SZ];
+	uint32_t *sh_desc = encrypt ? ctx->sh_desc_enc : ctx->sh_desc_dec;
+	uint32_t sh_desc_len = encrypt ? ctx->sh_desc_enc_len :
+	    ctx->sh_desc_dec_len;
+#ifdef SEC_DMA
+	struct scatterlist *sg;
+	uint32_t i;
+#endif
+	int32_t ret = 0;
+
+	if (-1 == check_device(c_dev))
+		return -1;
+
+	crypto_ctx = get_crypto_ctx(c_dev->ctx_pool);
+	if (unlikely(!crypto_ctx)) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	crypto_ctx->ctx_pool = c_dev->ctx_pool;
+	crypto_ctx->crypto_mem.dev = c_dev;
+	crypto_ctx->crypto_mem.pool = c_dev->ring_pairs[r_id].ip_pool;
+	crypto_mem = &crypto_ctx->crypto_mem;
+
+	src_sgcnt = skc_sg_count(req->src, req->cryptlen, &src_chained);
+	dst_sgcnt = sg_count(req->dst, req->cryptlen, &dst_chained);
+
+	ret = ablk_init_crypto_mem(crypto_mem, src_sgcnt, flags);
+	if (-ENOMEM == ret)
+		goto error;
+
+	ablk_ctx = crypto_mem->c_buffers.symm_ablk;
+	ablk_ctx->desc.len = DESC_JOB_IO_LEN;
+	ablk_ctx->sh_desc.len = sh_desc_len * CAAM_CMD_SZ;
+	/* The key is inlined in the shared descriptor */
+	ablk_ctx->key.len = 0;
+
+	if (src_sgcnt) {
+		ablk_ctx->info.len = ivsize;
+		ablk_ctx->src.len =
+		    (src_sgcnt + 1) * sizeof(struct sec4_sg_entry);
+		fill_sg_len(ablk_ctx, req->src, src_sgcnt);
+	} else {
+		ablk_ctx->info.len = ivsize + req->cryptlen;
+	}
+
+	if (dst_sgcnt)
+		ablk_ctx->dst.len = dst_sgcnt * sizeof(struct sec4_sg_entry);
+
+#ifdef SEC_DMA
+	for (i = 0; i < src_sgcnt; i++)
+		ablk_ctx->src_sg[i].bt = BT_HOST;
+#endif
+
+	if (-ENOMEM == alloc_crypto_mem(crypto_mem)) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+#ifdef SEC_DMA
+	sg = req->src;
+	for (i = 0; i < src_sgcnt; i++) {
+		ret = map_host_buff(c_dev, &ablk_ctx->src_sg[i], sg);
+		if (ret)
+			goto error;
+		sg = scatterwalk_sg_next(sg);
+	}
+#endif
+
+	host_to_dev(crypto_mem);
+
+	memcpy(ablk_ctx->sh_desc.v_mem, sh_desc, ablk_ctx->sh_desc.len);
+	memcpy(ablk_ctx->info.v_mem, req->iv, ivsize);
+
+	if (!src_sgcnt) {
+		sg_copy(ablk_ctx->info.v_mem + ivsize, req->src, req->cryptlen);
+		src_dma = ablk_ctx->info.dev_buffer.d_p_addr;
+		in_options = 0;
+	} else {
+		dev_dma_to_sec4_sg_one((struct sec4_sg_entry *)ablk_ctx->src.
+				       v_mem,
+				       ablk_ctx->info.dev_buffer.d_p_addr,
+				       ivsize, 0);
+		create_src_sg_table(ablk_ctx, req->src, src_sgcnt);
+		src_dma = ablk_ctx->src.dev_buffer.d_p_addr;
+		in_options = LDST_SGF;
+	}
+
+	dma_map_sg_chained(&pci_dev->dev, req->dst, dst_sgcnt ? : 1,
+			   DMA_BIDIRECTIONAL, dst_chained);
+	dst_mapped = true;
+
+	if (!dst_sgcnt) {
+		dst_dma = (dev_dma_addr_t) sg_dma_address(req->dst) +
+		    c_dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr;
+		out_options = 0;
+	} else {
+		create_dst_sg_table(c_dev, ablk_ctx, req->dst, dst_sgcnt);
+		dst_dma = ablk_ctx->dst.dev_buffer.d_p_addr;
+		out_options = LDST_SGF;
+	}
+
+	init_job_desc_shared(desc, ablk_ctx->sh_desc.dev_buffer.d_p_addr,
+			     sh_desc_len, HDR_SHARE_DEFER | HDR_REVERSE);
+	append_seq_in_ptr(desc, src_dma, req->cryptlen + ivsize, in_options);
+	append_seq_out_ptr(desc, dst_dma, req->cryptlen, out_options);
+	change_desc_endianness((uint32_t *)ablk_ctx->desc.v_mem, desc,
+			       desc_len(desc));
+
+	store_priv_data(ablk_ctx->desc.v_mem, (unsigned long)crypto_ctx);
+	sec_dma = ablk_ctx->desc.dev_buffer.d_p_addr;
+
+	/* In place the job overwrites the block the next iv is */
+	if (!encrypt && OP_ALG_AAI_CBC == skc_aai(ctx))
+		scatterwalk_map_and_copy(sreq->iv, req->src,
+					 req->cryptlen - AES_BLOCK_SIZE,
+					 AES_BLOCK_SIZE, 0);
+
+	crypto_ctx->req.skc = req;
+	crypto_ctx->oprn = encrypt ? ABLK_ENCRYPT : ABLK_DECRYPT;
+	crypto_ctx->rid = r_id;
+	crypto_ctx->op_done = skc_op_done;
+	crypto_ctx->desc = sec_dma;
+	crypto_ctx->c_dev = c_dev;
+
+#ifndef USE_HOST_DMA
+	memcpy_to_dev(crypto_mem);
+	sec_dma = set_sec_affinity(c_dev, r_id, sec_dma);
+	atomic_dec(&c_dev->active_jobs);
+
+	if (app_ring_enqueue(c_dev, r_id, sec_dma)) {
+		ret = -1;
+		goto error1;
+	}
+#else
+	crypto_mem->dest_buff_dma = ablk_ctx->desc.dev_buffer.h_map_p_addr;
+
+	if (-1 == dma_to_dev(get_dma_chnl(), crypto_mem,
+			     dma_tx_complete_cb, crypto_ctx)) {
+		print_error("DMA TO DEV FAILED\n");
+		ret = -1;
+		goto error;
+	}
+#endif
+
+	return -EINPROGRESS;
+
+error:
+	atomic_dec(&c_dev->active_jobs);
+#ifndef USE_HOST_DMA
+error1:
+#endif
+	if (dst_mapped)
+		dma_unmap_sg_chained(&pci_dev->dev, req->dst, dst_sgcnt ? : 1,
+				     DMA_BIDIRECTIONAL, dst_chained);
+
+	if (crypto_ctx) {
+		if (ablk_ctx) {
+			dealloc_crypto_mem(crypto_mem);
+			kfree(ablk_ctx);
+		}
+		free_crypto_ctx(c_dev->ctx_pool, crypto_ctx);
+	}
+	return ret;
+}
+
+/* Short requests, keys and ivs SEC does not take, and dead devices are left
+ * to the CPU */
+static bool skc_use_cpu(struct skcipher_request *req, struct sym_ctx *ctx,
+			fsl_crypto_dev_t *c_dev)
+{
+	if (!ctx->keylen || !c_dev || !device_alive(c_dev) ||
+	    req->cryptlen < skcipher_min_len)
+		return true;
+
+	switch (skc_aai(ctx)) {
+	case OP_ALG_AAI_CTR_MOD128:
+		return false;
+	case OP_ALG_AAI_XTS:
+		if (req->cryptlen > SKC_XTS_SECTOR ||
+		    get_unaligned((u64 *)(req->iv + 8)))
+			return true;
+		break;
+	}
+
+	/* Partial blocks are for the CPU to reject */
+	return req->cryptlen % AES_BLOCK_SIZE;
+}
+
+static int skc_fallback(struct skcipher_request *req, bool encrypt)
+{
+	crypto_dev_sess_t *c_sess =
+	    crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+	struct skc_req *sreq = skcipher_request_ctx(req);
+
+	skcipher_request_set_tfm(&sreq->fallback, c_sess->u.symm.fallback);
+	skcipher_request_set_callback(&sreq->fallback, req->base.flags,
+				      req->base.complete, req->base.data);
+	skcipher_request_set_crypt(&sreq->fallback, req->src, req->dst,
+				   req->cryptlen, req->iv);
+
+	return encrypt ? crypto_skcipher_encrypt(&sreq->fallback) :
+	    crypto_skcipher_decrypt(&sreq->fallback);
+}
+
+static int skc_crypt(struct skcipher_request *req, bool encrypt)
+{
+	crypto_dev_sess_t *c_sess =
+	    crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+	int ret;
+
+	if (!req->cryptlen)
+		return 0;
+
+	if (skc_use_cpu(req, &c_sess->u.symm, c_sess->c_dev))
+		return skc_fallback(req, encrypt);
+
+	/* Ring full or out of pool memory */
+	ret = skc_submit(req, encrypt);
+	if (-EINPROGRESS != ret)
+		return skc_fallback(req, encrypt);
+
+	return ret;
+}
+
+static int skc_encrypt(struct skcipher_request *req)
+{
+	return skc_crypt(req, true);
+}
+
+static int skc_decrypt(struct skcipher_request *req)
+{
+	return skc_crypt(req, false);
+}
+
+static int skc_init(struct crypto_skcipher *skcipher)
+{
+	struct skcipher_alg *alg = crypto_skcipher_alg(skcipher);
+	crypto_dev_sess_t *c_sess = crypto_skcipher_ctx(skcipher);
+	struct sym_ctx *ctx = &c_sess->u.symm;
+
+	ctx->fallback = crypto_alloc_skcipher(alg->base.cra_name, 0,
+					      CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback)) {
+		print_error("%s fallback allocation failed\n",
+			    alg->base.cra_name);
+		return PTR_ERR(ctx->fallback);
+	}
+
+	crypto_skcipher_set_reqsize(skcipher, sizeof(struct skc_req) +
+				    crypto_skcipher_reqsize(ctx->fallback));
+
+	ctx->class1_alg_type = OP_TYPE_CLASS1_ALG | OP_ALG_ALGSEL_AES;
+	if (!strncmp(alg->base.cra_name, "ctr", 3))
+		ctx->class1_alg_type |= OP_ALG_AAI_CTR_MOD128;
+	else if (!strncmp(alg->base.cra_name, "xts", 3))
+		ctx->class1_alg_type |= OP_ALG_AAI_XTS;
+	else
+		ctx->class1_alg_type |= OP_ALG_AAI_CBC;
+
+	/* Without a device all of the requests go to the CPU */
+	if (-1 == fill_crypto_dev_sess_ctx(c_sess, SYMMETRIC))
+		c_sess->c_dev = NULL;
+
+	return 0;
+}
+
+static void skc_exit(struct crypto_skcipher *skcipher)
+{
+	crypto_dev_sess_t *c_sess = crypto_skcipher_ctx(skcipher);
+
+	crypto_free_skcipher(c_sess->u.symm.fallback);
+	crypto_dev_sess_free(c_sess);
+}
+
+#define SKC_CRA_BASE(_name, _driver_name, _blocksize)			\
+	{								\
+		.cra_name = _name,					\
+		.cra_driver_name = _driver_name,			\
+		.cra_priority = FSL_CRA_PRIORITY,			\
+		.cra_flags = CRYPTO_ALG_ASYNC |				\
+			     CRYPTO_ALG_NEED_FALLBACK,			\
+		.cra_blocksize = _blocksize,				\
+		.cra_ctxsize = sizeof(crypto_dev_sess_t),		\
+		.cra_module = THIS_MODULE,				\
+	}
+
+static struct skcipher_alg skc_algs[] = {
+	{
+		.setkey = skc_setkey,
+		.encrypt = skc_encrypt,
+		.decrypt = skc_decrypt,
+		.init = skc_init,
+		.exit = skc_exit,
+		.min_keysize = AES_MIN_KEY_SIZE,
+		.max_keysize = AES_MAX_KEY_SIZE,
+		.ivsize = AES_BLOCK_SIZE,
+		.base = SKC_CRA_BASE("cbc(aes)", "cbc-aes-fsl", AES_BLOCK_SIZE),
+	},
+	{
+		.setkey = skc_setkey,
+		.encrypt = skc_encrypt,
+		.decrypt = skc_decrypt,
+		.init = skc_init,
+		.exit = skc_exit,
+		.min_keysize = AES_MIN_KEY_SIZE,
+		.max_keysize = AES_MAX_KEY_SIZE,
+		.ivsize = AES_BLOCK_SIZE,
+		.chunksize = AES_BLOCK_SIZE,
+		.base = SKC_CRA_BASE("ctr(aes)", "ctr-aes-fsl", 1),
+	},
+	{
+		.setkey = skc_setkey,
+		.encrypt = skc_encrypt,
+		.decrypt = skc_decrypt,
+		.init = skc_init,
+		.exit = skc_exit,
+		.min_keysize = 2 * AES_MIN_KEY_SIZE,
+		.max_keysize = 2 * AES_MAX_KEY_SIZE,
+		.ivsize = AES_BLOCK_SIZE,
+		.base = SKC_CRA_BASE("xts(aes)", "xts-aes-fsl", AES_BLOCK_SIZE),
+	},
+};
+
+static uint32_t skc_algs_reg;
+
+/*******************************************************************************
+ * Function     : fsl_skcipher_init
+ *
+ * Arguments    : void
+ *
+ * Return Value : Error code
+ *
+ * Description  : Registers the skcipher algorithms.
+ *
+ ******************************************************************************/
+int32_t fsl_skcipher_init(void)
+{
+	int err;
+
+	for (; skc_algs_reg < ARRAY_SIZE(skc_algs); skc_algs_reg++) {
+		err = crypto_register_skcipher(&skc_algs[skc_algs_reg]);
+		if (err) {
+			print_error("%s alg registration failed\n",
+				    skc_algs[skc_algs_reg].base.cra_driver_name);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/*******************************************************************************
+ * Function     : fsl_skcipher_exit
+ *
+ * Arguments    : void
+ *
+ * Return Value : None
+ *
+ * Description  : Deregisters the skcipher algorithms.
+ *
+ ******************************************************************************/
+void fsl_skcipher_exit(void)
+{
+	while (skc_algs_reg)
+		crypto_unregister_skcipher(&skc_algs[--skc_algs_reg]);
+}
+#endif /* SKCIPHER_OFFLOAD */
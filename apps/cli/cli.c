@@ -238,6 +238,21 @@ int prepare_command(int argn,char **argv)
                         case CONFIGFILE:
                             strcpy(cmd.rsrc.config, argv[counter]);
                             break;
+
+						case DEPTH:
+							if (FAILED == (temp = isvalidnum(argv[counter])))  return FAILURE;
+							cmd.rsrc.ring_cfg.depth  = temp;
+							break;
+
+						case PRIORITY:
+							if (FAILED == (temp = isvalidnum(argv[counter])))  return FAILURE;
+							cmd.rsrc.ring_cfg.priority  = temp;
+							break;
+
+						case AFFINITY:
+							if (FAILED == (temp = isvalidnum(argv[counter])))  return FAILURE;
+							cmd.rsrc.ring_cfg.affinity  = temp;
+							break;
 					}/* switch(cmd_counter) */
 				}
 				break;
@@ -662,6 +677,53 @@ int exe_command()
                 free(cmd.result);
                 return 0;
 
+		case FWSTAT: /* FWSTAT COMMAND */
+				if (RESETVALUE >= cmd.dev_id)
+					return -1;
+				{
+					char path[64], line[128];
+					FILE *file;
+
+					snprintf(path, sizeof(path), FW_STATS_PATH, cmd.dev_id);
+					file = fopen(path, "r");
+					if (NULL == file)
+					{
+						printf("OOPS ... invalid dev_id \n\n");
+						return 0;
+					}
+					printf("FIRMWARE STATISTICS\n");
+					printf("DEVICE ID                   :%d\n",cmd.dev_id);
+					while (fgets(line, sizeof(line), file))
+						printf("%s", line);
+					printf("\n");
+					fclose(file);
+				}
+				return 0;
+
+		case RINGCFG: /* RING CONFIG COMMAND */
+				if ((RESETVALUE >= cmd.dev_id) || (RESETVALUE >= cmd.rsrc.ring_cfg.ring_id))
+					return -1;
+
+				cmd.cmd_id    = RINGCONFIG_CMD;
+				cmd.result    = (int *)malloc(sizeof(int));
+				ret = ioctl(fd, CMDOPERATION , &cmd);
+				cmd.cmd_id    = RINGCFG;
+
+				if (-1 == ret)
+					printf("OOPS ... invalid dev_id/ring_id/settings \n\n");
+				else if (EACCES == ret)
+					printf("CLI is disabled.. HIGH PERF mode is defined \n\n");
+				else
+					if (!*(cmd.result))
+						printf("RING %d HAS BEEN RECONFIGURED\n\n",cmd.rsrc.ring_cfg.ring_id);
+					else if (-EOPNOTSUPP == *(cmd.result))
+						printf("FIRMWARE DOES NOT SUPPORT RING RECONFIGURATION\n\n");
+					else
+						printf("OOPS ... ring not reconfigured, see the kernel log\n\n");
+
+				free(cmd.result);
+				return 0;
+
 		default:
 				return 0;
 	}
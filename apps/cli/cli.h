@@ -61,7 +61,8 @@ debug dev-id <DEVICE ID>                        rehandshake dev-id <DEVICE ID> c
 devstat dev-id <DEVICE ID>                      pingdev dev-id <DEVICE ID>\n \
 resetdev dev-id <DEVICE ID>                     resetsec dev-id <DEVICE ID> sec-id <SEC ID>\n \
 ringstat dev-id <DEVICE ID> ring-id <RING ID>   secstat dev-id <DEVICE ID>\n \
-exit\n";
+fwstat dev-id <DEVICE ID>                       exit\n \
+ringcfg dev-id <DEVICE ID> ring-id <RING ID> [depth <DEPTH>] [priority <PRIORITY>] [affinity <SEC ID>]\n";
 
 const char *per_cmd_crypto_help[] = {
 "\nHelp:\n \
@@ -96,6 +97,16 @@ Syntax: ringstat dev-id <DEVICE ID> ring-id <RING ID>\n",
 "\nHelp:\n \
 Display sec engine related statistics\n \
 Syntax: secstat dev-id <DEVICE ID>\n",
+
+"\nHelp:\n \
+Display the statistics the firmware keeps in host memory\n \
+Syntax: fwstat dev-id <DEVICE ID>\n",
+
+"\nHelp:\n \
+Quiesce an application ring, change its depth, priority or sec affinity\n \
+and resume it, while the other rings keep running. Settings not given\n \
+are kept. Depth is a power of 2 from 16 up to the depth at handshake\n \
+Syntax: ringcfg dev-id <DEVICE ID> ring-id <RING ID> [depth <DEPTH>] [priority <PRIORITY>] [affinity <SEC ID>]\n",
 };
 
 const char *debug_help =
@@ -110,8 +121,8 @@ exit\n";
 const char *dev_prompt 	 = "cryptodev> ";
 const char *debug_prompt = "c29x_fw=> ";
 
-#define MAIN_COMMANDS 8
-const char *main_cmds[] = {"debug","devstat","rehandshake","pingdev","resetdev","resetsec","ringstat","secstat","exit"};
+#define MAIN_COMMANDS 10
+const char *main_cmds[] = {"debug","devstat","rehandshake","pingdev","resetdev","resetsec","ringstat","secstat","fwstat","ringcfg","exit"};
 typedef enum main_commands {
     DEBUG,
     DEVSTAT,
@@ -121,16 +132,27 @@ typedef enum main_commands {
     RESETSEC,
     RINGSTAT,
 	SECSTAT,
+	FWSTAT,
+	RINGCFG,
     EXIT
 }cmd_type_t;
 
-#define RSRC_COMMANDS 4
-const char *rsrc_cmds[] = {"dev-id","ring-id","sec-id","configfile"};
+/* FIRMWARE STATS - READ FROM SYSFS, NOT SENT TO THE DEVICE */
+#define FW_STATS_PATH "/sys/fsl_crypto/fsl_crypto_%d/stat/fw_stats"
+
+/* RING CONFIG - COMMAND ID OF THE DRIVER, AFTER ITS BLOCK/UNBLOCK COMMANDS */
+#define RINGCONFIG_CMD 10
+
+#define RSRC_COMMANDS 7
+const char *rsrc_cmds[] = {"dev-id","ring-id","sec-id","configfile","depth","priority","affinity"};
 enum rsrc_commands {
     DEVID,
     RINGID,
     SECID,
     CONFIGFILE,
+    DEPTH,
+    PRIORITY,
+    AFFINITY,
 };
 
 #define DEBUG_COMMANDS 4
@@ -214,6 +236,14 @@ typedef struct debug_ip {
 	unsigned int val;
 }debug_ip_t;
 
+/* RING ID FIRST, SHARED WITH rsrc.ring_id. -1 KEEPS THE CURRENT SETTING */
+typedef struct ring_cfg_ip {
+	int ring_id;
+	int depth;
+	int priority;
+	int affinity;
+}ring_cfg_ip_t;
+
 /*******************************************************************************
 Description : Identifies the user command arguments
 Fields      : cmd_type      : type of command
@@ -229,6 +259,7 @@ struct user_command_args {
         int sec_id;
         int ring_id;
 		debug_ip_t dgb;
+		ring_cfg_ip_t ring_cfg;
         char config[200];
     }rsrc;
 
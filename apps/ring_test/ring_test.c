@@ -0,0 +1,407 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*******************************************************************************
+ * Userspace check of host_driver/ring_core.h against a simulated firmware.
+ * The host side drives the rings through the rc_* helpers only; the firmware
+ * side consumes the request ring and answers on the response ring the way
+ * the C29x does, reading and writing the shadow counters big endian. The
+ * counters start close to 2^32 so that they wrap during the run, and with
+ * FW_CAP_RING_CONFIG the ring is resized while they do. The statistics
+ * reader is run against a firmware refreshing the block in the
+ * middle of the copies, with and without FW_CAP_STATS.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+
+/* The firmware refreshes the statistics block at the barriers of the reader,
+ * between its reads of seq and its copy */
+static void sim_fw_stats_step(void);
+#define RC_RMB()	sim_fw_stats_step()
+#define RC_RELAX()	sim_fw_stats_step()
+#include "ring_core.h"
+
+#define DEPTH_MAX	16
+#define NR_JOBS		100000
+#define CNTR_START	0xfffffff0
+#define NR_RESIZE	9973	/* jobs between RINGCONFIGs */
+
+/* Ring pair as laid out across host and device memory */
+struct sim_ring {
+	uint32_t depth;				/* fw */
+	uint32_t caps;				/* fw, FW_CAP_* */
+	struct req_ring_entry req_r[DEPTH_MAX];
+	struct resp_ring_entry resp_r[DEPTH_MAX];
+	struct ring_idxs_mem idxs;		/* host */
+	struct ring_counters_mem cntrs;		/* host */
+	struct ring_counters_mem shadow;	/* written by host, big endian */
+	struct ring_counters_mem s_c_cntrs;	/* written by fw, big endian */
+	/* Firmware state */
+	uint32_t fw_ri;
+	uint32_t fw_wi;
+	uint32_t fw_req_done;
+	uint32_t fw_resp_added;
+};
+
+static int failed;
+
+#define CHECK(cond, ...) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s:%d: ", __func__, __LINE__);		\
+		printf(__VA_ARGS__);					\
+		printf("\n");						\
+		failed = 1;						\
+		return -1;						\
+	}								\
+	} while (0)
+
+static int32_t sim_result(uint64_t desc)
+{
+	return (int32_t)(desc * 2654435761u);
+}
+
+static void sim_init(struct sim_ring *r, uint32_t depth, uint32_t caps)
+{
+	memset(r, 0, sizeof(*r));
+	r->depth = depth;
+	r->caps = caps;
+	r->cntrs.jobs_added = CNTR_START;
+	r->cntrs.jobs_processed = CNTR_START;
+	r->shadow.jobs_added = htobe32(CNTR_START);
+	r->shadow.jobs_processed = htobe32(CNTR_START);
+	r->s_c_cntrs.jobs_added = htobe32(CNTR_START);
+	r->s_c_cntrs.jobs_processed = htobe32(CNTR_START);
+	r->fw_req_done = CNTR_START;
+	r->fw_resp_added = CNTR_START;
+}
+
+/* Firmware: answers up to max published requests while the response ring
+ * has room */
+static void sim_fw_poll(struct sim_ring *r, uint32_t max)
+{
+	uint32_t posted = be32toh(r->shadow.jobs_added);
+	uint32_t consumed = be32toh(r->shadow.jobs_processed);
+	uint64_t desc;
+
+	while (max-- && posted != r->fw_req_done &&
+	       r->fw_resp_added - consumed < r->depth) {
+		desc = be64toh(r->req_r[r->fw_ri].sec_desc);
+		r->fw_ri = (r->fw_ri + 1) % r->depth;
+
+		r->resp_r[r->fw_wi].sec_desc = htobe64(desc);
+		r->resp_r[r->fw_wi].result = htobe32(sim_result(desc));
+		r->fw_wi = (r->fw_wi + 1) % r->depth;
+
+		r->s_c_cntrs.jobs_processed = htobe32(++r->fw_req_done);
+		r->s_c_cntrs.jobs_added = htobe32(++r->fw_resp_added);
+	}
+}
+
+/* Firmware: RINGCONFIG, only known with FW_CAP_RING_CONFIG. It takes the
+ * new depth and restarts its indexes of the ring at 0 */
+static int sim_fw_ringcfg(struct sim_ring *r, uint32_t depth)
+{
+	if (!(r->caps & FW_CAP_RING_CONFIG))
+		return -1;
+	CHECK(be32toh(r->shadow.jobs_added) == r->fw_req_done &&
+	      be32toh(r->shadow.jobs_processed) == r->fw_resp_added,
+	      "RINGCONFIG on a busy ring");
+
+	r->depth = depth;
+	r->fw_ri = 0;
+	r->fw_wi = 0;
+	return 0;
+}
+
+/* Host: RINGCONFIG once the ring drained, as reconfigure_ring() does */
+static int sim_ringcfg(struct sim_ring *r, uint32_t caps, uint32_t *depth,
+		       uint32_t new_depth)
+{
+	if (!(caps & FW_CAP_RING_CONFIG))
+		return -EOPNOTSUPP;
+	if (!rc_ring_idle(&r->cntrs))
+		return -EBUSY;
+	if (sim_fw_ringcfg(r, new_depth))
+		return -1;
+
+	rc_ring_restart(&r->idxs);
+	*depth = new_depth;
+	return 0;
+}
+
+/* Host: posts and reaps jobs in random batches, checking order and results.
+ * If the firmware reports FW_CAP_RING_CONFIG the ring is drained and resized
+ * every NR_RESIZE jobs */
+static int sim_run(uint32_t depth, uint32_t caps, unsigned int seed)
+{
+	static const uint32_t resize[] = { 16, 1, 8, 3, 13, 2 };
+	struct sim_ring r;
+	uint64_t next_desc = 0x1000, expect = 0x1000, desc;
+	uint32_t batch, inflight, pending, i, idle = 0;
+	uint32_t start = CNTR_START, next_cfg = NR_RESIZE, nr_cfg = 0;
+	uint32_t first = depth;
+	int32_t res;
+	int ret;
+
+	srand(seed);
+	sim_init(&r, depth, caps);
+
+	while (expect < 0x1000 + NR_JOBS) {
+		/* Random batches may be empty, a long run of them is a stall */
+		CHECK(++idle < 1000, "depth %u: stalled at job %#llx", depth,
+		      (unsigned long long)expect);
+		inflight = rc_req_inflight(&r.cntrs, &r.s_c_cntrs);
+		CHECK(inflight <= depth, "depth %u: %u jobs in flight", depth,
+		      inflight);
+
+		/* Quiesced: no new job until the ring is reconfigured */
+		if (next_desc - 0x1000 >= next_cfg) {
+			ret = sim_ringcfg(&r, r.caps, &depth,
+					  resize[nr_cfg % 6]);
+			if (!ret) {
+				CHECK(r.depth == depth, "fw depth %u, host %u",
+				      r.depth, depth);
+				start = r.cntrs.jobs_added;
+				nr_cfg++;
+			}
+			if (-EBUSY != ret)
+				next_cfg += NR_RESIZE;
+			CHECK(!ret || -EBUSY == ret ||
+			      (-EOPNOTSUPP == ret &&
+			       !(caps & FW_CAP_RING_CONFIG)),
+			      "depth %u: RINGCONFIG returned %d", depth, ret);
+		}
+
+		batch = (next_desc - 0x1000 >= next_cfg) ? 0 :
+			rand() % (depth + 1);
+		for (i = 0; i < batch && inflight < depth &&
+		     next_desc < 0x1000 + NR_JOBS; i++, inflight++) {
+			/* Descriptors are 8 byte aligned, the low bits carry
+			 * the SEC affinity */
+			rc_req_put(r.req_r, depth, &r.idxs, &r.cntrs,
+				   (next_desc << 3) | (next_desc & 0x3));
+			next_desc++;
+		}
+		if (i) {
+			desc = (next_desc - 1) << 3 | ((next_desc - 1) & 0x3);
+			CHECK(((uint8_t *)&r.req_r[(r.idxs.w_index + depth - 1) %
+						    depth].sec_desc)[7] ==
+			      (uint8_t)desc,
+			      "descriptor not written big endian");
+			rc_req_publish(&r.cntrs, &r.shadow);
+		}
+		CHECK(r.idxs.w_index == (r.cntrs.jobs_added - start) % depth,
+		      "depth %u: write index %u after %u jobs", depth,
+		      r.idxs.w_index, r.cntrs.jobs_added - start);
+
+		sim_fw_poll(&r, rand() % (depth + 1));
+
+		pending = rc_resp_pending(&r.cntrs, &r.s_c_cntrs);
+		CHECK(pending <= depth, "depth %u: %u responses pending", depth,
+		      pending);
+		batch = rand() % (pending + 1);
+		while (batch--) {
+			rc_resp_peek(r.resp_r, &r.idxs, &desc, &res);
+			CHECK(desc == ((expect << 3) | (expect & 0x3)),
+			      "depth %u: response %#llx, expected job %#llx",
+			      depth, (unsigned long long)desc,
+			      (unsigned long long)expect);
+			CHECK(res == sim_result(desc),
+			      "depth %u: result %d of job %#llx", depth, res,
+			      (unsigned long long)expect);
+			rc_resp_next(depth, &r.idxs, &r.cntrs, &r.shadow);
+			expect++;
+			idle = 0;
+		}
+	}
+
+	CHECK(rc_req_inflight(&r.cntrs, &r.s_c_cntrs) == 0 &&
+	      rc_resp_pending(&r.cntrs, &r.s_c_cntrs) == 0,
+	      "depth %u: ring not drained", depth);
+	CHECK(r.cntrs.jobs_added < CNTR_START, "counters did not wrap");
+	CHECK(be32toh(r.shadow.jobs_processed) == r.cntrs.jobs_processed,
+	      "depth %u: shadow jobs_processed %u, host %u", depth,
+	      be32toh(r.shadow.jobs_processed), r.cntrs.jobs_processed);
+
+	CHECK(!(caps & FW_CAP_RING_CONFIG) || nr_cfg == NR_JOBS / NR_RESIZE,
+	      "%u RINGCONFIGs", nr_cfg);
+
+	printf("PASS depth %u caps %#x: %u jobs, %u resizes\n", first, caps,
+	       NR_JOBS, nr_cfg);
+	return 0;
+}
+
+#define NR_STATS	100000
+
+/* Statistics block and the state of the firmware refreshing it */
+static struct sim_stats {
+	uint32_t caps;
+	struct fw_stats_mem blk;
+	uint32_t seq;
+	uint32_t v;		/* refreshes completed */
+} st;
+
+/* Values of refresh v, so that a copy mixing two refreshes is detected. The
+ * firmware writes the SEC half and the ring half separately */
+static void sim_stats_fill(struct fw_stats_mem *blk, uint32_t v, int half)
+{
+	uint32_t i;
+
+	if (!half) {
+		blk->interval = htobe32(v);
+		blk->no_secs = htobe32(1 + v % FW_STATS_MAX_SECS);
+		blk->no_rings = htobe32(1 + v % FW_STATS_MAX_RINGS);
+		for (i = 0; i < FW_STATS_MAX_SECS; i++) {
+			blk->sec[i].jobs = htobe32(v + i);
+			blk->sec[i].errors = htobe32(v ^ i);
+			blk->sec[i].busy_cycles =
+				htobe64((uint64_t)v << 32 | i);
+		}
+	} else {
+		for (i = 0; i < FW_STATS_MAX_RINGS; i++) {
+			blk->ring[i].jobs_processed = htobe32(v * (i + 1));
+			blk->ring[i].errors = htobe32(v + 100 * i);
+		}
+	}
+}
+
+/* Firmware: if it reports FW_CAP_STATS, randomly starts, finishes or does a
+ * whole refresh, keeping seq odd while the block is half written */
+static void sim_fw_stats_step(void)
+{
+	if (!(st.caps & FW_CAP_STATS))
+		return;
+
+	switch (rand() % 4) {
+	case 1:
+		if (!(st.seq & 1)) {
+			st.blk.seq = htobe32(++st.seq);
+			sim_stats_fill(&st.blk, st.v + 1, 0);
+			break;
+		}
+		/* fall through */
+	case 2:
+		if (!(st.seq & 1)) {
+			st.blk.seq = htobe32(++st.seq);
+			sim_stats_fill(&st.blk, st.v + 1, 0);
+		}
+		sim_stats_fill(&st.blk, ++st.v, 1);
+		st.blk.seq = htobe32(++st.seq);
+		st.blk.magic = htobe32(FW_STATS_MAGIC);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Host: takes copies while the firmware rewrites the block and checks each
+ * one comes from a single complete refresh */
+static int sim_stats_run(uint32_t caps, unsigned int seed)
+{
+	struct fw_stats_mem copy, ref;
+	uint32_t last = 0, good = 0, busy = 0, n, i;
+	int ret;
+
+	srand(seed);
+	memset(&st, 0, sizeof(st));
+	st.caps = caps;
+
+	for (n = 0; n < NR_STATS; n++) {
+		sim_fw_stats_step();
+		ret = rc_stats_read(&st.blk, &copy);
+		if (!(caps & FW_CAP_STATS)) {
+			CHECK(-ENODEV == ret,
+			      "caps %#x: read returned %d", caps, ret);
+			continue;
+		}
+		if (-ENODEV == ret && !st.v)
+			continue;
+		if (-EBUSY == ret) {
+			busy++;
+			continue;
+		}
+		CHECK(!ret, "caps %#x: read returned %d", caps, ret);
+		CHECK(!(copy.seq & 1) && copy.seq >= last && copy.interval &&
+		      copy.seq == 2 * copy.interval,
+		      "seq %u of refresh %u after seq %u", copy.seq,
+		      copy.interval, last);
+		last = copy.seq;
+
+		memset(&ref, 0, sizeof(ref));
+		sim_stats_fill(&ref, copy.interval, 0);
+		sim_stats_fill(&ref, copy.interval, 1);
+		CHECK(copy.no_secs == be32toh(ref.no_secs) &&
+		      copy.no_rings == be32toh(ref.no_rings),
+		      "refresh %u: %u secs %u rings", copy.interval,
+		      copy.no_secs, copy.no_rings);
+		for (i = 0; i < copy.no_secs; i++)
+			CHECK(copy.sec[i].jobs == be32toh(ref.sec[i].jobs) &&
+			      copy.sec[i].errors == be32toh(ref.sec[i].errors) &&
+			      copy.sec[i].busy_cycles ==
+			      be64toh(ref.sec[i].busy_cycles),
+			      "refresh %u: sec%u torn", copy.interval, i);
+		for (i = 0; i < copy.no_rings; i++)
+			CHECK(copy.ring[i].jobs_processed ==
+			      be32toh(ref.ring[i].jobs_processed) &&
+			      copy.ring[i].errors == be32toh(ref.ring[i].errors),
+			      "refresh %u: ring%u torn", copy.interval, i);
+		good++;
+	}
+	CHECK(!(caps & FW_CAP_STATS) || good > NR_STATS / 2,
+	      "caps %#x: only %u of %u reads succeeded", caps, good, NR_STATS);
+
+	printf("PASS stats caps %#x: %u copies, %u busy\n", caps, good, busy);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	/* Firmware rings are powers of 2, the helpers do not rely on it */
+	static const uint32_t depths[] = { 1, 2, 3, 8, 13, 16 };
+	unsigned int seed = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i++)
+		sim_run(depths[i], 0, seed + i);
+
+	/* Firmware without the feature keeps serving at the first depth */
+	sim_run(16, 0, seed);
+	sim_run(16, FW_CAP_RING_CONFIG, seed);
+
+	/* Firmware without the feature never publishes the block */
+	sim_stats_run(0, seed);
+	sim_stats_run(FW_CAP_STATS, seed);
+
+	return failed;
+}
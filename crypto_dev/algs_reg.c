@@ -37,6 +37,10 @@
 #include "common.h"
 #include "fsl_c2x0_driver.h"
 #include "algs.h"
+#ifndef VIRTIO_C2X0
+#include "ring_balance.h"
+#include "pkc_kapi.h"
+#endif
 
 atomic_t selected_devices;
 struct list_head alg_list;
@@ -55,57 +59,11 @@ struct list_head alg_list;
 int fill_crypto_dev_sess_ctx(crypto_dev_sess_t *ctx, uint32_t op_type)
 {
 	uint32_t no_of_app_rings = 0;
-	uint32_t no_of_devices = 0;
-#ifndef HIGH_PERF
-	uint32_t  new_device = 0;
-	int device_status = 0, count = 0, cpu = 0;
-	per_dev_struct_t *dev_stat = NULL;
-	uint32_t loop_cnt = 0;
-#endif
 
-	no_of_devices = get_no_of_devices();
-	if (0 >= no_of_devices) {
-		print_error("No Device configured\n");
+	/* Round robin over the alive devices, local ones first */
+	ctx->c_dev = get_device_rr();
+	if (!ctx->c_dev)
 		return -1;
-	}
-
-#ifndef HIGH_PERF
-	while (!device_status && count < no_of_devices) {
-		new_device =
-		    ((atomic_inc_return(&selected_devices) -
-		      1) % no_of_devices) + 1;
-		ctx->c_dev = get_crypto_dev(new_device);
-		if (!ctx->c_dev) {
-			print_error
-			    ("Could not retrieve the device structure.\n");
-			return -1;
-		}
-		cpu = get_cpu();
-		dev_stat = per_cpu_ptr(ctx->c_dev->dev_status, cpu);
-		put_cpu();
-
-		device_status = atomic_read(&(dev_stat->device_status));
-		if (device_status) {
-			count = 0;
-			break;
-		}
-		count++;
-		if (++loop_cnt > 1000000) {
-			print_error("Could not get an active device\n");
-			return -1;
-		}
-	}
-	if (!device_status) {
-		print_error("No Device is ALIVE\n");
-		return -1;
-	}
-#else
-	ctx->c_dev = get_crypto_dev(1);
-	if (!ctx->c_dev) {
-		print_error("Could not retrieve the device structure.\n");
-		return -1;
-	}
-#endif
 
 	no_of_app_rings = ctx->c_dev->num_of_rings - 1;
 
@@ -174,6 +132,162 @@ static void sym_cra_exit(struct crypto_tfm *tfm)
 }
 #endif /* SYMMETRIC_OFFLOAD */
 
+#ifdef SW_FALLBACK
+/* Smoothed cost (ns) of the software RSA path, per operation (public,
+ * private) and modulus size (up to 1K, 2K, 3K, 4K bits). Zero until the
+ * first request of the class has been computed in software, which happens
+ * when the device is dead or full; until then the device gets the request. */
+#define RSA_SW_COST_BUCKETS	4
+static atomic_t rsa_sw_cost[2][RSA_SW_COST_BUCKETS];
+
+/* Requests are split in eighths: at most 7 of every 8 go to software, so
+ * that device completions keep refreshing the ring latency estimate */
+#define RSA_SW_SHARE_MAX	7
+static atomic_t rsa_dispatch_seq;
+
+static atomic_t *rsa_sw_cost_slot(struct pkc_request *req)
+{
+	uint32_t n_len, bucket;
+	bool priv = (RSA_PUB != req->type);
+
+	if (priv)
+		n_len = req->req_u.rsa_priv_f1.n_len;
+	else
+		n_len = req->req_u.rsa_pub_req.n_len;
+
+	bucket = n_len ? (n_len - 1) / 128 : 0;
+	if (bucket >= RSA_SW_COST_BUCKETS)
+		bucket = RSA_SW_COST_BUCKETS - 1;
+
+	return &rsa_sw_cost[priv][bucket];
+}
+
+/*******************************************************************************
+ * Function     : hw_delay_ns
+ *
+ * Arguments    : c_dev - device
+ *		  rid   - ring the session posts to
+ *
+ * Return Value : Estimated time (ns) for a job enqueued now to complete
+ *
+ * Description  : The smoothed completion latency of the ring divided by the
+ *		  smoothed occupancy it was measured at gives the cost of one
+ *		  queued job; scale it by the current occupancy.
+ *
+ ******************************************************************************/
+static uint64_t hw_delay_ns(fsl_crypto_dev_t *c_dev, uint32_t rid)
+{
+	fsl_h_rsrc_ring_pair_t *rp = &c_dev->ring_pairs[rid];
+	uint64_t occ = ring_occupancy(c_dev, rid);
+
+	/* occ_avg is scaled by 8 */
+	return div_u64((uint64_t)rp->lat_avg * (occ + 1) * 8,
+		       rp->occ_avg + 8);
+}
+
+/*******************************************************************************
+ * Function     : rsa_sw_share
+ *
+ * Arguments    : c_dev - device of the session
+ *		  rid   - ring of the session
+ *		  req   - RSA request
+ *
+ * Return Value : Eighths of the requests to compute in software
+ *
+ * Description  : With a queue delay D on the device and a software cost C,
+ *		  sending the fraction 1 - C/D of the requests to the CPU
+ *		  evens out the two paths. Capped at RSA_SW_SHARE_MAX.
+ *
+ ******************************************************************************/
+static uint32_t rsa_sw_share(fsl_crypto_dev_t *c_dev, uint32_t rid,
+			     struct pkc_request *req)
+{
+	uint64_t sw = atomic_read(rsa_sw_cost_slot(req));
+	uint64_t hw;
+	uint32_t share;
+
+	/* Unknown software cost */
+	if (!sw)
+		return 0;
+
+	hw = hw_delay_ns(c_dev, rid);
+	if (hw <= sw)
+		return 0;
+
+	share = div64_u64((hw - sw) * 8, hw);
+	return min_t(uint32_t, share, RSA_SW_SHARE_MAX);
+}
+
+static void rsa_sw_cost_update(atomic_t *cost, uint32_t t)
+{
+	int old, new;
+
+	/* EWMA with 1/8 weight, seeded with the first sample */
+	do {
+		old = atomic_read(cost);
+		new = old ? old - (old >> 3) + (t >> 3) : t;
+	} while (atomic_cmpxchg(cost, old, new) != old);
+}
+
+static int rsa_sw_run(struct pkc_request *req)
+{
+	ktime_t start = ktime_get();
+	s64 t;
+	int ret;
+
+	ret = rsa_sw_op(req);
+	t = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (!ret && t > 0 && t < INT_MAX)
+		rsa_sw_cost_update(rsa_sw_cost_slot(req), t);
+	print_debug("RSA request computed in software: %d\n", ret);
+	return crypto_dev_sess_answer(req, ret);
+}
+
+/*******************************************************************************
+ * Function     : rsa_dispatch_op
+ *
+ * Arguments    : req - RSA request
+ *
+ * Return Value : crypto_dev_sess_answer() result when computed in software,
+ *		  rsa_op() result otherwise
+ *
+ * Description  : pkc_op of pkc(rsa). Sends the request to the kernel MPI
+ *		  implementation when the device is not alive, or when
+ *		  rsa_op() found its ring full or no context left (-EAGAIN).
+ *		  Other rsa_op() errors, such as a malformed request, go back
+ *		  to the caller. Otherwise the share from rsa_sw_share() of
+ *		  the requests goes to software and the rest to the device.
+ *		  Only sleepable, non-CRT requests are candidates for the
+ *		  software path.
+ *
+ ******************************************************************************/
+static int rsa_dispatch_op(struct pkc_request *req)
+{
+	crypto_dev_sess_t *c_sess = crypto_pkc_ctx(crypto_pkc_reqtfm(req));
+	fsl_crypto_dev_t *c_dev = c_sess->c_dev;
+	uint32_t seq;
+	int ret;
+
+	if (!(req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP) ||
+	    (RSA_PUB != req->type && RSA_PRIV_FORM1 != req->type))
+		return rsa_op(req);
+
+	if (!c_dev || !device_alive(c_dev))
+		return rsa_sw_run(req);
+
+	seq = (uint32_t)atomic_inc_return(&rsa_dispatch_seq) % 8;
+	if (seq < rsa_sw_share(c_dev, c_sess->r_id, req))
+		return rsa_sw_run(req);
+
+	ret = rsa_op(req);
+	if (-EAGAIN == ret)
+		return rsa_sw_run(req);
+
+	return ret;
+}
+#endif /* SW_FALLBACK */
+
 static struct alg_template driver_algs[] = {
 	{
 	 .name = "pkc(rsa)",
@@ -181,7 +295,11 @@ static struct alg_template driver_algs[] = {
 	 .blocksize = 0,
 	 .type = CRYPTO_ALG_TYPE_PKC_RSA,
 	 .u.pkc = {
+#ifdef SW_FALLBACK
+		   .pkc_op = rsa_dispatch_op,
+#else
 		   .pkc_op = rsa_op,
+#endif
 		   .min_keysize = 512,
 		   .max_keysize = 4096,
 		   },
@@ -208,6 +326,36 @@ static struct alg_template driver_algs[] = {
 		   .max_keysize = 4096,
 		   },
 	 },
+	{
+	 .name = "pkc(modexp)",
+	 .driver_name = "pkc-modexp-fsl",
+	 .type = CRYPTO_ALG_TYPE_PKC_RSA,
+	 .u.pkc = {
+		   .pkc_op = pkha_modexp_op,
+		   .min_keysize = 8,
+		   .max_keysize = 4096,
+		   },
+	 },
+	{
+	 .name = "pkc(ecmul)",
+	 .driver_name = "pkc-ecmul-fsl",
+	 .type = CRYPTO_ALG_TYPE_PKC_DH,
+	 .u.pkc = {
+		   .pkc_op = pkha_ecmul_op,
+		   .min_keysize = 160,
+		   .max_keysize = 576,
+		   },
+	 },
+	{
+	 .name = "pkc(prime_test)",
+	 .driver_name = "pkc-prime_test-fsl",
+	 .type = CRYPTO_ALG_TYPE_PKC_RSA,
+	 .u.pkc = {
+		   .pkc_op = pkha_prime_test_op,
+		   .min_keysize = 8,
+		   .max_keysize = 4096,
+		   },
+	 },
 #ifdef HASH_OFFLOAD
 	{
 	 .name = "sha1",
@@ -345,6 +493,7 @@ static struct alg_template driver_algs[] = {
 #endif
 #ifdef SYMMETRIC_OFFLOAD
 	/* ablkcipher descriptor */
+#ifndef SKCIPHER_OFFLOAD
 	{
 	 .name = "cbc(aes)",
 	 .driver_name = "cbc-aes-fsl",
@@ -361,6 +510,7 @@ static struct alg_template driver_algs[] = {
 			 },
 	 .class1_alg_type = OP_ALG_ALGSEL_AES | OP_ALG_AAI_CBC,
 	 },
+#endif
 	{
 	 .name = "cbc(des3_ede)",
 	 .driver_name = "cbc-3des-fsl",
@@ -431,9 +581,9 @@ static int pkc_cra_init(struct crypto_tfm *tfm)
  ******************************************************************************/
 static void pkc_cra_exit(struct crypto_tfm *tfm)
 {
-
-	/* Nothing to be done */
-
+#ifndef VIRTIO_C2X0
+	crypto_dev_sess_free(crypto_tfm_ctx(tfm));
+#endif
 }
 
 static struct fsl_crypto_alg *fsl_alg_alloc(struct alg_template *template,
@@ -598,6 +748,14 @@ l_start:
 #endif
 	}
 
+	err = fsl_pkc_kapi_init();
+	if (err)
+		goto out_err;
+
+	err = fsl_skcipher_init();
+	if (err)
+		goto out_err;
+
 	return 0;
 
 out_err:
@@ -623,6 +781,9 @@ void fsl_algapi_exit(void)
 	if (!alg_list.next)
 		return;
 
+	fsl_skcipher_exit();
+	fsl_pkc_kapi_exit();
+
 	list_for_each_entry_safe(f_alg, temp, &alg_list, entry) {
 		if (f_alg->ahash) {
 			alg = &f_alg->u.ahash_alg.halg.base;
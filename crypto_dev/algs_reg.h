@@ -56,6 +56,12 @@ extern void fsl_algapi_exit(void);
 extern int rsa_op(struct pkc_request *req);
 extern int dsa_op(struct pkc_request *req);
 extern int dh_op(struct pkc_request *req);
+extern int pkha_modexp_op(struct pkc_request *req);
+extern int pkha_ecmul_op(struct pkc_request *req);
+extern int pkha_prime_test_op(struct pkc_request *req);
+#ifdef SW_FALLBACK
+extern int rsa_sw_op(struct pkc_request *req);
+#endif
 
 extern int hash_cra_init(struct crypto_tfm *tfm);
 extern void hash_cra_exit(struct crypto_tfm *tfm);
@@ -73,6 +79,25 @@ extern int fsl_ablkcipher_setkey(struct crypto_ablkcipher *ablkcipher,
 				 const u8 *key, unsigned int keylen);
 extern int fsl_ablkcipher_decrypt(struct ablkcipher_request *req);
 extern int fsl_ablkcipher_encrypt(struct ablkcipher_request *req);
+
+/* skcipher cbc(aes), ctr(aes) and xts(aes) of symmetric.c; they take over
+ * cbc(aes) from the ablkcipher table */
+#if defined(SYMMETRIC_OFFLOAD) && \
+	(LINUX_VERSION_CODE >= KERNEL_VERSION(4, 8, 0))
+#define SKCIPHER_OFFLOAD
+
+extern int32_t fsl_skcipher_init(void);
+extern void fsl_skcipher_exit(void);
+#else
+static inline int32_t fsl_skcipher_init(void)
+{
+	return 0;
+}
+
+static inline void fsl_skcipher_exit(void)
+{
+}
+#endif
 #endif
 
 struct alg_template {
@@ -0,0 +1,1142 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <linux/crypto.h>
+#include <linux/random.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+
+#include "common.h"
+#include "fsl_c2x0_crypto_layer.h"
+#include "fsl_c2x0_driver.h"
+#include "algs.h"
+#include "algs_reg.h"
+#include "ecc_curves.h"
+#include "ring_balance.h"
+#include "pkc_kapi.h"
+
+#ifdef PKC_KAPI
+#include <crypto/internal/akcipher.h>
+#include <crypto/internal/kpp.h>
+#include <crypto/internal/rsa.h>
+#include <crypto/dh.h>
+#include <crypto/ecdh.h>
+
+/* The peer's point of ECDH is checked by the ECC helpers of the kernel,
+ * exported to drivers from 5.16 on */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0)) && \
+	IS_REACHABLE(CONFIG_CRYPTO_ECC)
+#define KAPI_ECDH
+#include <crypto/internal/ecc.h>
+#endif
+
+/* Verification only, the kernel moved it to the synchronous sig API in 6.13 */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)) && \
+	(LINUX_VERSION_CODE < KERNEL_VERSION(6, 13, 0))
+#define KAPI_ECDSA
+#endif
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0))
+typedef unsigned int kapi_size_t;
+#else
+typedef int kapi_size_t;
+#endif
+
+/* Largest modulus the RSA descriptors take */
+#define KAPI_RSA_MAX_LEN	512
+
+/* Draws of a private key before giving up, each one fails with p < 1/2 */
+#define KAPI_KEYGEN_TRIES	32
+
+/*******************************************************************************
+Description :	Context of an akcipher or kpp tfm.
+Fields      :	c_sess	: Session of the tfm. First, as the submission paths
+			  find it at the start of the tfm context
+		curve	: Named curve of ecdsa / ecdh, NULL otherwise
+		key	: Single allocation backing the key fields below
+		rsa	: Modulus and exponents, plus the CRT values padded to
+			  the prime lengths when the private key carries them
+		dh	: Prime, generator padded to the prime length and the
+			  private value
+		ec	: Private scalar for ecdh, public point x || y for ecdsa
+		ecc	: Kernel's description of the ecdh curve
+*******************************************************************************/
+struct kapi_ctx {
+	crypto_dev_sess_t c_sess;
+	const ecc_curve_t *curve;
+#ifdef KAPI_ECDH
+	const struct ecc_curve *ecc;
+#endif
+	uint8_t *key;
+	union {
+		struct {
+			uint8_t *n, *e, *d;
+			uint8_t *p, *q, *dp, *dq, *c;
+			uint32_t n_len, e_len, d_len, p_len, q_len;
+		} rsa;
+		struct {
+			uint8_t *p, *g, *x;
+			uint32_t p_len, x_len;
+		} dh;
+		struct {
+			uint8_t *k;
+			uint32_t k_len;
+		} ec;
+	} u;
+};
+
+/*******************************************************************************
+Description :	Context of an akcipher or kpp request.
+Fields      :	pkc	: Request handed to the submission paths
+		areq	: akcipher / kpp request being served
+		dst	: Its destination and destination length
+		buf	: Input and output copies, freed on completion
+		out	: Output within buf, NULL if there is none
+		verify	: Signature verification, a failure is a mismatch
+*******************************************************************************/
+struct kapi_req {
+	struct pkc_request pkc;
+	struct crypto_async_request *areq;
+	struct scatterlist *dst;
+	unsigned int *dst_len;
+	uint8_t *buf;
+	uint8_t *out;
+	uint32_t out_len;
+	bool verify;
+};
+
+static void kapi_strip(const uint8_t **p, size_t *len)
+{
+	while (*len > 1 && !**p) {
+		(*p)++;
+		(*len)--;
+	}
+}
+
+/* Copies src right aligned in len bytes */
+static void kapi_cp_pad(uint8_t *dst, uint32_t len, const uint8_t *src,
+			size_t src_len)
+{
+	memset(dst, 0, len - src_len);
+	memcpy(dst + len - src_len, src, src_len);
+}
+
+static void kapi_cp_out(struct kapi_req *kreq)
+{
+	sg_copy_from_buffer(kreq->dst, sg_nents(kreq->dst), kreq->out,
+			    kreq->out_len);
+	*kreq->dst_len = kreq->out_len;
+}
+
+static void kapi_complete(struct crypto_async_request *base, int err)
+{
+	struct kapi_req *kreq = container_of(base, struct kapi_req, pkc.base);
+	struct crypto_async_request *areq = kreq->areq;
+
+	/* SEC status words and driver errors are not errnos */
+	if (err)
+		err = kreq->verify ? -EKEYREJECTED : -EIO;
+	else if (kreq->out)
+		kapi_cp_out(kreq);
+
+	kfree(kreq->buf);
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0))
+	crypto_request_complete(areq, err);
+#else
+	areq->complete(areq, err);
+#endif
+}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0))
+/* Completions get the data of the request, which is the request itself */
+static void kapi_done(void *data, int err)
+{
+	kapi_complete(data, err);
+}
+#else
+static void kapi_done(struct crypto_async_request *base, int err)
+{
+	kapi_complete(base, err);
+}
+#endif
+
+bool pkc_kapi_req(struct pkc_request *req)
+{
+	return kapi_done == req->base.complete;
+}
+
+int pkc_kapi_op(struct pkc_request *req)
+{
+	switch (req->type) {
+	case RSA_PUB:
+	case RSA_PRIV_FORM1:
+	case RSA_PRIV_FORM3:
+		return rsa_op(req);
+	case ECDSA_VERIFY:
+		return dsa_op(req);
+	case DH_COMPUTE_KEY:
+	case ECDH_COMPUTE_KEY:
+		return dh_op(req);
+	case ECC_KEYGEN:
+		return pkha_ecmul_op(req);
+	default:
+		return -EINVAL;
+	}
+}
+
+static uint8_t *kapi_req_init(struct kapi_req *kreq, struct crypto_tfm *tfm,
+			      struct crypto_async_request *areq,
+			      struct scatterlist *dst, unsigned int *dst_len,
+			      size_t len)
+{
+	memset(kreq, 0, sizeof(*kreq));
+	kreq->pkc.base.tfm = tfm;
+	kreq->pkc.base.flags = areq->flags;
+	kreq->pkc.base.complete = kapi_done;
+	kreq->pkc.base.data = &kreq->pkc.base;
+	kreq->areq = areq;
+	kreq->dst = dst;
+	kreq->dst_len = dst_len;
+	kreq->buf = kzalloc(len, (areq->flags & CRYPTO_TFM_REQ_MAY_SLEEP) ?
+			    GFP_KERNEL : GFP_ATOMIC);
+
+	return kreq->buf;
+}
+
+static int kapi_submit(struct kapi_req *kreq)
+{
+	int ret = pkc_kapi_op(&kreq->pkc);
+
+	if (-EINPROGRESS == ret)
+		return ret;
+
+	/* Answered without a job, from the PKC cache */
+	if (!ret && kreq->out)
+		kapi_cp_out(kreq);
+	kfree(kreq->buf);
+
+	return (-1 == ret) ? -EAGAIN : ret;
+}
+
+static int kapi_tfm_init(struct crypto_tfm *tfm, const ecc_curve_t *curve)
+{
+	struct kapi_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	ctx->curve = curve;
+	if (-1 == fill_crypto_dev_sess_ctx(&ctx->c_sess, ASYMMETRIC))
+		return -ENODEV;
+
+	return 0;
+}
+
+static int kapi_akcipher_init(struct crypto_akcipher *tfm,
+			      const ecc_curve_t *curve)
+{
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0))
+	akcipher_set_reqsize(tfm, sizeof(struct kapi_req));
+#endif
+	return kapi_tfm_init(crypto_akcipher_tfm(tfm), curve);
+}
+
+static int kapi_kpp_init(struct crypto_kpp *tfm, const ecc_curve_t *curve)
+{
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0))
+	kpp_set_reqsize(tfm, sizeof(struct kapi_req));
+#endif
+	return kapi_tfm_init(crypto_kpp_tfm(tfm), curve);
+}
+
+static void kapi_tfm_exit(struct crypto_tfm *tfm)
+{
+	struct kapi_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	kfree(ctx->key);
+	crypto_dev_sess_free(&ctx->c_sess);
+}
+
+static uint8_t *kapi_key_alloc(struct kapi_ctx *ctx, size_t len)
+{
+	kfree(ctx->key);
+	memset(&ctx->u, 0, sizeof(ctx->u));
+	ctx->key = kzalloc(len, GFP_KERNEL);
+
+	return ctx->key;
+}
+
+/* RSA: akcipher "rsa", raw RSA without padding */
+static int kapi_rsa_set_key(struct crypto_akcipher *tfm, const void *key,
+			    unsigned int keylen, bool priv)
+{
+	struct kapi_ctx *ctx = akcipher_tfm_ctx(tfm);
+	struct rsa_key raw;
+	size_t len;
+	uint8_t *mem;
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0))
+	bool crt = false;
+#endif
+	int ret;
+
+	memset(&raw, 0, sizeof(raw));
+	if (priv)
+		ret = rsa_parse_priv_key(&raw, key, keylen);
+	else
+		ret = rsa_parse_pub_key(&raw, key, keylen);
+	if (ret)
+		return ret;
+
+	kapi_strip(&raw.n, &raw.n_sz);
+	kapi_strip(&raw.e, &raw.e_sz);
+	if (raw.n_sz > KAPI_RSA_MAX_LEN || raw.e_sz > raw.n_sz)
+		return -EINVAL;
+	len = raw.n_sz + raw.e_sz;
+
+	if (priv) {
+		kapi_strip(&raw.d, &raw.d_sz);
+		if (raw.d_sz > raw.n_sz)
+			return -EINVAL;
+		len += raw.d_sz;
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0))
+		/* Form 3 takes dp and qinv of p's length, dq of q's */
+		if (raw.p_sz && raw.q_sz && raw.dp_sz && raw.dq_sz &&
+		    raw.qinv_sz) {
+			kapi_strip(&raw.p, &raw.p_sz);
+			kapi_strip(&raw.q, &raw.q_sz);
+			kapi_strip(&raw.dp, &raw.dp_sz);
+			kapi_strip(&raw.dq, &raw.dq_sz);
+			kapi_strip(&raw.qinv, &raw.qinv_sz);
+			crt = raw.dp_sz <= raw.p_sz && raw.dq_sz <= raw.q_sz &&
+			      raw.qinv_sz <= raw.p_sz;
+		}
+		if (crt)
+			len += 3 * raw.p_sz + 2 * raw.q_sz;
+#endif
+	}
+
+	mem = kapi_key_alloc(ctx, len);
+	if (!mem)
+		return -ENOMEM;
+
+	ctx->u.rsa.n = mem;
+	ctx->u.rsa.n_len = raw.n_sz;
+	memcpy(mem, raw.n, raw.n_sz);
+	mem += raw.n_sz;
+	ctx->u.rsa.e = mem;
+	ctx->u.rsa.e_len = raw.e_sz;
+	memcpy(mem, raw.e, raw.e_sz);
+	mem += raw.e_sz;
+	if (!priv)
+		return 0;
+
+	ctx->u.rsa.d = mem;
+	ctx->u.rsa.d_len = raw.d_sz;
+	memcpy(mem, raw.d, raw.d_sz);
+	mem += raw.d_sz;
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0))
+	if (!crt)
+		return 0;
+
+	ctx->u.rsa.p_len = raw.p_sz;
+	ctx->u.rsa.q_len = raw.q_sz;
+	ctx->u.rsa.p = mem;
+	memcpy(mem, raw.p, raw.p_sz);
+	mem += raw.p_sz;
+	ctx->u.rsa.q = mem;
+	memcpy(mem, raw.q, raw.q_sz);
+	mem += raw.q_sz;
+	ctx->u.rsa.dp = mem;
+	kapi_cp_pad(mem, raw.p_sz, raw.dp, raw.dp_sz);
+	mem += raw.p_sz;
+	ctx->u.rsa.dq = mem;
+	kapi_cp_pad(mem, raw.q_sz, raw.dq, raw.dq_sz);
+	mem += raw.q_sz;
+	ctx->u.rsa.c = mem;
+	kapi_cp_pad(mem, raw.p_sz, raw.qinv, raw.qinv_sz);
+#endif
+	return 0;
+}
+
+static int kapi_rsa_set_pub_key(struct crypto_akcipher *tfm, const void *key,
+				unsigned int keylen)
+{
+	return kapi_rsa_set_key(tfm, key, keylen, false);
+}
+
+static int kapi_rsa_set_priv_key(struct crypto_akcipher *tfm, const void *key,
+				 unsigned int keylen)
+{
+	return kapi_rsa_set_key(tfm, key, keylen, true);
+}
+
+static kapi_size_t kapi_rsa_max_size(struct crypto_akcipher *tfm)
+{
+	struct kapi_ctx *ctx = akcipher_tfm_ctx(tfm);
+
+	return ctx->u.rsa.n_len;
+}
+
+/* Input right aligned in the first n_len bytes of the buffer */
+static int kapi_rsa_req_init(struct akcipher_request *req, uint32_t n_len)
+{
+	struct crypto_akcipher *tfm = crypto_akcipher_reqtfm(req);
+	struct kapi_req *kreq = akcipher_request_ctx(req);
+
+	if (!n_len || req->src_len > n_len)
+		return -EINVAL;
+	if (req->dst_len < n_len) {
+		req->dst_len = n_len;
+		return -EOVERFLOW;
+	}
+
+	if (!kapi_req_init(kreq, crypto_akcipher_tfm(tfm), &req->base,
+			   req->dst, &req->dst_len, 2 * n_len))
+		return -ENOMEM;
+
+	sg_copy_to_buffer(req->src, sg_nents(req->src),
+			  kreq->buf + n_len - req->src_len, req->src_len);
+	kreq->out = kreq->buf + n_len;
+	kreq->out_len = n_len;
+
+	return 0;
+}
+
+static int kapi_rsa_pub(struct akcipher_request *req)
+{
+	struct kapi_ctx *ctx = akcipher_tfm_ctx(crypto_akcipher_reqtfm(req));
+	struct kapi_req *kreq = akcipher_request_ctx(req);
+	struct rsa_pub_req_s *pub = &kreq->pkc.req_u.rsa_pub_req;
+	uint32_t n_len = ctx->u.rsa.n_len;
+	int ret;
+
+	ret = kapi_rsa_req_init(req, n_len);
+	if (ret)
+		return ret;
+
+	kreq->pkc.type = RSA_PUB;
+	pub->n = ctx->u.rsa.n;
+	pub->e = ctx->u.rsa.e;
+	pub->f = kreq->buf;
+	pub->g = kreq->out;
+	pub->n_len = n_len;
+	pub->e_len = ctx->u.rsa.e_len;
+	pub->f_len = n_len;
+	pub->g_len = n_len;
+
+	return kapi_submit(kreq);
+}
+
+static int kapi_rsa_priv(struct akcipher_request *req)
+{
+	struct kapi_ctx *ctx = akcipher_tfm_ctx(crypto_akcipher_reqtfm(req));
+	struct kapi_req *kreq = akcipher_request_ctx(req);
+	struct rsa_priv_frm1_req_s *f1 = &kreq->pkc.req_u.rsa_priv_f1;
+	struct rsa_priv_frm3_req_s *f3 = &kreq->pkc.req_u.rsa_priv_f3;
+	uint32_t n_len = ctx->u.rsa.n_len;
+	int ret;
+
+	if (!ctx->u.rsa.d)
+		return -EINVAL;
+
+	ret = kapi_rsa_req_init(req, n_len);
+	if (ret)
+		return ret;
+
+	if (ctx->u.rsa.p) {
+		kreq->pkc.type = RSA_PRIV_FORM3;
+		f3->p = ctx->u.rsa.p;
+		f3->q = ctx->u.rsa.q;
+		f3->dp = ctx->u.rsa.dp;
+		f3->dq = ctx->u.rsa.dq;
+		f3->c = ctx->u.rsa.c;
+		f3->g = kreq->buf;
+		f3->f = kreq->out;
+		f3->p_len = ctx->u.rsa.p_len;
+		f3->q_len = ctx->u.rsa.q_len;
+		f3->dp_len = ctx->u.rsa.p_len;
+		f3->dq_len = ctx->u.rsa.q_len;
+		f3->c_len = ctx->u.rsa.p_len;
+		f3->g_len = n_len;
+		f3->f_len = n_len;
+	} else {
+		kreq->pkc.type = RSA_PRIV_FORM1;
+		f1->n = ctx->u.rsa.n;
+		f1->d = ctx->u.rsa.d;
+		f1->g = kreq->buf;
+		f1->f = kreq->out;
+		f1->n_len = n_len;
+		f1->d_len = ctx->u.rsa.d_len;
+		f1->g_len = n_len;
+		f1->f_len = n_len;
+	}
+
+	return kapi_submit(kreq);
+}
+
+static int kapi_rsa_init(struct crypto_akcipher *tfm)
+{
+	return kapi_akcipher_init(tfm, NULL);
+}
+
+static void kapi_akcipher_exit(struct crypto_akcipher *tfm)
+{
+	kapi_tfm_exit(crypto_akcipher_tfm(tfm));
+}
+
+#ifdef KAPI_ECDSA
+/* ECDSA: akcipher "ecdsa-nist-*", verification only like the kernel's */
+static int kapi_ecdsa_set_pub_key(struct crypto_akcipher *tfm,
+				  const void *key, unsigned int keylen)
+{
+	struct kapi_ctx *ctx = akcipher_tfm_ctx(tfm);
+	const uint8_t *point = key;
+	uint32_t len = ctx->curve->g_len;
+
+	/* Uncompressed point only */
+	if (keylen != 1 + len || 0x04 != point[0])
+		return -EINVAL;
+
+	if (!kapi_key_alloc(ctx, len))
+		return -ENOMEM;
+
+	ctx->u.ec.k = ctx->key;
+	ctx->u.ec.k_len = len;
+	memcpy(ctx->u.ec.k, point + 1, len);
+
+	return 0;
+}
+
+static kapi_size_t kapi_ecdsa_max_size(struct crypto_akcipher *tfm)
+{
+	struct kapi_ctx *ctx = akcipher_tfm_ctx(tfm);
+
+	return ctx->curve->q_len;
+}
+
+/* One INTEGER of the signature, copied right aligned in len bytes */
+static int kapi_der_int(const uint8_t **p, const uint8_t *end, uint8_t *out,
+			uint32_t len)
+{
+	const uint8_t *v = *p + 2;
+	uint32_t l;
+
+	if (end - *p < 2 || 0x02 != (*p)[0] || ((*p)[1] & 0x80))
+		return -EBADMSG;
+	l = (*p)[1];
+	if (l > end - v)
+		return -EBADMSG;
+	*p = v + l;
+
+	while (l && !*v) {
+		v++;
+		l--;
+	}
+	if (!l || l > len)
+		return -EBADMSG;
+
+	kapi_cp_pad(out, len, v, l);
+	return 0;
+}
+
+/* SEQUENCE { INTEGER r, INTEGER s } into c and d */
+static int kapi_der_sig(const uint8_t *sig, uint32_t sig_len, uint8_t *c,
+			uint8_t *d, uint32_t len)
+{
+	const uint8_t *p = sig + 2, *end;
+	uint32_t l;
+
+	if (sig_len < 2 || 0x30 != sig[0])
+		return -EBADMSG;
+	l = sig[1];
+	if (0x81 == l && sig_len >= 3) {
+		l = sig[2];
+		p++;
+	} else if (l & 0x80) {
+		return -EBADMSG;
+	}
+	if (l > sig + sig_len - p)
+		return -EBADMSG;
+	end = p + l;
+
+	return kapi_der_int(&p, end, c, len) ?: kapi_der_int(&p, end, d, len);
+}
+
+/* src carries the DER signature followed by the digest, no dst */
+static int kapi_ecdsa_verify(struct akcipher_request *req)
+{
+	struct kapi_ctx *ctx = akcipher_tfm_ctx(crypto_akcipher_reqtfm(req));
+	struct kapi_req *kreq = akcipher_request_ctx(req);
+	struct dsa_verify_req_s *verify = &kreq->pkc.req_u.dsa_verify;
+	const ecc_curve_t *curve = ctx->curve;
+	uint32_t total = req->src_len + req->dst_len;
+	uint8_t *c, *d;
+	int ret;
+
+	if (!ctx->u.ec.k || !req->dst_len)
+		return -EINVAL;
+
+	if (!kapi_req_init(kreq,
+			   crypto_akcipher_tfm(crypto_akcipher_reqtfm(req)),
+			   &req->base, NULL, NULL, total + 2 * curve->r_len))
+		return -ENOMEM;
+
+	sg_copy_to_buffer(req->src, sg_nents(req->src), kreq->buf, total);
+	c = kreq->buf + total;
+	d = c + curve->r_len;
+	ret = kapi_der_sig(kreq->buf, req->src_len, c, d, curve->r_len);
+	if (ret) {
+		kfree(kreq->buf);
+		return ret;
+	}
+
+	kreq->verify = true;
+	kreq->pkc.type = ECDSA_VERIFY;
+	kreq->pkc.curve_type = curve->type;
+	verify->q = (uint8_t *)curve->q;
+	verify->r = (uint8_t *)curve->r;
+	verify->g = (uint8_t *)curve->g;
+	verify->ab = (uint8_t *)curve->ab;
+	verify->pub_key = ctx->u.ec.k;
+	/* Leftmost bytes of the digest when it is longer than the order */
+	verify->m = kreq->buf + req->src_len;
+	verify->c = c;
+	verify->d = d;
+	verify->q_len = curve->q_len;
+	verify->r_len = curve->r_len;
+	verify->g_len = curve->g_len;
+	verify->ab_len = curve->ab_len;
+	verify->pub_key_len = ctx->u.ec.k_len;
+	verify->m_len = min(req->dst_len, curve->r_len);
+	verify->d_len = curve->r_len;
+
+	return kapi_submit(kreq);
+}
+
+static int kapi_ecdsa_p256_init(struct crypto_akcipher *tfm)
+{
+	return kapi_akcipher_init(tfm, ecc_curve_get(ECC_CURVE_P256));
+}
+
+static int kapi_ecdsa_p384_init(struct crypto_akcipher *tfm)
+{
+	return kapi_akcipher_init(tfm, ecc_curve_get(ECC_CURVE_P384));
+}
+#endif
+
+/* 1 < y < p - 1, both big endian on len bytes, as crypto/dh.c checks y */
+static bool kapi_dh_valid(const uint8_t *y, const uint8_t *p, uint32_t len)
+{
+	uint32_t i, v, carry = 1, high = 0;
+	int cmp = 0;
+
+	/* y + 1 against p, from the least significant byte */
+	for (i = len; i--; ) {
+		v = y[i] + carry;
+		carry = v >> 8;
+		v &= 0xff;
+		if (v != p[i])
+			cmp = (v < p[i]) ? -1 : 1;
+		if (i < len - 1)
+			high |= y[i];
+	}
+
+	return (high || y[len - 1] > 1) && !carry && cmp < 0;
+}
+
+/* Private value of len bytes drawn below n, n having no leading zero byte */
+static int kapi_gen_key(uint8_t *k, const uint8_t *n, uint32_t len,
+			bool (*valid)(const uint8_t *, const uint8_t *,
+				      uint32_t))
+{
+	uint8_t mask = (1 << fls(n[0])) - 1;
+	uint32_t i;
+
+	for (i = 0; i < KAPI_KEYGEN_TRIES; i++) {
+		get_random_bytes(k, len);
+		k[0] &= mask;
+		if (valid(k, n, len))
+			return 0;
+	}
+
+	memzero_explicit(k, len);
+	return -EAGAIN;
+}
+
+/* DH: kpp "dh", a private value is generated when none is given */
+static int kapi_dh_set_secret(struct crypto_kpp *tfm, const void *buf,
+			      unsigned int len)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(tfm);
+	const uint8_t *p, *g, *x;
+	size_t p_len, g_len, x_len;
+	struct dh params;
+	uint8_t *mem;
+
+	if (crypto_dh_decode_key(buf, len, &params) < 0)
+		return -EINVAL;
+
+	p = params.p;
+	g = params.g;
+	x = params.key;
+	p_len = params.p_size;
+	g_len = params.g_size;
+	x_len = params.key_size;
+	kapi_strip(&p, &p_len);
+	kapi_strip(&g, &g_len);
+	kapi_strip(&x, &x_len);
+	if (!p_len || !g_len || p_len > KAPI_RSA_MAX_LEN ||
+	    g_len > p_len || x_len > p_len)
+		return -EINVAL;
+
+	mem = kapi_key_alloc(ctx, 2 * p_len + (x_len ? x_len : p_len));
+	if (!mem)
+		return -ENOMEM;
+
+	ctx->u.dh.p = mem;
+	ctx->u.dh.p_len = p_len;
+	memcpy(mem, p, p_len);
+	ctx->u.dh.g = mem + p_len;
+	kapi_cp_pad(ctx->u.dh.g, p_len, g, g_len);
+	ctx->u.dh.x = mem + 2 * p_len;
+	if (!x_len) {
+		ctx->u.dh.x_len = p_len;
+		return kapi_gen_key(ctx->u.dh.x, ctx->u.dh.p, p_len,
+				    kapi_dh_valid);
+	}
+	ctx->u.dh.x_len = x_len;
+	memcpy(ctx->u.dh.x, x, x_len);
+
+	return 0;
+}
+
+static kapi_size_t kapi_dh_max_size(struct crypto_kpp *tfm)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(tfm);
+
+	return ctx->u.dh.p_len;
+}
+
+/* z = w ^ x mod p, w being g for the public key */
+static int kapi_dh_op(struct kpp_request *req, bool pub)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(crypto_kpp_reqtfm(req));
+	struct kapi_req *kreq = kpp_request_ctx(req);
+	struct dh_key_req_s *dh = &kreq->pkc.req_u.dh_req;
+	uint32_t p_len = ctx->u.dh.p_len;
+
+	if (!p_len || (!pub && (!req->src_len || req->src_len > p_len)))
+		return -EINVAL;
+	if (req->dst_len < p_len) {
+		req->dst_len = p_len;
+		return -EOVERFLOW;
+	}
+
+	if (!kapi_req_init(kreq, crypto_kpp_tfm(crypto_kpp_reqtfm(req)),
+			   &req->base, req->dst, &req->dst_len, 2 * p_len))
+		return -ENOMEM;
+
+	kreq->out = kreq->buf + p_len;
+	kreq->out_len = p_len;
+
+	kreq->pkc.type = DH_COMPUTE_KEY;
+	kreq->pkc.curve_type = DISCRETE_LOG;
+	dh->q = ctx->u.dh.p;
+	dh->s = ctx->u.dh.x;
+	dh->z = kreq->out;
+	dh->q_len = p_len;
+	dh->pub_key_len = p_len;
+	dh->s_len = ctx->u.dh.x_len;
+	dh->z_len = p_len;
+	if (pub) {
+		dh->pub_key = ctx->u.dh.g;
+	} else {
+		sg_copy_to_buffer(req->src, sg_nents(req->src),
+				  kreq->buf + p_len - req->src_len,
+				  req->src_len);
+		if (!kapi_dh_valid(kreq->buf, ctx->u.dh.p, p_len)) {
+			kfree(kreq->buf);
+			return -EINVAL;
+		}
+		dh->pub_key = kreq->buf;
+	}
+
+	return kapi_submit(kreq);
+}
+
+static int kapi_dh_generate_public_key(struct kpp_request *req)
+{
+	return kapi_dh_op(req, true);
+}
+
+static int kapi_dh_compute_shared_secret(struct kpp_request *req)
+{
+	return kapi_dh_op(req, false);
+}
+
+static int kapi_dh_init(struct crypto_kpp *tfm)
+{
+	return kapi_kpp_init(tfm, NULL);
+}
+
+static void kapi_kpp_exit(struct crypto_kpp *tfm)
+{
+	kapi_tfm_exit(crypto_kpp_tfm(tfm));
+}
+
+#ifdef KAPI_ECDH
+/* 0 < k < n, both big endian on len bytes */
+static bool kapi_ec_key_valid(const uint8_t *k, const uint8_t *n, uint32_t len)
+{
+	return memchr_inv(k, 0, len) && memcmp(k, n, len) < 0;
+}
+
+/* ECDH: kpp "ecdh-nist-*", a private key is generated when none is given */
+static int kapi_ecdh_set_secret(struct crypto_kpp *tfm, const void *buf,
+				unsigned int len)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(tfm);
+	const ecc_curve_t *curve = ctx->curve;
+	struct ecdh params;
+
+	if (crypto_ecdh_decode_key(buf, len, &params) < 0)
+		return -EINVAL;
+	if (params.key_size && params.key_size != curve->r_len)
+		return -EINVAL;
+
+	if (!kapi_key_alloc(ctx, curve->r_len))
+		return -ENOMEM;
+
+	ctx->u.ec.k = ctx->key;
+	ctx->u.ec.k_len = curve->r_len;
+	if (!params.key_size)
+		return kapi_gen_key(ctx->u.ec.k, curve->r, curve->r_len,
+				    kapi_ec_key_valid);
+
+	memcpy(ctx->u.ec.k, params.key, params.key_size);
+	if (!kapi_ec_key_valid(ctx->u.ec.k, curve->r, curve->r_len)) {
+		kfree(ctx->key);
+		ctx->key = NULL;
+		ctx->u.ec.k = NULL;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static kapi_size_t kapi_ecdh_max_size(struct crypto_kpp *tfm)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(tfm);
+
+	return ctx->curve->g_len;
+}
+
+/* Public key x || y = k . G, through the PKHA point multiplication */
+static int kapi_ecdh_generate_public_key(struct kpp_request *req)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(crypto_kpp_reqtfm(req));
+	struct kapi_req *kreq = kpp_request_ctx(req);
+	struct keygen_req_s *keygen = &kreq->pkc.req_u.keygen;
+	const ecc_curve_t *curve = ctx->curve;
+
+	if (!ctx->u.ec.k)
+		return -EINVAL;
+	if (req->dst_len < curve->g_len) {
+		req->dst_len = curve->g_len;
+		return -EOVERFLOW;
+	}
+
+	if (!kapi_req_init(kreq, crypto_kpp_tfm(crypto_kpp_reqtfm(req)),
+			   &req->base, req->dst, &req->dst_len, curve->g_len))
+		return -ENOMEM;
+
+	kreq->out = kreq->buf;
+	kreq->out_len = curve->g_len;
+
+	kreq->pkc.type = ECC_KEYGEN;
+	kreq->pkc.curve_type = curve->type;
+	keygen->q = (uint8_t *)curve->q;
+	keygen->g = (uint8_t *)curve->g;
+	keygen->ab = (uint8_t *)curve->ab;
+	keygen->priv_key = ctx->u.ec.k;
+	keygen->pub_key = kreq->out;
+	keygen->q_len = curve->q_len;
+	keygen->g_len = curve->g_len;
+	keygen->ab_len = curve->ab_len;
+	keygen->priv_key_len = ctx->u.ec.k_len;
+	keygen->pub_key_len = curve->g_len;
+
+	return kapi_submit(kreq);
+}
+
+/*
+ * Full public key check of the peer's point, as crypto/ecdh.c does it: below
+ * p, on the curve and of the order of the base point
+ */
+static int kapi_ecdh_check_peer(struct kapi_ctx *ctx, const uint8_t *point)
+{
+	uint32_t ndigits = ctx->curve->q_len / sizeof(u64);
+	u64 x[ECC_MAX_DIGITS], y[ECC_MAX_DIGITS];
+	struct ecc_point pk = ECC_POINT_INIT(x, y, ndigits);
+
+	ecc_swap_digits((const u64 *)point, x, ndigits);
+	ecc_swap_digits((const u64 *)(point + ctx->curve->q_len), y, ndigits);
+
+	return ecc_is_pubkey_valid_full(ctx->ecc, &pk);
+}
+
+/* Shared secret: x coordinate of k times the peer's point */
+static int kapi_ecdh_compute_shared_secret(struct kpp_request *req)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(crypto_kpp_reqtfm(req));
+	struct kapi_req *kreq = kpp_request_ctx(req);
+	struct dh_key_req_s *dh = &kreq->pkc.req_u.dh_req;
+	const ecc_curve_t *curve = ctx->curve;
+	int ret;
+
+	if (!ctx->u.ec.k || req->src_len != curve->g_len)
+		return -EINVAL;
+	if (req->dst_len < curve->q_len) {
+		req->dst_len = curve->q_len;
+		return -EOVERFLOW;
+	}
+
+	if (!kapi_req_init(kreq, crypto_kpp_tfm(crypto_kpp_reqtfm(req)),
+			   &req->base, req->dst, &req->dst_len,
+			   curve->g_len + curve->q_len))
+		return -ENOMEM;
+
+	sg_copy_to_buffer(req->src, sg_nents(req->src), kreq->buf,
+			  curve->g_len);
+	ret = kapi_ecdh_check_peer(ctx, kreq->buf);
+	if (ret) {
+		kfree(kreq->buf);
+		return ret;
+	}
+	kreq->out = kreq->buf + curve->g_len;
+	kreq->out_len = curve->q_len;
+
+	kreq->pkc.type = ECDH_COMPUTE_KEY;
+	kreq->pkc.curve_type = curve->type;
+	dh->q = (uint8_t *)curve->q;
+	dh->ab = (uint8_t *)curve->ab;
+	dh->pub_key = kreq->buf;
+	dh->s = ctx->u.ec.k;
+	dh->z = kreq->out;
+	dh->q_len = curve->q_len;
+	dh->ab_len = curve->ab_len;
+	dh->pub_key_len = curve->g_len;
+	dh->s_len = ctx->u.ec.k_len;
+	dh->z_len = curve->q_len;
+
+	return kapi_submit(kreq);
+}
+
+static int kapi_ecdh_init(struct crypto_kpp *tfm, ecc_curve_id_t id,
+			  unsigned int kernel_id)
+{
+	struct kapi_ctx *ctx = kpp_tfm_ctx(tfm);
+
+	ctx->ecc = ecc_get_curve(kernel_id);
+	if (!ctx->ecc)
+		return -EINVAL;
+
+	return kapi_kpp_init(tfm, ecc_curve_get(id));
+}
+
+static int kapi_ecdh_p256_init(struct crypto_kpp *tfm)
+{
+	return kapi_ecdh_init(tfm, ECC_CURVE_P256, ECC_CURVE_NIST_P256);
+}
+
+static int kapi_ecdh_p384_init(struct crypto_kpp *tfm)
+{
+	return kapi_ecdh_init(tfm, ECC_CURVE_P384, ECC_CURVE_NIST_P384);
+}
+#endif /* KAPI_ECDH */
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0))
+/* Set on the tfm by kapi_akcipher_init() and kapi_kpp_init() */
+#define KAPI_REQSIZE
+#else
+#define KAPI_REQSIZE	.reqsize = sizeof(struct kapi_req),
+#endif
+
+#define KAPI_CRA_BASE(_name, _driver_name)				\
+	{								\
+		.cra_name = _name,					\
+		.cra_driver_name = _driver_name,			\
+		.cra_priority = FSL_CRA_PRIORITY,			\
+		.cra_flags = CRYPTO_ALG_ASYNC,				\
+		.cra_ctxsize = sizeof(struct kapi_ctx),			\
+		.cra_module = THIS_MODULE,				\
+	}
+
+static struct akcipher_alg kapi_akciphers[] = {
+	{
+		.encrypt = kapi_rsa_pub,
+		.decrypt = kapi_rsa_priv,
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 2, 0))
+		/* Raw RSA has no sign / verify from 5.2 on */
+		.sign = kapi_rsa_priv,
+		.verify = kapi_rsa_pub,
+#endif
+		.set_pub_key = kapi_rsa_set_pub_key,
+		.set_priv_key = kapi_rsa_set_priv_key,
+		.max_size = kapi_rsa_max_size,
+		.init = kapi_rsa_init,
+		.exit = kapi_akcipher_exit,
+		KAPI_REQSIZE
+		.base = KAPI_CRA_BASE("rsa", "rsa-fsl"),
+	},
+#ifdef KAPI_ECDSA
+	{
+		.verify = kapi_ecdsa_verify,
+		.set_pub_key = kapi_ecdsa_set_pub_key,
+		.max_size = kapi_ecdsa_max_size,
+		.init = kapi_ecdsa_p256_init,
+		.exit = kapi_akcipher_exit,
+		KAPI_REQSIZE
+		.base = KAPI_CRA_BASE("ecdsa-nist-p256", "ecdsa-nist-p256-fsl"),
+	},
+	{
+		.verify = kapi_ecdsa_verify,
+		.set_pub_key = kapi_ecdsa_set_pub_key,
+		.max_size = kapi_ecdsa_max_size,
+		.init = kapi_ecdsa_p384_init,
+		.exit = kapi_akcipher_exit,
+		KAPI_REQSIZE
+		.base = KAPI_CRA_BASE("ecdsa-nist-p384", "ecdsa-nist-p384-fsl"),
+	},
+#endif
+};
+
+static struct kpp_alg kapi_kpps[] = {
+	{
+		.set_secret = kapi_dh_set_secret,
+		.generate_public_key = kapi_dh_generate_public_key,
+		.compute_shared_secret = kapi_dh_compute_shared_secret,
+		.max_size = kapi_dh_max_size,
+		.init = kapi_dh_init,
+		.exit = kapi_kpp_exit,
+		KAPI_REQSIZE
+		.base = KAPI_CRA_BASE("dh", "dh-fsl"),
+	},
+#ifdef KAPI_ECDH
+	{
+		.set_secret = kapi_ecdh_set_secret,
+		.generate_public_key = kapi_ecdh_generate_public_key,
+		.compute_shared_secret = kapi_ecdh_compute_shared_secret,
+		.max_size = kapi_ecdh_max_size,
+		.init = kapi_ecdh_p256_init,
+		.exit = kapi_kpp_exit,
+		KAPI_REQSIZE
+		.base = KAPI_CRA_BASE("ecdh-nist-p256", "ecdh-nist-p256-fsl"),
+	},
+	{
+		.set_secret = kapi_ecdh_set_secret,
+		.generate_public_key = kapi_ecdh_generate_public_key,
+		.compute_shared_secret = kapi_ecdh_compute_shared_secret,
+		.max_size = kapi_ecdh_max_size,
+		.init = kapi_ecdh_p384_init,
+		.exit = kapi_kpp_exit,
+		KAPI_REQSIZE
+		.base = KAPI_CRA_BASE("ecdh-nist-p384", "ecdh-nist-p384-fsl"),
+	},
+#endif
+};
+
+/* Registered algorithms, for fsl_pkc_kapi_exit() after a partial init */
+static unsigned int kapi_akciphers_reg;
+static unsigned int kapi_kpps_reg;
+
+/*******************************************************************************
+ * Function     : fsl_pkc_kapi_init
+ *
+ * Arguments    : void
+ *
+ * Return Value : Error code
+ *
+ * Description  : Registers the akcipher and kpp algorithms.
+ *
+ ******************************************************************************/
+int32_t fsl_pkc_kapi_init(void)
+{
+	struct akcipher_alg *akcipher;
+	struct kpp_alg *kpp;
+	int err;
+
+	for (; kapi_akciphers_reg < ARRAY_SIZE(kapi_akciphers);
+	     kapi_akciphers_reg++) {
+		akcipher = &kapi_akciphers[kapi_akciphers_reg];
+		err = crypto_register_akcipher(akcipher);
+		if (err) {
+			print_error("%s alg registration failed\n",
+				    akcipher->base.cra_driver_name);
+			return err;
+		}
+	}
+
+	for (; kapi_kpps_reg < ARRAY_SIZE(kapi_kpps); kapi_kpps_reg++) {
+		kpp = &kapi_kpps[kapi_kpps_reg];
+		err = crypto_register_kpp(kpp);
+		if (err) {
+			print_error("%s alg registration failed\n",
+				    kpp->base.cra_driver_name);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/*******************************************************************************
+ * Function     : fsl_pkc_kapi_exit
+ *
+ * Arguments    : void
+ *
+ * Return Value : None
+ *
+ * Description  : Deregisters the akcipher and kpp algorithms.
+ *
+ ******************************************************************************/
+void fsl_pkc_kapi_exit(void)
+{
+	while (kapi_kpps_reg)
+		crypto_unregister_kpp(&kapi_kpps[--kapi_kpps_reg]);
+
+	while (kapi_akciphers_reg) {
+		kapi_akciphers_reg--;
+		crypto_unregister_akcipher(&kapi_akciphers[kapi_akciphers_reg]);
+	}
+}
+#endif /* PKC_KAPI */
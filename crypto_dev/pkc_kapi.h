@@ -0,0 +1,79 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FSL_PKC_KAPI_H
+#define FSL_PKC_KAPI_H
+
+/*******************************************************************************
+ * akcipher (rsa, ecdsa-nist-*) and kpp (dh, ecdh) algorithms of the mainline
+ * crypto API, for in-kernel users that do not know the pkc(*) algorithms.
+ * The requests are translated into pkc_requests on the tfm of the caller
+ * and go through rsa_op(), dsa_op(), dh_op() and pkha_ecmul_op() like the
+ * pkc(*) ones. ecdh needs the kernel's ECC helpers (5.16 on) to check the
+ * peer's point, and ecdsa is left out from 6.13 on, where the kernel only
+ * verifies signatures synchronously.
+ *
+ * pkc_kapi_req() tells such a pkc_request from one of a pkc(*) tfm, and
+ * pkc_kapi_op() submits it again, e.g. when its device was reset.
+ ******************************************************************************/
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 8, 0))
+#define PKC_KAPI
+
+int32_t fsl_pkc_kapi_init(void);
+void fsl_pkc_kapi_exit(void);
+bool pkc_kapi_req(struct pkc_request *req);
+int pkc_kapi_op(struct pkc_request *req);
+#else
+static inline int32_t fsl_pkc_kapi_init(void)
+{
+	return 0;
+}
+
+static inline void fsl_pkc_kapi_exit(void)
+{
+}
+
+static inline bool pkc_kapi_req(struct pkc_request *req)
+{
+	return false;
+}
+
+static inline int pkc_kapi_op(struct pkc_request *req)
+{
+	return -EINVAL;
+}
+#endif
+
+#endif
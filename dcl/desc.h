@@ -297,6 +297,19 @@ struct sec4_sg_entry {
 #define LDOFF_CHG_SEQLIODN_NON_SEQ	(0x2 << LDOFF_CHG_SEQLIODN_SHIFT)
 #define LDOFF_CHG_SEQLIODN_TRUSTED	(0x3 << LDOFF_CHG_SEQLIODN_SHIFT)
 
+/* CLRW - Clear Written register bits */
+#define CLRW_CLR_C1MODE			(1 << 0)
+#define CLRW_CLR_C1DATAS		(1 << 2)
+#define CLRW_CLR_C1ICV			(1 << 3)
+#define CLRW_CLR_C1CTX			(1 << 5)
+#define CLRW_CLR_C1KEY			(1 << 6)
+#define CLRW_CLR_PK_A			(1 << 12)
+#define CLRW_CLR_PK_B			(1 << 13)
+#define CLRW_CLR_PK_N			(1 << 14)
+#define CLRW_CLR_PK_E			(1 << 15)
+#define CLRW_RESET_CLS1_DONE		(1 << 27)
+#define CLRW_RESET_CLS1_CHA		(1 << 29)
+
 /* Data length in bytes	*/
 #define LDST_LEN_SHIFT		0
 #define LDST_LEN_MASK		(0xff << LDST_LEN_SHIFT)
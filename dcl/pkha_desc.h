@@ -0,0 +1,147 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FSL_PKC_PKHA_DESC_H
+#define FSL_PKC_PKHA_DESC_H
+
+#include "desc_constr.h"
+
+/* Job descriptor sizes of the raw PKHA operations below */
+#define PKHA_MODEXP_DESC_LEN	(CAAM_CMD_SZ * 6 + CAAM_PTR_SZ * 4)
+#define PKHA_ECMUL_DESC_LEN	(CAAM_CMD_SZ * 10 + CAAM_PTR_SZ * 8)
+#define PKHA_PRIME_TEST_DESC_LEN	(CAAM_CMD_SZ * 11 + CAAM_PTR_SZ * 4)
+
+/* User status the primality descriptor halts with on a composite candidate */
+#define PKHA_PRIME_TEST_COMPOSITE	0x5c
+#define PKHA_STATUS_SRC(status)		((u32)(status) >> 28)
+#define PKHA_STATUS_SRC_JUMP		0x3
+#define PKHA_STATUS_USER(status)	((u32)(status) & 0xff)
+
+/*******************************************************************************
+Description :	B = A ^ E mod N on the PKHA, without any protocol framing.
+Fields      :	n	: Modulus, n_len bytes
+		a	: Base, a_len bytes, must be less than N
+		e	: Exponent, e_len bytes
+		b	: Result, n_len bytes
+*******************************************************************************/
+static inline void pkha_modexp_desc(u32 *desc,
+				    dev_dma_addr_t n, u32 n_len,
+				    dev_dma_addr_t a, u32 a_len,
+				    dev_dma_addr_t e, u32 e_len,
+				    dev_dma_addr_t b)
+{
+	init_sym_job_desc(desc, 0);
+	append_fifo_load(desc, n, n_len, FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_N);
+	append_fifo_load(desc, a, a_len, FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_A);
+	append_key(desc, e, e_len, CLASS_1 | KEY_DEST_PKHA_E);
+	append_operation(desc, OP_TYPE_PK | OP_ALG_PK |
+			 OP_ALG_PKMODE_MOD_EXPO | OP_ALG_PKMODE_OUT_B);
+	append_fifo_store(desc, b, n_len, FIFOST_TYPE_PKHA_B);
+}
+
+/*******************************************************************************
+Description :	(x, y) = k . P on the PKHA, without any protocol framing.
+Fields      :	f2m	: Binary curve, q is the irreducible polynomial
+		q	: Field prime/polynomial, q_len bytes
+		p	: Point (x, y), 2 * q_len bytes
+		ab	: Curve coefficients (a, b) in the layout the ECC
+			  protocol descriptors take, 2 * q_len bytes
+		k	: Scalar, k_len bytes
+		out	: Resulting point (x, y), 2 * q_len bytes
+*******************************************************************************/
+static inline void pkha_ecmul_desc(u32 *desc, bool f2m,
+				   dev_dma_addr_t q, u32 q_len,
+				   dev_dma_addr_t p, dev_dma_addr_t ab,
+				   dev_dma_addr_t k, u32 k_len,
+				   dev_dma_addr_t out)
+{
+	init_sym_job_desc(desc, 0);
+	append_fifo_load(desc, q, q_len, FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_N);
+	append_fifo_load(desc, p, q_len, FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_A0);
+	append_fifo_load(desc, p + q_len, q_len,
+			 FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_A1);
+	append_fifo_load(desc, ab, q_len, FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_A3);
+	append_fifo_load(desc, ab + q_len, q_len,
+			 FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_B0);
+	append_key(desc, k, k_len, CLASS_1 | KEY_DEST_PKHA_E);
+	append_operation(desc, OP_TYPE_PK | OP_ALG_PK |
+			 OP_ALG_PKMODE_MOD_ECC_MULT |
+			 (f2m ? OP_ALG_PKMODE_MOD_F2M : 0));
+	append_fifo_store(desc, out, q_len, FIFOST_TYPE_PKHA_B1);
+	append_fifo_store(desc, out + q_len, q_len, FIFOST_TYPE_PKHA_B2);
+}
+
+/*******************************************************************************
+Description :	Probabilistic (Miller-Rabin) primality test of N on the PKHA.
+		The witness seed is drawn from the SEC RNG by the same job, the
+		PKHA runs all the rounds and the job halts with
+		PKHA_PRIME_TEST_COMPOSITE unless every round passed.
+Fields      :	n	: Candidate, n_len bytes
+		seed	: Scratch buffer of n_len bytes for the witness seed
+		rounds	: Round count, one byte
+*******************************************************************************/
+static inline void pkha_prime_test_desc(u32 *desc,
+					dev_dma_addr_t n, u32 n_len,
+					dev_dma_addr_t seed,
+					dev_dma_addr_t rounds)
+{
+	u32 *jump_cmd;
+
+	init_sym_job_desc(desc, 0);
+
+	/* Random witness seed */
+	append_operation(desc, OP_ALG_ALGSEL_RNG | OP_TYPE_CLASS1_ALG);
+	append_fifo_store(desc, seed, n_len, FIFOST_TYPE_RNGSTORE);
+
+	/* Let the RNG finish and hand class 1 over to the PKHA */
+	jump_cmd = append_jump(desc, JUMP_CLASS_CLASS1 | JUMP_COND_CALM);
+	set_jump_tgt_here(desc, jump_cmd);
+	append_load_imm_u32(desc, CLRW_CLR_C1MODE | CLRW_RESET_CLS1_DONE |
+			    CLRW_RESET_CLS1_CHA, LDST_SRCDST_WORD_CLRW);
+
+	append_fifo_load(desc, n, n_len, FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_N);
+	append_fifo_load(desc, seed, n_len,
+			 FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_A);
+	append_fifo_load(desc, rounds, 1, FIFOLD_CLASS_CLASS1 | FIFOLD_TYPE_PK_B);
+	append_operation(desc, OP_TYPE_PK | OP_ALG_PK |
+			 OP_ALG_PKMODE_MOD_PRIMALITY);
+
+	/* Halt with the user status unless the PKHA reported a prime */
+	append_jump(desc, JUMP_TYPE_HALT_USER | JUMP_CLASS_CLASS1 |
+		    JUMP_TEST_INVALL | JUMP_COND_PK_PRIME |
+		    PKHA_PRIME_TEST_COMPOSITE);
+}
+
+#endif
@@ -39,9 +39,12 @@
 #include "command.h"
 #include "sysfs.h"
 #include "memmgr.h"
+#include "algs.h"
+#include "ecc_curves.h"
 
 /* Functions used in case of reset commands for smooth exit */
-static int32_t wait_for_cmd_response(cmd_op_t *cmd_op);
+static int32_t wait_for_cmd_response(fsl_crypto_dev_t *c_dev,
+				     cmd_op_t *cmd_op, bool *orphan);
 static cmd_op_t *get_cmd_op_ctx(fsl_crypto_dev_t *c_dev,
 				cmd_ring_entry_desc_t *pci_cmd_desc);
 static void block_app_rings(fsl_crypto_dev_t *dev);
@@ -49,6 +52,26 @@ static void unblock_app_rings(fsl_crypto_dev_t *dev);
 static void flush_app_resp_rings(fsl_crypto_dev_t *dev);
 static void flush_app_req_rings(fsl_crypto_dev_t *c_dev);
 static int32_t flush_app_jobs(fsl_crypto_dev_t *dev);
+static int32_t reconfigure_ring(fsl_crypto_dev_t *c_dev,
+				user_command_args_t *usr_cmd);
+
+/* Slice of a command wait after which ring 0 is polled, in case its
+ * interrupt got lost; the whole wait still gives up after CMD_TIMEOUT_MS */
+static uint32_t cmd_poll_ms = 10;
+module_param(cmd_poll_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(cmd_poll_ms, "Command wait slice before polling ring 0 (ms)");
+
+#define CMD_TIMEOUT_MS	60000
+
+/* Time a quiesced ring gets to complete the jobs already posted to it */
+static uint32_t ring_drain_ms = 5000;
+module_param(ring_drain_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(ring_drain_ms, "Time to drain a ring before reconfiguring it (ms)");
+
+/* Smallest depth an app ring is configured with */
+#define RING_MIN_DEPTH	16
+
+static DEFINE_MUTEX(ring_cfg_mutex);
 
 /*******************************************************************************
 * Function     : process_cmd_response
@@ -57,60 +80,94 @@ static int32_t flush_app_jobs(fsl_crypto_dev_t *dev);
 *
 * Return Value : -
 *
-* Description  : processes the commands for device
+* Description  : hands the firmware result to the command waiting for it.
+*		 Called with cmd_lock held.
 *
 *******************************************************************************/
 void process_cmd_response(fsl_crypto_dev_t *c_dev, dev_dma_addr_t desc,
 			  int32_t result)
 {
-	cmd_op_t *op_mem = NULL;
-	dma_addr_t *h_desc =
-	    (dma_addr_t *) (c_dev->ip_pool.fw_pool.host_map_v_addr +
-			    (desc - c_dev->ip_pool.fw_pool.dev_p_addr));
-	dev_dma_addr_t op_buf_addr = 0;
+	cmd_trace_ctx_t *ctx;
 
-	cmd_ring_entry_desc_t *cmd_desc = NULL;
-
-	print_debug("h_desc %p\n", h_desc);
 	print_debug("Desc: %llx, Result: %x\n", (uint64_t)desc, result);
 
-	cmd_desc = (cmd_ring_entry_desc_t *) h_desc;
-
-	print_debug("cmd_desc: %p\n", cmd_desc);
-	print_debug("cmd_desc->cmd_op: %llx\n", (uint64_t)cmd_desc->cmd_op);
-
-	IOREAD64BE(op_buf_addr, &(cmd_desc->cmd_op));
-
-	print_debug("Dev domain output buffer address: %llx\n", op_buf_addr);
+	list_for_each_entry(ctx, &c_dev->cmd_list, list) {
+		if (ctx->desc_addr != desc)
+			continue;
+
+		list_del_init(&ctx->list);
+		if (ctx->orphan) {
+			/* Nobody waits any more, the buffers are ours */
+			put_buffer(c_dev, c_dev->ring_pairs[0].ip_pool,
+				   ctx->desc);
+			free_buffer(c_dev->op_pool.pool, ctx->op);
+			kfree(ctx);
+			return;
+		}
 
-	if (0 == op_buf_addr) {
-		print_debug("No output buffer address for the command.....\n");
+		print_debug("response for command type: %d\n", ctx->cmd_type);
+		ctx->result = result;
+		complete(&(ctx->cmd_completion));
 		return;
 	}
 
-	print_debug("DEV_P_ADDR: %llx   HOST_V_ADDR: %p\n",
-		    (uint64_t)c_dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr,
-		    c_dev->priv_dev->bars[MEM_TYPE_DRIVER].host_v_addr);
-
-	op_buf_addr = (dev_dma_addr_t) (op_buf_addr - c_dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr);
-	print_debug("Offset in device domain: %llx\n", (uint64_t)op_buf_addr);
-
-	op_buf_addr = (op_buf_addr - c_dev->priv_dev->bars[MEM_TYPE_DRIVER].host_p_addr);
-	print_debug("Offset in host domain: %llx\n", (uint64_t)op_buf_addr);
-
-	op_mem = (cmd_op_t *) (c_dev->priv_dev->bars[MEM_TYPE_DRIVER].host_v_addr +
-			  (unsigned long)op_buf_addr);
-	print_debug("Buffer virtual address: %p\n", op_mem);
+	print_error("No command waiting for desc %llx\n", (uint64_t)desc);
+}
 
-	op_mem = (cmd_op_t *) ((unsigned long)op_mem - sizeof(cmd_trace_ctx_t *));
-	print_debug("response for command type: %d\n", op_mem->cmd_ctx->cmd_type);
+/*******************************************************************************
+* Function     : process_cmd_ring
+*
+* Arguments    : c_dev - crypto device
+*
+* Return Value : -
+*
+* Description  : consumes all the responses posted on the command ring. Runs
+*		 from the response bottom half and from waiters polling.
+*
+*******************************************************************************/
+void process_cmd_ring(fsl_crypto_dev_t *c_dev)
+{
+	fsl_h_rsrc_ring_pair_t *rp = &(c_dev->ring_pairs[0]);
+	uint64_t desc;
+	int32_t res;
+
+	spin_lock_bh(&c_dev->cmd_lock);
+	while (rc_resp_pending(rp->counters, rp->s_c_counters)) {
+		rc_resp_peek(rp->resp_r, rp->indexes, &desc, &res);
+		if (desc)
+			process_cmd_response(c_dev, desc, res);
+		rc_resp_next(rp->depth, rp->indexes, rp->counters,
+			     rp->shadow_counters);
+	}
+	spin_unlock_bh(&c_dev->cmd_lock);
+}
 
-	print_debug("JOB COMPLETED, op_mem: %p, cmd_ctx: %p, cmd_completion: %p\n",
-	     op_mem, op_mem->cmd_ctx, &(op_mem->cmd_ctx->cmd_completion));
-	if (op_mem->cmd_ctx) {
-		op_mem->cmd_ctx->result = result;
-		complete(&(op_mem->cmd_ctx->cmd_completion));
+/*******************************************************************************
+* Function     : cleanup_cmd_ctxs
+*
+* Arguments    : c_dev - crypto device
+*
+* Return Value : -
+*
+* Description  : drops the pending commands before the pools they use go
+*		 away. Waiters are failed, the buffers go with their pools.
+*
+*******************************************************************************/
+void cleanup_cmd_ctxs(fsl_crypto_dev_t *c_dev)
+{
+	cmd_trace_ctx_t *ctx, *tmp;
+
+	spin_lock_bh(&c_dev->cmd_lock);
+	list_for_each_entry_safe(ctx, tmp, &c_dev->cmd_list, list) {
+		list_del_init(&ctx->list);
+		if (ctx->orphan) {
+			kfree(ctx);
+		} else {
+			ctx->result = -1;
+			complete(&(ctx->cmd_completion));
+		}
 	}
+	spin_unlock_bh(&c_dev->cmd_lock);
 }
 
 /*******************************************************************************
@@ -268,6 +325,10 @@ dconfig:
 		list_del(&(crypto_dev->ring_pairs[i].bh_ctx_list_node));
 	}
 
+	/* The resident curves go away with the input pool */
+	cleanup_ecc_curves(crypto_dev);
+	cleanup_cmd_ctxs(crypto_dev);
+
 	/* FREE THE CURRENT RINGS */
 	kfree(crypto_dev->ring_pairs);
 	/* REALLOCATE OB MEMORY */
@@ -322,8 +383,13 @@ dconfig:
 	dev->c_hs_mem->state = READY;
 
 	/* Do the handshake */
-	return handshake(crypto_dev, curr_config);
+	if (handshake(crypto_dev, curr_config))
+		return -1;
 
+	if (load_ecc_curves(crypto_dev))
+		print_error("Named curves not loaded, using request params\n");
+
+	return 0;
 }
 
 /*******************************************************************************
@@ -378,6 +444,25 @@ int32_t validate_cmd_args(fsl_crypto_dev_t *c_dev, user_command_args_t *cmd)
 			filp_close(file, 0);
 		}
 		break;
+	case RINGCONFIG:
+		{
+			ring_cfg_ip_t *cfg = &cmd->rsrc.ring_cfg;
+			int max_prio = APP_RING_PROP_PRIO_MASK >>
+				       APP_RING_PROP_PRIO_SHIFT;
+
+			/* Ring 0 carries the commands themselves */
+			if (cfg->ring_id < 1 || cfg->ring_id >= c_dev->num_of_rings)
+				return -1;
+			if (cfg->depth >= 0 && (cfg->depth < RING_MIN_DEPTH ||
+			    (cfg->depth & (cfg->depth - 1)) || cfg->depth >
+			    c_dev->ring_pairs[cfg->ring_id].max_depth))
+				return -1;
+			if (0 == cfg->priority || cfg->priority > max_prio)
+				return -1;
+			if (cfg->affinity > (int)c_dev->dev_info.num_sec_engines)
+				return -1;
+		}
+		break;
 	case DEBUG:
 	case DEVSTAT:
 	case PINGDEV:
@@ -426,6 +511,8 @@ int32_t process_cmd_req(fsl_crypto_dev_t *c_dev,
 	cpu = get_cpu();
 
 	dev_stat = per_cpu_ptr(c_dev->dev_status, cpu);
+	/* The commands sleep on the firmware, RINGCONFIG on a ring drain */
+	put_cpu();
 	if (NULL == dev_stat) {
 		print_error("per_cpu_ptr failed process_cmd_req\n");
 		return -1;
@@ -513,6 +600,13 @@ int32_t process_cmd_req(fsl_crypto_dev_t *c_dev,
 		set_device_status_per_cpu(c_dev, 1);
 		break;
 
+	case RINGCONFIG:
+		result = reconfigure_ring(c_dev, usr_cmd_desc);
+		if (result) {
+			print_error("Ring reconfiguration failed....\n");
+		}
+		break;
+
 	case DEBUG:
 		print_debug("DEBUGGGING...\n");
 		print_debug("GOT DEBUG COMMAND: %d\n", usr_cmd_desc->rsrc.dgb.cmd_id);
@@ -543,29 +637,33 @@ out:
 	return 0;
 }
 
-static int32_t wait_for_cmd_response(cmd_op_t *cmd_op)
+static int32_t wait_for_cmd_response(fsl_crypto_dev_t *c_dev,
+				     cmd_op_t *cmd_op, bool *orphan)
 {
+	cmd_trace_ctx_t *ctx = cmd_op->cmd_ctx;
+	unsigned long end = jiffies + msecs_to_jiffies(CMD_TIMEOUT_MS);
+	unsigned long slice = msecs_to_jiffies(cmd_poll_ms) ? : 1;
 	int32_t ret = -1;
-	int32_t wait_counter = 60;
 
-	if (NULL != cmd_op) {
-		print_debug("Waiting for command completion.....\n");
-
-		while (wait_counter-- > 0) {
-			set_current_state(TASK_INTERRUPTIBLE);
-			schedule_timeout(msecs_to_jiffies(1000));
-
-			if (1 ==
-			    try_wait_for_completion(&
-						    (cmd_op->cmd_ctx->
-						     cmd_completion))) {
-				ret = cmd_op->cmd_ctx->result;
-				break;
-			}
-		}
-		print_debug("Result from fw: %d\n", ret);
-	}
+	print_debug("Waiting for command completion.....\n");
 
+	do {
+		if (wait_for_completion_timeout(&(ctx->cmd_completion), slice)) {
+			ret = ctx->result;
+			goto out;
+		}
+		process_cmd_ring(c_dev);
+	} while (time_before(jiffies, end));
+
+	/* A late response must not find the buffers freed under it */
+	spin_lock_bh(&c_dev->cmd_lock);
+	if (list_empty(&ctx->list))
+		ret = ctx->result;
+	else
+		*orphan = ctx->orphan = true;
+	spin_unlock_bh(&c_dev->cmd_lock);
+out:
+	print_debug("Result from fw: %d\n", ret);
 	return ret;
 }
 
@@ -593,6 +691,7 @@ static cmd_op_t *get_cmd_op_ctx(fsl_crypto_dev_t *c_dev,
 	print_debug("CMD CTX: %p\n", cmd_op->cmd_ctx);
 
 	init_completion(&(cmd_op->cmd_ctx->cmd_completion));
+	INIT_LIST_HEAD(&(cmd_op->cmd_ctx->list));
 
 	print_debug("host_p_addr: %pa\n", &(c_dev->priv_dev->bars[MEM_TYPE_DRIVER].host_p_addr));
 	print_debug("host_v_addr: %p\n", c_dev->priv_dev->bars[MEM_TYPE_DRIVER].host_v_addr);
@@ -630,6 +729,7 @@ int32_t send_command_to_fw(fsl_crypto_dev_t *c_dev, commands_t command,
 	void *user_op_buff = NULL;
 
 	dev_dma_addr_t desc_dev_addr = 0;
+	bool orphan = false;
 
 	int32_t ret = 0;
 	print_debug("Sending command: %d to firmware\n", command);
@@ -679,6 +779,18 @@ int32_t send_command_to_fw(fsl_crypto_dev_t *c_dev, commands_t command,
 				&pci_cmd_desc->ip_info.ring_id);
 			user_op_buff = usr_cmd->op_buffer;
 		}
+		if (RINGCONFIG == usr_cmd->cmd_type) {
+			ring_cfg_ip_t *cfg = &usr_cmd->rsrc.ring_cfg;
+			uint8_t flags = c_dev->ring_pairs[cfg->ring_id].info.flags;
+
+			f_set_p(&flags, cfg->priority);
+			f_set_a(&flags, cfg->affinity);
+			iowrite32be(cfg->ring_id,
+				&pci_cmd_desc->ip_info.ring_cfg.ring_id);
+			iowrite32be(cfg->depth,
+				&pci_cmd_desc->ip_info.ring_cfg.depth);
+			iowrite32be(flags, &pci_cmd_desc->ip_info.ring_cfg.flags);
+		}
 		if (PINGDEV == usr_cmd->cmd_type) {
 			iowrite32be(555, &pci_cmd_desc->ip_info.count);
 			user_op_buff = usr_cmd->op_buffer;
@@ -702,8 +814,19 @@ int32_t send_command_to_fw(fsl_crypto_dev_t *c_dev, commands_t command,
 
 	print_debug("Enqueueing CMD DESC ADDR: %llx\n", (uint64_t) desc_dev_addr);
 
+	/* Visible to the response path before the firmware can answer */
+	cmd_op->cmd_ctx->desc_addr = desc_dev_addr;
+	cmd_op->cmd_ctx->desc = pci_cmd_desc;
+	cmd_op->cmd_ctx->op = cmd_op;
+	spin_lock_bh(&c_dev->cmd_lock);
+	list_add_tail(&(cmd_op->cmd_ctx->list), &c_dev->cmd_list);
+	spin_unlock_bh(&c_dev->cmd_lock);
+
 	if (-1 == cmd_ring_enqueue(c_dev, 0, desc_dev_addr)) {
 		print_error("Command ring enqueue failed.....\n");
+		spin_lock_bh(&c_dev->cmd_lock);
+		list_del_init(&(cmd_op->cmd_ctx->list));
+		spin_unlock_bh(&c_dev->cmd_lock);
 		ret = -1;
 		goto exit;
 	} else {
@@ -711,6 +834,11 @@ int32_t send_command_to_fw(fsl_crypto_dev_t *c_dev, commands_t command,
 	}
 
 	if (RESETDEV == command) {
+		/* The device goes away, its cleanup drops the command */
+		spin_lock_bh(&c_dev->cmd_lock);
+		cmd_op->cmd_ctx->orphan = true;
+		spin_unlock_bh(&c_dev->cmd_lock);
+
 		/* No need to do anything if device has been reset */
 		set_sysfs_value(c_dev->priv_dev, FIRMWARE_STATE_SYSFILE,
 				(uint8_t *) "NO FIRMWARE\n",
@@ -725,9 +853,12 @@ int32_t send_command_to_fw(fsl_crypto_dev_t *c_dev, commands_t command,
 
 	print_debug("Going to wait for response for command.. %d, cmd_op : %p\n",
 			command, cmd_op);
-	if (-1 == wait_for_cmd_response(cmd_op)) {
+	if (-1 == wait_for_cmd_response(c_dev, cmd_op, &orphan)) {
 		print_debug("Wait finished but no response from firmware.....\n");
 		ret = -1;
+		/* Still queued on the ring, the response frees it */
+		if (orphan)
+			return ret;
 		goto exit;
 	}
 
@@ -754,6 +885,104 @@ exit:
 	return ret;
 }
 
+/*******************************************************************************
+* Function     : reconfigure_ring
+*
+* Arguments    : c_dev - crypto device, usr_cmd - RINGCONFIG command
+*
+* Return Value : int32_t
+*
+* Description  : quiesces one app ring, lets the jobs on it complete, has the
+*		 firmware take the new depth and properties and resumes the
+*		 ring. The other rings keep serving meanwhile. A ring resizes
+*		 within the slots it got at handshake, growing it further
+*		 takes a rehandshake. -EOPNOTSUPP unless the firmware
+*		 reported FW_CAP_RING_CONFIG when it came up.
+*
+*******************************************************************************/
+static int32_t reconfigure_ring(fsl_crypto_dev_t *c_dev,
+				user_command_args_t *usr_cmd)
+{
+	ring_cfg_ip_t *cfg = &usr_cmd->rsrc.ring_cfg;
+	fsl_h_rsrc_ring_pair_t *rp = &(c_dev->ring_pairs[cfg->ring_id]);
+	struct crypto_dev_config *config;
+	uint8_t crypto_info_str[CRYPTO_INFO_STR_LENGTH];
+	unsigned long end;
+	uint8_t flags;
+	int blocked;
+
+	if (!(c_dev->fw_caps & FW_CAP_RING_CONFIG)) {
+		print_error("Firmware does not support ring reconfiguration\n");
+		return -EOPNOTSUPP;
+	}
+
+	mutex_lock(&ring_cfg_mutex);
+
+	/* Enqueues check the block under the ring lock: once we held it no
+	 * new job gets on the ring. Sessions leave it on their next job */
+	blocked = atomic_xchg(&(rp->block), 1);
+	spin_lock_bh(&rp->ring_lock);
+	spin_unlock_bh(&rp->ring_lock);
+
+	end = jiffies + msecs_to_jiffies(ring_drain_ms);
+	while (!rc_ring_idle(rp->counters)) {
+		if (time_after(jiffies, end)) {
+			print_error("Ring %d did not drain, left as it was\n",
+				    cfg->ring_id);
+			atomic_set(&(rp->block), blocked);
+			mutex_unlock(&ring_cfg_mutex);
+			return -1;
+		}
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule_timeout(msecs_to_jiffies(1));
+	}
+
+	if (cfg->depth < 0)
+		cfg->depth = rp->depth;
+	if (cfg->priority < 0)
+		cfg->priority = f_get_p(rp->info.flags);
+	if (cfg->affinity < 0)
+		cfg->affinity = f_get_a(rp->info.flags);
+
+	/* The firmware stops fetching from the ring, applies the settings
+	 * and restarts its indexes of the ring at 0 */
+	if (-1 == send_command_to_fw(c_dev, RINGCONFIG, usr_cmd)) {
+		print_error("Ring %d not reconfigured by firmware, left as it was\n",
+			    cfg->ring_id);
+		atomic_set(&(rp->block), blocked);
+		mutex_unlock(&ring_cfg_mutex);
+		return -1;
+	}
+
+	flags = rp->info.flags;
+	f_set_p(&flags, cfg->priority);
+	f_set_a(&flags, cfg->affinity);
+
+	spin_lock_bh(&rp->ring_lock);
+	rp->info.flags = flags;
+	rp->info.depth = rp->depth = cfg->depth;
+	rc_ring_restart(rp->indexes);
+	spin_unlock_bh(&rp->ring_lock);
+
+	/* Keep the settings over a rehandshake and report them */
+	config = get_dev_config(c_dev->priv_dev);
+	if (config) {
+		config->ring[cfg->ring_id].depth = cfg->depth;
+		config->ring[cfg->ring_id].flags = flags;
+		if (!prepare_crypto_cfg_info_string(config, crypto_info_str))
+			set_sysfs_value(c_dev->priv_dev, CRYPTO_INFO_SYS_FILE,
+					crypto_info_str,
+					strlen(crypto_info_str));
+	}
+
+	print_debug("Ring %d depth %d priority %d affinity %d\n", cfg->ring_id,
+		    cfg->depth, cfg->priority, cfg->affinity);
+
+	atomic_set(&(rp->block), 0);
+	mutex_unlock(&ring_cfg_mutex);
+	return 0;
+}
+
 static void block_app_rings(fsl_crypto_dev_t *dev)
 {
 	int32_t i = 0;
@@ -856,6 +1085,11 @@ static int32_t flush_app_jobs(fsl_crypto_dev_t *dev)
 		j++;
 	}
 
+#ifndef VIRTIO_C2X0
+	/* Hand the jobs the firmware never picked up to the other devices */
+	failover_app_jobs(dev);
+#endif
+
 	print_debug("# # # # # Flushing app resp rings # # # # #\n");
 	/* Flush the resp ring */
 	flush_app_resp_rings(dev);
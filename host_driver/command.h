@@ -49,6 +49,7 @@ typedef enum commands {
 	SECSTAT,
 	BLOCK_APP_JOBS,
 	UNBLOCK_APP_JOBS,
+	RINGCONFIG,
 } commands_t;
 
 typedef enum debug_commands {
@@ -134,6 +135,14 @@ Fields      :   cmd_type      : type of command
 		result        : result fail/success
 		op_buffer     : output buffer
 *******************************************************************************/
+/* New settings of an app ring, a negative value keeps the current one */
+typedef struct ring_cfg_ip {
+	int ring_id;
+	int depth;
+	int priority;
+	int affinity;
+} ring_cfg_ip_t;
+
 typedef struct user_command_args {
 	commands_t cmd_type;
 	uint32_t dev_id;
@@ -142,6 +151,7 @@ typedef struct user_command_args {
 		int sec_id;
 		int ring_id;
 		debug_ip_t dgb;
+		ring_cfg_ip_t ring_cfg;
 		char config[200];
 	} rsrc;
 
@@ -153,11 +163,21 @@ typedef struct user_command_args {
 Description :   command context
 Fields      :   cmd_type          : type of command
 		cmd_completion    : command completion variable
+		list              : link in the device's pending commands
+		desc_addr         : device address of the command descriptor
+		desc, op          : buffers the command holds in the pools
+		orphan            : waiter gave up, response frees the buffers
 *******************************************************************************/
 typedef struct cmd_trace_ctx {
 	commands_t cmd_type;
 	int32_t result;
 	struct completion cmd_completion;
+
+	struct list_head list;
+	dev_dma_addr_t desc_addr;
+	struct cmd_ring_entry_desc *desc;
+	struct cmd_op *op;
+	bool orphan;
 } cmd_trace_ctx_t;
 
 /*******************************************************************************
@@ -183,6 +203,11 @@ struct cmd_ring_entry_desc {
 		uint32_t sec_id;	/* SEC ENGINE ID */
 		uint32_t count;	/* COUNT VAR TO CKECK LIVELENESS */
 		debug_ip_t dgb;
+		struct {
+			uint32_t ring_id;
+			uint32_t depth;
+			uint32_t flags;
+		} ring_cfg;	/* RING TO QUIESCE, RESIZE AND RESUME */
 	} ip_info;
 	dev_dma_addr_t cmd_op;	/*OP OF THE COMMAND POINTING TO cmd_op_t */
 } __packed;
@@ -197,6 +222,8 @@ int32_t send_command_to_fw(fsl_crypto_dev_t *c_dev, commands_t command,
 			   user_command_args_t *);
 void process_cmd_response(fsl_crypto_dev_t *c_dev, dev_dma_addr_t desc,
 			  int32_t result);
+void process_cmd_ring(fsl_crypto_dev_t *c_dev);
+void cleanup_cmd_ctxs(fsl_crypto_dev_t *c_dev);
 int32_t validate_cmd_args(fsl_crypto_dev_t *, user_command_args_t *);
 extern uint32_t dev_count;
 #endif
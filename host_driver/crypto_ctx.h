@@ -64,6 +64,8 @@ static inline void free_crypto_ctx(void *id, crypto_op_ctx_t *ctx)
 {
 	ctx_pool_t *pool = id;
 
+	sess_job_abort(ctx);
+
 	spin_lock_bh(&pool->ctx_lock);
 	memset(ctx, 0, sizeof(crypto_op_ctx_t));
 	ctx->next = pool->head;
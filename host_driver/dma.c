@@ -71,28 +71,23 @@ MODULE_PARM_DESC(dma_channel_cpu_mask, "CPU mask for dma chnl alloc");
 static int alloc_channel_to_cpu(int cpu, int mask)
 {
 	int i = 0;
+
+	/* Channels past dma_channel_count do not exist */
+	if (dma_channel_count < 32)
+		mask &= (1 << dma_channel_count) - 1;
+
 	if (!mask) {
 		print_info("No DMA channel is allocated for CPU: %d\n", cpu);
 		print_info("Please check the dma_channel_cpu_mask\n");
 		return -1;
 	}
 
-	for (i = 0; i < dma_channel_count; i++) {
-		if (mask & (1 << i)) {
+	for (i = 0; i < dma_channel_count; i++)
+		if (mask & (1 << i))
 			print_debug("DMA channel: %d for CPU: %d\n", i, cpu);
-			if (!per_cpu_dma[cpu].head)
-				per_cpu_dma[cpu].head =
-				    &(hostdma.dma_channels[i]);
-			if (per_cpu_dma[cpu].tail)
-				per_cpu_dma[cpu].tail->next =
-				    &(hostdma.dma_channels[i]);
-			per_cpu_dma[cpu].tail = &(hostdma.dma_channels[i]);
-			/* Make it circular */
-			hostdma.dma_channels[i].next = per_cpu_dma[cpu].head;
-			if (!per_cpu_dma[cpu].cursor)
-				per_cpu_dma[cpu].cursor = per_cpu_dma[cpu].head;
-		}
-	}
+
+	per_cpu_dma[cpu].mask = mask;
+	per_cpu_dma[cpu].cursor = 0;
 
 	return 0;
 }
@@ -182,95 +177,289 @@ free_channels:
 }
 #endif
 
-static int32_t prep_dma_tx(dma_addr_t s_dma_addr, dma_addr_t d_dma_addr,
-			   uint32_t len, chnl_info_t *dma_chnl,
-			   void (*cb) (void *), void *param)
+static uint32_t dma_batch_max = 16;
+module_param(dma_batch_max, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_batch_max, "Jobs whose operands go to the device in one DMA transfer");
+
+static uint32_t dma_numa_local = 1;
+module_param(dma_numa_local, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_numa_local, "Prefer the DMA channels on the NUMA node of the submitting CPU");
+
+static int dma_stats_get(char *buf, const struct kernel_param *kp);
+
+static const struct kernel_param_ops dma_stats_ops = {
+	.get = dma_stats_get,
+};
+module_param_cb(dma_stats, &dma_stats_ops, NULL, S_IRUGO);
+MODULE_PARM_DESC(dma_stats, "Per DMA channel: queued jobs and bytes, peak queued jobs, jobs and bytes copied");
+
+static int dma_chnl_node(chnl_info_t *dma_chnl)
 {
-	struct dma_device *dma_dev = dma_chnl->chnl->device;
-	struct dma_async_tx_descriptor *dma_desc = NULL;
-	dma_cookie_t dma_cookie = { 0 };
-	enum dma_ctrl_flags dma_flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+	return dev_to_node(dma_chnl->chnl->device->dev);
+}
 
-#if LINUX_VERSION_CODE < KERNEL_VERSION(3,12,0)
-	dma_flags |= DMA_COMPL_SKIP_DEST_UNMAP;
-#endif
+static void dma_job_add(dma_job_list_t *list, crypto_op_ctx_t *ctx)
+{
+	ctx->next = NULL;
+	if (list->tail)
+		list->tail->next = ctx;
+	else
+		list->head = ctx;
+	list->tail = ctx;
+}
 
-	dma_desc =
-	    dma_dev->device_prep_dma_memcpy(dma_chnl->chnl, d_dma_addr,
-					    s_dma_addr, len, dma_flags);
-	if (unlikely(!dma_desc)) {
-		print_error("DMA desc constr failed...\n");
-		goto error;
+static crypto_op_ctx_t *dma_job_pop(dma_job_list_t *list)
+{
+	crypto_op_ctx_t *ctx = list->head;
+
+	if (ctx) {
+		list->head = ctx->next;
+		if (!list->head)
+			list->tail = NULL;
+		ctx->next = NULL;
 	}
+	return ctx;
+}
 
-	dma_desc->callback = cb;
-	dma_desc->callback_param = param;
+/* Appends src behind dst and empties it */
+static void dma_job_splice(dma_job_list_t *dst, dma_job_list_t *src)
+{
+	if (!src->head)
+		return;
+	if (dst->tail)
+		dst->tail->next = src->head;
+	else
+		dst->head = src->head;
+	dst->tail = src->tail;
+	src->head = src->tail = NULL;
+}
 
-	dma_cookie = dma_desc->tx_submit(dma_desc);
-	if (dma_submit_error(dma_cookie)) {
-		print_error("DMA submit error...\n");
+/* One source/destination pair per operand chunk of the job: the contiguous
+ * chunk at dest_buff_dma and, with split_ip, each BT_IP buffer */
+static int32_t dma_map_job(struct device *dev, crypto_mem_info_t *mem_info)
+{
+	struct scatterlist *ip, *op;
+	int32_t i = 0;
+
+	mem_info->ip_sg = kcalloc(mem_info->sg_cnt, sizeof(struct scatterlist),
+				  GFP_ATOMIC);
+	mem_info->op_sg = kcalloc(mem_info->sg_cnt, sizeof(struct scatterlist),
+				  GFP_ATOMIC);
+	if (!mem_info->ip_sg || !mem_info->op_sg) {
+		print_error("Mem alloc failed for the DMA sg\n");
 		goto error;
 	}
 
-	/* Trigger the transaction */
-	dma_async_issue_pending(dma_chnl->chnl);
+	ip = mem_info->ip_sg;
+	op = mem_info->op_sg;
+
+	sg_init_table(ip, mem_info->sg_cnt);
+	sg_init_table(op, mem_info->sg_cnt);
+
+	sg_set_buf(ip++, mem_info->src_buff, mem_info->alloc_len);
+	sg_dma_address(op) = mem_info->dest_buff_dma;
+	sg_dma_len(op++) = mem_info->alloc_len;
+
+	for (i = 0; mem_info->split_ip && i < mem_info->count; i++) {
+		if (BT_IP != mem_info->buffers[i].bt)
+			continue;
+		sg_set_buf(ip++, mem_info->buffers[i].v_mem,
+			   mem_info->buffers[i].len);
+		sg_dma_address(op) =
+		    mem_info->buffers[i].dev_buffer.h_map_p_addr;
+		sg_dma_len(op++) = mem_info->buffers[i].len;
+	}
+
+	/* Entry by entry, so that source and destination stay in step */
+	for (i = 0, ip = mem_info->ip_sg; i < mem_info->sg_cnt; i++, ip++) {
+		sg_dma_address(ip) = dma_map_single(dev, sg_virt(ip),
+						    ip->length, DMA_TO_DEVICE);
+		if (dma_mapping_error(dev, sg_dma_address(ip)))
+			goto unmap;
+		sg_dma_len(ip) = ip->length;
+	}
 
 	return 0;
-error:
 
+unmap:
+	while (i--) {
+		ip--;
+		dma_unmap_single(dev, sg_dma_address(ip), sg_dma_len(ip),
+				 DMA_TO_DEVICE);
+	}
+error:
+	kfree(mem_info->ip_sg);
+	kfree(mem_info->op_sg);
+	mem_info->ip_sg = mem_info->op_sg = NULL;
 	return -1;
+}
+
+static void dma_unmap_job(struct device *dev, crypto_mem_info_t *mem_info)
+{
+	struct scatterlist *ip = mem_info->ip_sg;
+	int32_t i;
+
+	for (i = 0; i < mem_info->sg_cnt; i++, ip++)
+		dma_unmap_single(dev, sg_dma_address(ip), sg_dma_len(ip),
+				 DMA_TO_DEVICE);
 
+	kfree(mem_info->ip_sg);
+	kfree(mem_info->op_sg);
+	mem_info->ip_sg = mem_info->op_sg = NULL;
 }
 
-static uint32_t prep_dma_tx_sg(crypto_mem_info_t *mem_info)
+static void dma_batch_done(void *param);
+
+/* Puts up to dma_batch_max waiting jobs on the engine as one transfer: the
+ * copies of all their operands, with a single completion on the last one.
+ * Called with the channel lock held. */
+static void dma_issue(chnl_info_t *dma_chnl)
 {
+	struct dma_chan *chan = dma_chnl->chnl;
+	struct dma_device *dma_dev = chan->device;
+	struct dma_async_tx_descriptor *dma_desc = NULL;
 	struct scatterlist *ip, *op;
-	int32_t i = 0;
+	crypto_op_ctx_t *ctx;
+	dma_cookie_t dma_cookie = 0;
+	enum dma_ctrl_flags dma_flags;
+	uint32_t batch_max = dma_batch_max ? : 1;
+	uint32_t jobs = 0;
+	bool last;
+	int32_t i;
+
+	while (jobs < batch_max && (ctx = dma_chnl->wait.head)) {
+		last = (jobs + 1 == batch_max) || !ctx->next;
+		ip = ctx->crypto_mem.ip_sg;
+		op = ctx->crypto_mem.op_sg;
+
+		for (i = 0; i < ctx->crypto_mem.sg_cnt; i++, ip++, op++) {
+			dma_flags = DMA_CTRL_ACK;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,12,0)
+			dma_flags |= DMA_COMPL_SKIP_DEST_UNMAP |
+			    DMA_COMPL_SKIP_SRC_UNMAP;
+#endif
+			if (last && i == ctx->crypto_mem.sg_cnt - 1)
+				dma_flags |= DMA_PREP_INTERRUPT;
+
+			dma_desc = dma_dev->device_prep_dma_memcpy(chan,
+					sg_dma_address(op), sg_dma_address(ip),
+					sg_dma_len(op), dma_flags);
+			if (unlikely(!dma_desc))
+				goto out;
+
+			if (dma_flags & DMA_PREP_INTERRUPT) {
+				dma_desc->callback = dma_batch_done;
+				dma_desc->callback_param = dma_chnl;
+			}
+
+			dma_cookie = dma_desc->tx_submit(dma_desc);
+			if (dma_submit_error(dma_cookie))
+				goto out;
+		}
 
-	mem_info->ip_sg = kzalloc(mem_info->sg_cnt * sizeof(struct scatterlist),
-				  GFP_KERNEL | GFP_DMA);
-
-    if( NULL == mem_info->ip_sg )
-    {
-        print_error("Mem alloc failed for input sg\n");
-        return -1;
-    }
-
-	mem_info->op_sg = kzalloc(mem_info->sg_cnt * sizeof(struct scatterlist),
-				  GFP_KERNEL | GFP_DMA);
-
-    if( NULL == mem_info->op_sg )
-    {
-        print_error("Mem alloc failed for output sg\n");
-        return -1;
-    }
-	
-    ip = mem_info->ip_sg;
-	op = mem_info->op_sg;
+		/* Copies complete in order on a channel: the job is done once
+		 * its last one is */
+		ctx->dma_cookie = dma_cookie;
+		dma_job_add(&dma_chnl->flight, dma_job_pop(&dma_chnl->wait));
+		jobs++;
+		if (last)
+			dma_chnl->irq_armed = true;
+	}
 
-	sg_init_table(ip, mem_info->sg_cnt);
-	sg_init_table(op, mem_info->sg_cnt);
+out:
+	if (jobs)
+		dma_async_issue_pending(chan);
 
-	sg_set_buf(ip++, mem_info->src_buff, mem_info->alloc_len);
-	sg_set_buf(op, mem_info->src_buff, mem_info->alloc_len);
-	sg_dma_address(op) = mem_info->buffers[0].dev_buffer.h_map_p_addr;
-	sg_dma_len(op) = mem_info->alloc_len;
-	op++;
-
-	for (i = 0; i < mem_info->count; i++) {
-		if (BT_IP == mem_info->buffers[i].bt) {
-			sg_set_buf(ip++, mem_info->buffers[i].v_mem,
-				   mem_info->buffers[i].len);
-			sg_set_buf(op, mem_info->buffers[i].v_mem,
-				   mem_info->buffers[i].len);
-			sg_dma_address(op) =
-			    mem_info->buffers[i].dev_buffer.h_map_p_addr;
-			sg_dma_len(op) = mem_info->buffers[i].len;
-			op++;
+	/* Out of engine descriptors: the job is copied again when the retry
+	 * puts it back on the engine */
+	if (ctx && !dma_chnl->irq_armed)
+		schedule_delayed_work(&dma_chnl->retry, 1);
+}
+
+/* Hands the copied jobs to their rings in order; those that find it full
+ * wait for the retry */
+static void dma_ring_drain(chnl_info_t *dma_chnl)
+{
+	crypto_op_ctx_t *ctx;
+
+	while ((ctx = dma_chnl->ring.head)) {
+		if (ctx->dma_done(ctx)) {
+			schedule_delayed_work(&dma_chnl->retry, 1);
+			break;
+		}
+		dma_job_pop(&dma_chnl->ring);
+	}
+}
+
+/* Moves the jobs whose copy completed from flight to their rings, then
+ * starts the next transfer. Never sleeps: called from the DMA completion. */
+static void dma_reap(chnl_info_t *dma_chnl)
+{
+	struct device *dev = dma_chnl->chnl->device->dev;
+	dma_job_list_t done = { NULL, NULL }, failed = { NULL, NULL };
+	enum dma_status status;
+	crypto_op_ctx_t *ctx;
+
+	spin_lock_bh(&dma_chnl->lock);
+	while ((ctx = dma_chnl->flight.head)) {
+		status = dma_async_is_tx_complete(dma_chnl->chnl,
+						  ctx->dma_cookie, NULL, NULL);
+		if (DMA_IN_PROGRESS == status || DMA_PAUSED == status)
+			break;
+
+		dma_job_pop(&dma_chnl->flight);
+		dma_chnl->pend_jobs--;
+		atomic64_sub(ctx->dma_len, &dma_chnl->pend_bytes);
+		dma_unmap_job(dev, &ctx->crypto_mem);
+		if (DMA_ERROR == status) {
+			dma_job_add(&failed, ctx);
+			continue;
 		}
+		dma_chnl->jobs++;
+		dma_chnl->bytes += ctx->dma_len;
+		dma_job_add(&done, ctx);
+	}
+
+	dma_job_splice(&dma_chnl->ring, &done);
+	dma_ring_drain(dma_chnl);
+
+	if (!dma_chnl->flight.head)
+		dma_chnl->irq_armed = false;
+	if (!dma_chnl->irq_armed)
+		dma_issue(dma_chnl);
+	spin_unlock_bh(&dma_chnl->lock);
+
+	while ((ctx = dma_job_pop(&failed))) {
+		print_error("DMA to dev failed for job of ring %d\n", ctx->rid);
+		atomic_dec(&ctx->c_dev->active_jobs);
+		sess_job_end(ctx);
+		ctx->op_done(ctx, -EIO);
 	}
+}
+
+static void dma_batch_done(void *param)
+{
+	chnl_info_t *dma_chnl = param;
+
+	spin_lock_bh(&dma_chnl->lock);
+	dma_chnl->irq_armed = false;
+	spin_unlock_bh(&dma_chnl->lock);
+
+	dma_reap(dma_chnl);
+}
 
-    return 0;
+static void dma_retry(struct work_struct *work)
+{
+	chnl_info_t *dma_chnl = container_of(to_delayed_work(work),
+					     chnl_info_t, retry);
+
+	dma_reap(dma_chnl);
+
+	/* Copies in flight without a completion to come are polled */
+	spin_lock_bh(&dma_chnl->lock);
+	if (dma_chnl->flight.head && !dma_chnl->irq_armed)
+		schedule_delayed_work(&dma_chnl->retry, 1);
+	spin_unlock_bh(&dma_chnl->lock);
 }
 
 /******************************************************************************
@@ -329,6 +518,15 @@ int init_rc_dma(void)
 		return -1;
 	}
 
+	{
+		int i = 0;
+		for (i = 0; i < dma_channel_count; i++) {
+			spin_lock_init(&hostdma.dma_channels[i].lock);
+			INIT_DELAYED_WORK(&hostdma.dma_channels[i].retry,
+					  dma_retry);
+		}
+	}
+
 	if (distribute_dma_channels()) {
 		print_error("Distribute channel failed...\n");
 		goto free_channels;
@@ -353,17 +551,22 @@ void cleanup_rc_dma(void)
 	 * go away after dma_request_channel( ) gets working
 	 * in X86.
 	 */
-#ifndef USE_IOAT_DMA_FIND_CHANNEL
 	int i = 0;
+
+	/* The devices are gone, so are the jobs: only the retries are left */
+	for (i = 0; i < dma_channel_count; i++)
+		cancel_delayed_work_sync(&hostdma.dma_channels[i].retry);
+#ifndef USE_IOAT_DMA_FIND_CHANNEL
 	for (i = 0; i < dma_channel_count; i++)
 		dma_release_channel(hostdma.dma_channels[i].chnl);
 #endif
 	kfree(hostdma.dma_channels);
+	hostdma.dma_channels = NULL;
 }
 
 /******************************************************************************
-Description :	Retrieve a dma channel from the pool of dma channels in round
-				robin fashion. 
+Description :	Retrieve the dma channel of the CPU with the least operand
+				bytes outstanding, preferring the local NUMA node.
 Fields      :   None.
 Returns     :	The dma channel.
 ******************************************************************************/
@@ -371,163 +574,186 @@ Returns     :	The dma channel.
 chnl_info_t *get_dma_chnl(void)
 {
 	int cpu = get_cpu();
-	chnl_info_t *cursor = per_cpu_dma[cpu].cursor;
-	per_cpu_dma[cpu].cursor = per_cpu_dma[cpu].cursor->next;
-	if (!cursor)
+	int node = cpu_to_node(cpu);
+	per_cpu_dma_chnls_t *pcd = &per_cpu_dma[cpu];
+	chnl_info_t *dma_chnl, *best = NULL;
+	bool local, best_local = false;
+	s64 load, best_load = 0;
+	int i, n;
+
+	/* The least outstanding bytes win, on the local node if asked for;
+	 * the search starts one channel further each time to share ties */
+	for (n = 0; n < dma_channel_count; n++) {
+		i = (pcd->cursor + n) % dma_channel_count;
+		if (!(pcd->mask & (1 << i)))
+			continue;
+
+		dma_chnl = &hostdma.dma_channels[i];
+		local = !dma_numa_local ||
+		    dma_chnl_node(dma_chnl) == NUMA_NO_NODE ||
+		    dma_chnl_node(dma_chnl) == node;
+		load = atomic64_read(&dma_chnl->pend_bytes);
+
+		if (!best || (local && !best_local) ||
+		    (local == best_local && load < best_load)) {
+			best = dma_chnl;
+			best_local = local;
+			best_load = load;
+		}
+	}
+	pcd->cursor = (pcd->cursor + 1) % dma_channel_count;
+	put_cpu();
+
+	if (!best)
 		print_error("NULL DMA channel for cpu...: %d\n", cpu);
-	return cursor;
+	return best;
 }
 
-/******************************************************************************
-Description :	To transfer the data from an SG one by one, in case the DMA
-				engine would not support SG. 
-Fields      :  	
-			dma_chnl	:	The dma channel to be used for transfer.
-			ip			:	source SG.
-			op			:	destination SG
-			sg_cnt		:	no of entries in the SG.
-			cb			:	callback function of the dma transfer.
-			param		:	callback function parameter. 
-Returns     :	SUCCESS/ FAILURE
-******************************************************************************/
-
-int32_t transfer_dma_sg(chnl_info_t *dma_chnl, struct scatterlist *ip,
-			struct scatterlist *op, int32_t sg_cnt,
-			void (*cb) (void *), void *param)
+static int dma_stats_get(char *buf, const struct kernel_param *kp)
 {
-	while (ip && op) {
-		if (prep_dma_tx(sg_dma_address(ip), sg_dma_address(op),
-				sg_dma_len(op), dma_chnl, cb, param))
-			return -1;
-		ip = scatterwalk_sg_next(ip);
-		op = scatterwalk_sg_next(op);
+	chnl_info_t *dma_chnl;
+	uint32_t pend_jobs, peak_jobs;
+	u64 jobs, bytes;
+	int i, len = 0;
+
+	for (i = 0; hostdma.dma_channels && i < dma_channel_count; i++) {
+		dma_chnl = &hostdma.dma_channels[i];
+
+		spin_lock_bh(&dma_chnl->lock);
+		pend_jobs = dma_chnl->pend_jobs;
+		peak_jobs = dma_chnl->peak_jobs;
+		jobs = dma_chnl->jobs;
+		bytes = dma_chnl->bytes;
+		spin_unlock_bh(&dma_chnl->lock);
+
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "chnl %d node %d queued %u queued_bytes %lld peak %u jobs %llu bytes %llu\n",
+				 i, dma_chnl_node(dma_chnl), pend_jobs,
+				 (long long)atomic64_read(&dma_chnl->pend_bytes),
+				 peak_jobs, jobs, bytes);
 	}
 
-	return 0;
+	return len;
 }
 
 /******************************************************************************
-Description :	Transfer data from host memory to device memory using DMA.   
-Fields      :   
+Description :	Transfer data from host memory to device memory using DMA.
+				The job joins the next transfer of the channel, which
+				starts right away when the engine is idle and otherwise
+				once the transfer in flight completes, so that the jobs
+				coming in meanwhile share one.
+Fields      :
 			dma_chnl	:	dma channel to be used for transfer.
 			mem			:	the structure which contains all the information
 							related to the source and the destination.
-			cb			:	callback function of the DMA transfer.
-			ctx			:	This contains information needed to enqueue the 
-							job latter(after DMA tx) to the SEC engine.						
+			cb			:	hands the job to its ring after the transfer;
+							non-zero when the ring is full, to be retried.
+							Called from the DMA completion, must not sleep.
+			ctx			:	This contains information needed to enqueue the
+							job latter(after DMA tx) to the SEC engine.
 Returns     :	SUCCESS/ FAILURE
 ******************************************************************************/
 
 int32_t dma_to_dev(chnl_info_t *dma_chnl, crypto_mem_info_t *mem,
-		   void (*cb) (void *), crypto_op_ctx_t *ctx)
+		   int (*cb) (void *), crypto_op_ctx_t *ctx)
 {
-	struct dma_device *dma_dev = dma_chnl->chnl->device;
-	struct dma_async_tx_descriptor *dma_desc = NULL;
-	dma_cookie_t dma_cookie = { 0 };
-	enum dma_ctrl_flags dma_flags = 0;
-
-	dma_addr_t s_dma_addr = 0;
-	int32_t ret = 0;
+	int32_t i;
 
 	if ((NULL == dma_chnl) || (NULL == mem)) {
 		print_error("NULL input parameters...\n");
 		return -1;
 	}
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,12,0)
-	dma_flags =
-	    DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
-#else
-	dma_flags =
-		DMA_CTRL_ACK | DMA_PREP_INTERRUPT | DMA_COMPL_SKIP_DEST_UNMAP;
-#endif
+	if (dma_map_job(dma_chnl->chnl->device->dev, mem)) {
+		print_error("DMA map for source failed...\n");
+		return -1;
+	}
 
-    if (mem->split_ip && (mem->sg_cnt > 1)) {
-        if( -1 == prep_dma_tx_sg(mem))
-        {
-            print_error("DMA tx sg failed...\n");
-            goto error;
-        }
-		ret = dma_map_sg(dma_dev->dev, mem->ip_sg, mem->sg_cnt,
-				 DMA_BIDIRECTIONAL);
-		if (unlikely(!ret)) {
-			print_error("DMA map for source sg failed...\n");
-			goto error;
-		}
+	ctx->dma_done = cb;
+	ctx->dma_len = 0;
+	for (i = 0; i < mem->sg_cnt; i++)
+		ctx->dma_len += sg_dma_len(&mem->op_sg[i]);
+
+	spin_lock_bh(&dma_chnl->lock);
+	atomic64_add(ctx->dma_len, &dma_chnl->pend_bytes);
+	if (++dma_chnl->pend_jobs > dma_chnl->peak_jobs)
+		dma_chnl->peak_jobs = dma_chnl->pend_jobs;
+	dma_job_add(&dma_chnl->wait, ctx);
+	if (!dma_chnl->irq_armed)
+		dma_issue(dma_chnl);
+	spin_unlock_bh(&dma_chnl->lock);
 
-		atomic_set(&ctx->reqcnt, 0);
-		/* For compatability with old DMA engines which does
-		 * not have SG transfer capability.
-		 */
-		if (dma_dev->device_prep_dma_sg) {
-			atomic_set(&ctx->maxreqs, 1);
-			dma_desc =
-			    dma_dev->device_prep_dma_sg(dma_chnl->chnl,
-							mem->op_sg, mem->sg_cnt,
-							mem->ip_sg, mem->sg_cnt,
-							dma_flags);
-		} else {
-			atomic_set(&ctx->maxreqs, mem->sg_cnt);
-			ret = transfer_dma_sg(dma_chnl, mem->ip_sg, mem->op_sg,
-					      mem->sg_cnt, cb, ctx);
-			if (ret)
-				goto error;
-			return 0;
+	return 0;
+}
+
+#ifndef VIRTIO_C2X0
+/* Moves the PKC jobs of dev from list to jobs, keeping the others in order.
+ * Jobs still waiting for their copy are unmapped and leave the queue
+ * depth. Called with the channel lock held. */
+static void dma_job_take(chnl_info_t *dma_chnl, dma_job_list_t *list,
+			 fsl_crypto_dev_t *dev, struct list_head *jobs,
+			 bool queued)
+{
+	struct device *dma_dev = dma_chnl->chnl->device->dev;
+	dma_job_list_t keep = { NULL, NULL };
+	crypto_op_ctx_t *ctx;
+
+	while ((ctx = dma_job_pop(list))) {
+		if (ctx->c_dev != dev || !ctx->ring_job) {
+			dma_job_add(&keep, ctx);
+			continue;
 		}
-	} else {
-
-		s_dma_addr =
-		    dma_map_single(dma_dev->dev, mem->src_buff, mem->alloc_len,
-				   DMA_BIDIRECTIONAL);
-		if (unlikely(!s_dma_addr)) {
-			print_error("DMA map for source buffer failed...\n");
-			goto error;
+		if (queued) {
+			dma_chnl->pend_jobs--;
+			atomic64_sub(ctx->dma_len, &dma_chnl->pend_bytes);
+			dma_unmap_job(dma_dev, &ctx->crypto_mem);
 		}
-
-		atomic_set(&ctx->maxreqs, 1);
-		atomic_set(&ctx->reqcnt, 0);
-		dma_desc =
-		    dma_dev->device_prep_dma_memcpy(dma_chnl->chnl,
-						    mem->dest_buff_dma,
-						    s_dma_addr, mem->alloc_len,
-						    dma_flags);
-	}
-	if (unlikely(!dma_desc)) {
-		print_error("DMA desc constr failed...\n");
-		goto error;
+		/* What the ring enqueue in dma_tx_complete_cb() would do */
+		atomic_dec(&dev->active_jobs);
+		list_add_tail(&ctx->ring_list, jobs);
 	}
+	*list = keep;
+}
 
-	dma_desc->callback = cb;
-	dma_desc->callback_param = ctx;
-
-	dma_cookie = dma_desc->tx_submit(dma_desc);
-	if (dma_submit_error(dma_cookie)) {
-		print_error("DMA submit error...\n");
-		goto error;
-	}
+/******************************************************************************
+Description :	Hands the PKC jobs of a device being reset that never made
+				it to their ring to failover_app_jobs(): the ones waiting
+				for a copy and the copied ones that found the ring
+				blocked. Copies in flight are let complete first, the
+				engine still owns their buffers. Sleeps.
+Fields      :
+			dev			:	device being reset, its app rings blocked.
+			jobs		:	where the jobs are moved, oldest first.
+Returns     :	None
+******************************************************************************/
 
-	/* Trigger the transaction */
-	dma_async_issue_pending(dma_chnl->chnl);
-#if 0
-	kfree(mem->ip_sg);
-	kfree(mem->op_sg);
-#endif
+void dma_failover(fsl_crypto_dev_t *dev, struct list_head *jobs)
+{
+	chnl_info_t *dma_chnl;
+	crypto_op_ctx_t *ctx;
+	int i;
+
+	for (i = 0; hostdma.dma_channels && i < dma_channel_count; i++) {
+		dma_chnl = &hostdma.dma_channels[i];
+
+		for (;;) {
+			spin_lock_bh(&dma_chnl->lock);
+			for (ctx = dma_chnl->flight.head; ctx; ctx = ctx->next)
+				if (ctx->c_dev == dev && ctx->ring_job)
+					break;
+			if (!ctx)
+				break;
+			spin_unlock_bh(&dma_chnl->lock);
+			schedule_timeout_uninterruptible(1);
+		}
 
-	return 0;
-error:
-	if (s_dma_addr)
-		dma_unmap_single(dma_dev->dev, s_dma_addr, mem->alloc_len,
-				 DMA_BIDIRECTIONAL);
-	if (mem->ip_sg) {
-		dma_unmap_sg(dma_dev->dev, mem->ip_sg, mem->sg_cnt,
-			     DMA_BIDIRECTIONAL);
-		kfree(mem->ip_sg);
-		kfree(mem->op_sg);
+		/* Copied jobs are older than the waiting ones */
+		dma_job_take(dma_chnl, &dma_chnl->ring, dev, jobs, false);
+		dma_job_take(dma_chnl, &dma_chnl->wait, dev, jobs, true);
+		spin_unlock_bh(&dma_chnl->lock);
 	}
-
-	/* Need to cleanup the desc */
-	return -1;
 }
+#endif
 
 #else
 
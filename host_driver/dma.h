@@ -36,10 +36,35 @@
 #ifndef FSL_PKC_DMA_H
 #define FSL_PKC_DMA_H
 
+/* Jobs linked through crypto_op_ctx.next, in submission order */
+typedef struct dma_job_list {
+	crypto_op_ctx_t *head;
+	crypto_op_ctx_t *tail;
+} dma_job_list_t;
+
 typedef struct chnl_info {
 	uint32_t desc_count;
 	struct dma_chan *chnl;
-	struct chnl_info *next;
+
+	spinlock_t lock;
+	/* Jobs whose operands wait for the engine, are being copied, and
+	 * are copied but found their ring full */
+	dma_job_list_t wait;
+	dma_job_list_t flight;
+	dma_job_list_t ring;
+	/* The last transfer issued raises the batch completion */
+	bool irq_armed;
+	/* Polls flight and retries ring when no completion will come */
+	struct delayed_work retry;
+
+	/* Operand bytes of wait and flight, what get_dma_chnl() balances */
+	atomic64_t pend_bytes;
+	/* Queue depth statistics, under lock */
+	uint32_t pend_jobs;
+	uint32_t peak_jobs;
+	/* Jobs and bytes whose copy completed without error, under lock */
+	u64 jobs;
+	u64 bytes;
 } chnl_info_t;
 
 typedef struct host_dma {
@@ -48,15 +73,19 @@ typedef struct host_dma {
 } host_dma_t;
 
 typedef struct per_cpu_dma_chnls {
-	chnl_info_t *head;
-	chnl_info_t *tail;
-	chnl_info_t *cursor;
+	/* Channels of dma_channel_cpu_mask the CPU may use */
+	uint32_t mask;
+	/* Where the next search starts, for equally loaded channels */
+	uint32_t cursor;
 } per_cpu_dma_chnls_t;
 
 int init_rc_dma(void);
 void cleanup_rc_dma(void);
 chnl_info_t *get_dma_chnl(void);
 int32_t dma_to_dev(chnl_info_t *dma_chnl, crypto_mem_info_t *mem,
-		   void (*cb) (void *), crypto_op_ctx_t *param);
+		   int (*cb) (void *), crypto_op_ctx_t *param);
+#ifndef VIRTIO_C2X0
+void dma_failover(fsl_crypto_dev_t *dev, struct list_head *jobs);
+#endif
 
 #endif
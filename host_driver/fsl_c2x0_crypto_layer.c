@@ -42,9 +42,19 @@
 #include "algs.h"
 #include "error.h"
 #include "crypto_ctx.h"
+#include "ecc_curves.h"
+#ifdef ECDSA_PRESIG
+#include "ecdsa_presig.h"
+#endif
 #ifdef VIRTIO_C2X0
 #include "hash.h"		/* hash */
 #include "fsl_c2x0_virtio.h"
+#else
+#include "pkc_kapi.h"
+#include "ring_balance.h"
+#ifdef USE_HOST_DMA
+#include "dma.h"
+#endif
 #endif
 
 extern int32_t wt_cpu_mask;
@@ -96,19 +106,31 @@ void distribute_rings(fsl_crypto_dev_t *dev, struct crypto_dev_config *config)
 	struct list_head *isr_ctx_list_head;
 	uint32_t total_cores = num_online_cpus();
 	uint16_t total_isrs = dev->priv_dev->intr_info.intr_vectors_cnt;
+	int node = dev_to_node(&dev->priv_dev->dev->dev);
+	int32_t cpu_mask = 0;
 	struct bh_handler *instance;
 	isr_ctx_t *isr_ctx;
 
 	isr_ctx_list_head = &(dev->priv_dev->intr_info.isr_ctx_list_head);
 
 	print_debug("Total cores: %d\n", total_cores);
+
+	/* Keep the response workers on the device's node if any of the
+	 * worker cores is there */
+	for_each_online_cpu(i) {
+		if (i < 32 && (wt_cpu_mask & (1 << i)) &&
+		    cpu_to_node(i) == node)
+			cpu_mask |= 1 << i;
+	}
+	if (!cpu_mask)
+		cpu_mask = wt_cpu_mask;
 	isr_ctx = list_entry(isr_ctx_list_head->next, isr_ctx_t, list);
 
 	INIT_LIST_HEAD(&(isr_ctx->ring_list_head));
 
 	/* Affine the ring to CPU & ISR */
 	for (i = 0; i < config->num_of_rings; i++) {
-		while (!(wt_cpu_mask & (1 << core_no)))
+		while (!(cpu_mask & (1 << core_no)))
 			core_no = (core_no + 1) % total_cores;
 
 		print_debug("Ring no: %d Core no: %d\n", i, core_no);
@@ -258,6 +280,10 @@ static uint32_t calc_ob_mem_len(fsl_crypto_dev_t *dev,
 	dev->ob_mem.s_c_cntrs_mem = ob_mem_len;
 	ob_mem_len += sizeof(struct counters_mem);
 
+	ob_mem_len = cache_line_align(ob_mem_len);
+	dev->ob_mem.fw_stats = ob_mem_len;
+	ob_mem_len += sizeof(struct fw_stats_mem);
+
 	/* We have to make sure that we align the output buffer pool to DMA */
 	ob_mem_len = cache_line_align(ob_mem_len);
 	dev->ob_mem.op_pool = ob_mem_len;
@@ -331,6 +357,7 @@ int32_t alloc_ob_mem(fsl_crypto_dev_t *dev, struct crypto_dev_config *config)
 	dev->host_mem->s_c_r_cntrs_mem = host_v_addr + dev->ob_mem.s_c_r_cntrs_mem;
 	dev->host_mem->cntrs_mem = host_v_addr + dev->ob_mem.cntrs_mem;
 	dev->host_mem->s_c_cntrs_mem = host_v_addr + dev->ob_mem.s_c_cntrs_mem;
+	dev->host_mem->fw_stats = host_v_addr + dev->ob_mem.fw_stats;
 	dev->host_mem->op_pool = host_v_addr + dev->ob_mem.op_pool;
 	dev->host_mem->ip_pool = host_v_addr + dev->ob_mem.ip_pool;
 
@@ -345,6 +372,7 @@ int32_t alloc_ob_mem(fsl_crypto_dev_t *dev, struct crypto_dev_config *config)
 	print_debug("S C R cntrs mem	: %p\n", dev->host_mem->s_c_r_cntrs_mem);
 	print_debug("Cntrs mem		: %p\n", dev->host_mem->cntrs_mem);
 	print_debug("S C cntrs mem	: %p\n", dev->host_mem->s_c_cntrs_mem);
+	print_debug("FW stats		: %p\n", dev->host_mem->fw_stats);
 	print_debug("OP pool		: %p\n", dev->host_mem->op_pool);
 	print_debug("IP pool		: %p\n", dev->host_mem->ip_pool);
 	print_debug("Total req mem size : %d\n", dev->tot_req_mem_size);
@@ -363,6 +391,7 @@ void init_handshake(fsl_crypto_dev_t *dev)
 	uint32_t h_val = (ob_mem & PHYS_ADDR_H_32_BIT_MASK) >> 32;
 
 	dev->host_mem->hs_mem.state = DEFAULT;
+	dev->host_mem->hs_mem.data.device.caps = 0;
 
 	print_debug("C HS mem addr: %p\n", &(dev->c_hs_mem->h_ob_mem_l));
 	print_debug("Host ob mem addr	L: %0x	H: %0x\n", l_val, h_val);
@@ -420,6 +449,7 @@ void init_ring_pairs(fsl_crypto_dev_t *dev)
 
 		rp->dev = dev;
 		rp->depth = rp->info.depth;
+		rp->max_depth = rp->depth;
 		rp->num_of_sec_engines = 1;
 
 		rp->ip_pool = dev->ip_pool.drv_map_pool.pool;
@@ -439,6 +469,8 @@ void init_ring_pairs(fsl_crypto_dev_t *dev)
 /* FIXME: It's not clear what is the use of sec_eng_sel, num_of_sec_engines and crypto_dev_sess:sec_eng */
 		atomic_set(&(rp->sec_eng_sel), 0);
 		spin_lock_init(&(rp->ring_lock));
+		spin_lock_init(&(rp->job_lock));
+		INIT_LIST_HEAD(&(rp->jobs));
 	}
 
 }
@@ -450,6 +482,7 @@ void send_hs_init_config(fsl_crypto_dev_t *dev)
 	phys_addr_t fw_resp_ring   = dev->ob_mem.fw_resp_ring + host_p_addr;
 	phys_addr_t s_cntrs        = dev->ob_mem.s_c_cntrs_mem + host_p_addr;
 	phys_addr_t r_s_cntrs      = dev->ob_mem.s_c_r_cntrs_mem + host_p_addr;
+	phys_addr_t fw_stats       = 0;
 	volatile struct c_config_data *config = &dev->c_hs_mem->data.config;
 
 	iowrite8(HS_INIT_CONFIG, (void *) &dev->c_hs_mem->command);
@@ -465,6 +498,13 @@ void send_hs_init_config(fsl_crypto_dev_t *dev)
 	iowrite32be(s_cntrs, (void *) &config->s_cntrs);
 	iowrite32be(r_s_cntrs, (void *) &config->r_s_cntrs);
 	iowrite32be(DEFAULT_FIRMWARE_RESP_RING_DEPTH, (void *) &config->fw_resp_ring_depth);
+	/* Only firmware reporting FW_CAP_STATS knows the word: it publishes
+	 * the block once given its address */
+	memset(dev->host_mem->fw_stats, 0, sizeof(struct fw_stats_mem));
+	if (dev->fw_caps & FW_CAP_STATS) {
+		fw_stats = dev->ob_mem.fw_stats + host_p_addr;
+		iowrite32be(fw_stats, (void *) &config->fw_stats);
+	}
 
 	print_debug("HS_INIT_CONFIG Details\n");
 	print_debug("Num of rps: %d\n", dev->num_of_rings);
@@ -473,6 +513,7 @@ void send_hs_init_config(fsl_crypto_dev_t *dev)
 	print_debug("Fw resp ring: %pa\n", &fw_resp_ring);
 	print_debug("S C Counters: %pa\n", &s_cntrs);
 	print_debug("R S C counters: %pa\n", &r_s_cntrs);
+	print_debug("FW stats: %pa\n", &fw_stats);
 	print_debug("Sending FW_INIT_CONFIG command at addr: %p\n",
 			&(dev->c_hs_mem->state));
 
@@ -578,6 +619,7 @@ void hs_firmware_up(fsl_crypto_dev_t *dev, struct crypto_dev_config *config)
 	p_ib_h = be32_to_cpu(hsdev->p_ib_mem_base_h);
 	p_ob_l = be32_to_cpu(hsdev->p_ob_mem_base_l);
 	p_ob_h = be32_to_cpu(hsdev->p_ob_mem_base_h);
+	dev->fw_caps = be32_to_cpu(hsdev->caps);
 
 	dev->priv_dev->bars[MEM_TYPE_SRAM].dev_p_addr = (dev_p_addr_t) p_ib_h << 32;
 	dev->priv_dev->bars[MEM_TYPE_SRAM].dev_p_addr |= p_ib_l;
@@ -588,6 +630,7 @@ void hs_firmware_up(fsl_crypto_dev_t *dev, struct crypto_dev_config *config)
 	print_debug("Device Shared Details\n");
 	print_debug("Ib mem PhyAddr L: %0x, H: %0x\n", p_ib_l, p_ib_h);
 	print_debug("Ob mem PhyAddr L: %0x, H: %0x\n", p_ob_l, p_ob_h);
+	print_debug("Firmware capabilities: %x\n", dev->fw_caps);
 	print_debug("Formed dev ib mem phys address: %llx\n",
 			(uint64_t)dev->priv_dev->bars[MEM_TYPE_SRAM].dev_p_addr);
 	print_debug("Formed dev ob mem phys address: %llx\n",
@@ -703,6 +746,7 @@ int32_t handshake(fsl_crypto_dev_t *dev, struct crypto_dev_config *config)
 				print_error("No of SECs are %d\n", no_secs);
 				goto error;
 			}
+			dev->dev_info.num_sec_engines = no_secs;
 			rid = hs_init_rp_complete(dev, config, rid);
 			break;
 		case FW_INIT_RNG:
@@ -957,7 +1001,8 @@ int init_crypto_ctx_pool(fsl_crypto_dev_t *dev)
 	int i, id;
 	ctx_pool_t *pool;
 
-	pool = kzalloc(sizeof(ctx_pool_t) * NR_CTX_POOLS, GFP_KERNEL);
+	pool = kzalloc_node(sizeof(ctx_pool_t) * NR_CTX_POOLS, GFP_KERNEL,
+			    dev_to_node(&dev->priv_dev->dev->dev));
 	if (!pool)
 		return -ENOMEM;
 
@@ -977,16 +1022,11 @@ int init_crypto_ctx_pool(fsl_crypto_dev_t *dev)
 	return 0;
 }
 
-static int32_t ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
-			    dev_dma_addr_t sec_desc)
+/* Writes one descriptor at the write index. Called with the ring lock held,
+ * the caller has checked for room and publishes the shadow counter */
+static void ring_put(fsl_crypto_dev_t *c_dev, fsl_h_rsrc_ring_pair_t *rp,
+		     uint32_t jr_id, dev_dma_addr_t sec_desc)
 {
-	uint32_t wi = 0;
-	uint32_t jobs_processed = 0;
-#ifndef HIGH_PERF
-	uint32_t app_req_cnt = 0;
-#endif
-	fsl_h_rsrc_ring_pair_t *rp = NULL;
-
 #ifndef HIGH_PERF
 #ifdef MULTIPLE_RESP_RINGS
 	dev_dma_addr_t ctx_desc = 0;
@@ -998,20 +1038,6 @@ static int32_t ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 #endif
 
 	print_debug("Sec desc addr: %llx\n", sec_desc);
-	print_debug("Enqueue job in ring: %d\n", jr_id);
-
-	rp = &(c_dev->ring_pairs[jr_id]);
-
-	/* Acquire the lock on current ring */
-	spin_lock_bh(&rp->ring_lock);
-
-	jobs_processed = be32_to_cpu(rp->s_c_counters->jobs_processed);
-
-	if (rp->counters->jobs_added - jobs_processed >= rp->depth) {
-		print_error("Ring: %d is full\n", jr_id);
-		spin_unlock_bh(&(rp->ring_lock));
-		return -1;
-	}
 #ifndef HIGH_PERF
 #ifdef MULTIPLE_RESP_RINGS
 	if (jr_id != 0) {
@@ -1036,22 +1062,71 @@ static int32_t ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 	}
 #endif
 #endif
-	wi = rp->indexes->w_index;
-
-	print_debug("Enqueuing at the index: %d\n", wi);
+	print_debug("Enqueuing at the index: %d\n", rp->indexes->w_index);
 	print_debug("Enqueuing to the req r addr: %p\n", rp->req_r);
-	print_debug("Writing at the addr	: %p\n", &(rp->req_r[wi].sec_desc));
 
-	IOWRITE64BE(sec_desc, &rp->req_r[wi].sec_desc);
+	rc_req_put(rp->req_r, rp->depth, rp->indexes, rp->counters, sec_desc);
 
-	rp->indexes->w_index = (wi + 1) % rp->depth;
 	print_debug("Update W index: %d\n", rp->indexes->w_index);
-
-	rp->counters->jobs_added += 1;
 	print_debug("Updated jobs added: %d\n", rp->counters->jobs_added);
+}
+
+/* Enqueues up to nr descriptors under one hold of the ring lock and hands
+ * them to the firmware with a single shadow counter update. Returns how many
+ * were enqueued, less than nr when the ring fills up. The PKC jobs of ctxs,
+ * when given, join the outstanding jobs of the ring under the same hold, so
+ * that a failover never sees a job whose enqueue may still fail. */
+static uint32_t ring_enqueue_batch(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
+				   dev_dma_addr_t *sec_desc,
+				   crypto_op_ctx_t **ctxs, uint32_t nr)
+{
+	uint32_t room, i;
+#ifndef HIGH_PERF
+	uint32_t app_req_cnt = 0;
+#endif
+	fsl_h_rsrc_ring_pair_t *rp = NULL;
+
+	print_debug("Enqueue %d jobs in ring: %d\n", nr, jr_id);
+
+	rp = &(c_dev->ring_pairs[jr_id]);
+
+	/* Acquire the lock on current ring */
+	spin_lock_bh(&rp->ring_lock);
+
+	/* Blocked app rings are being reset or reconfigured. Checked under
+	 * the lock so that nothing gets in once the blocker took it */
+	if (jr_id && atomic_read(&rp->block)) {
+		print_debug("Block condition is set for the ring: %d\n", jr_id);
+		spin_unlock_bh(&rp->ring_lock);
+		return 0;
+	}
+
+	room = rp->depth - rc_req_inflight(rp->counters, rp->s_c_counters);
+	if (nr > room)
+		nr = room;
+
+	if (!nr) {
+		print_error("Ring: %d is full\n", jr_id);
+		spin_unlock_bh(&(rp->ring_lock));
+		return 0;
+	}
+
+	for (i = 0; i < nr; i++)
+		ring_put(c_dev, rp, jr_id, sec_desc[i]);
+
+#ifndef VIRTIO_C2X0
+	if (ctxs) {
+		spin_lock(&rp->job_lock);
+		for (i = 0; i < nr; i++)
+			if (ctxs[i]->ring_job)
+				list_add_tail(&ctxs[i]->ring_list, &rp->jobs);
+		spin_unlock(&rp->job_lock);
+	}
+#endif
+
 #ifndef HIGH_PERF
 	if (jr_id) {
-		app_req_cnt =  atomic_inc_return(&c_dev->app_req_cnt);
+		app_req_cnt =  atomic_add_return(nr, &c_dev->app_req_cnt);
 		set_sysfs_value(c_dev->priv_dev, STATS_REQ_COUNT_SYS_FILE,
 				(uint8_t *) &(app_req_cnt),
 				sizeof(app_req_cnt));
@@ -1059,7 +1134,7 @@ static int32_t ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 #endif
 	print_debug("Ring: %d	Shadow counter address	%p\n", jr_id,
 		    &(rp->shadow_counters->jobs_added));
-	rp->shadow_counters->jobs_added = be32_to_cpu(rp->counters->jobs_added);
+	rc_req_publish(rp->counters, rp->shadow_counters);
 
 /*
  * No more need to update total counters ...
@@ -1072,10 +1147,15 @@ static int32_t ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 */
 
 	spin_unlock_bh(&(rp->ring_lock));
-	return 0;
+	return nr;
+}
+
+static int32_t ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
+			    dev_dma_addr_t sec_desc)
+{
+	return ring_enqueue_batch(c_dev, jr_id, &sec_desc, NULL, 1) ? 0 : -1;
 }
 
-#define CRYPTO_INFO_STR_LENGTH 200
 int prepare_crypto_cfg_info_string(struct crypto_dev_config *config,
 		uint8_t *cryp_cfg_str)
 {
@@ -1119,6 +1199,61 @@ int32_t set_device_status_per_cpu(fsl_crypto_dev_t *c_dev, uint8_t set)
 	return 0;
 }
 
+/*******************************************************************************
+ * Function     : read_fw_stats
+ *
+ * Arguments    : dev - crypto device	stats - host order copy
+ *
+ * Return Value : 0, -EOPNOTSUPP without FW_CAP_STATS, -ENODEV until the
+ *		  firmware publishes the block or -EBUSY
+ *
+ * Description  : Takes a consistent copy of the statistics block without
+ *		  going to the device
+ *
+ ******************************************************************************/
+int32_t read_fw_stats(fsl_crypto_dev_t *dev, struct fw_stats_mem *stats)
+{
+	BUILD_BUG_ON(FW_STATS_MAX_RINGS != FSL_CRYPTO_MAX_RING_PAIRS);
+
+	if (!(dev->fw_caps & FW_CAP_STATS))
+		return -EOPNOTSUPP;
+
+	return rc_stats_read(dev->host_mem->fw_stats, stats);
+}
+
+/* Contents of the stat/fw_stats sysfs file */
+ssize_t show_fw_stats(struct c29x_dev *fsl_pci_dev, char *buf)
+{
+	fsl_crypto_dev_t *dev = fsl_pci_dev->crypto_dev;
+	struct fw_stats_mem stats;
+	ssize_t len;
+	uint32_t i;
+	int32_t ret;
+
+	if (!dev || !dev->host_mem)
+		return scnprintf(buf, PAGE_SIZE, "not available\n");
+
+	ret = read_fw_stats(dev, &stats);
+	if (-EOPNOTSUPP == ret)
+		return scnprintf(buf, PAGE_SIZE, "not supported by firmware\n");
+	if (ret)
+		return scnprintf(buf, PAGE_SIZE, "not available\n");
+
+	len = scnprintf(buf, PAGE_SIZE, "seq %u interval %u ms\n",
+			stats.seq, stats.interval);
+	for (i = 0; i < stats.no_secs; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "sec%u jobs %u errors %u busy_cycles %llu\n",
+				 i, stats.sec[i].jobs, stats.sec[i].errors,
+				 (unsigned long long)stats.sec[i].busy_cycles);
+	for (i = 0; i < stats.no_rings; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "ring%u jobs %u errors %u\n", i,
+				 stats.ring[i].jobs_processed,
+				 stats.ring[i].errors);
+	return len;
+}
+
 void stop_device(fsl_crypto_dev_t *dev)
 {
 	void *ccsr = dev->priv_dev->bars[MEM_TYPE_CONFIG].host_v_addr;
@@ -1157,16 +1292,17 @@ fsl_crypto_dev_t *fsl_crypto_layer_add_device(struct c29x_dev *fsl_pci_dev,
 				  struct crypto_dev_config *config)
 {
 	uint8_t crypto_info_str[CRYPTO_INFO_STR_LENGTH];
+	int node = dev_to_node(&fsl_pci_dev->dev->dev);
 	fsl_crypto_dev_t *c_dev;
 	int err;
 
 	/* some fields are assumed to be null when they are first used */
-	c_dev = kzalloc(sizeof(fsl_crypto_dev_t), GFP_KERNEL);
+	c_dev = kzalloc_node(sizeof(fsl_crypto_dev_t), GFP_KERNEL, node);
 	if (!c_dev)
 		return NULL;
 
-	c_dev->ring_pairs = kzalloc(sizeof(fsl_h_rsrc_ring_pair_t) *
-				    config->num_of_rings, GFP_KERNEL);
+	c_dev->ring_pairs = kzalloc_node(sizeof(fsl_h_rsrc_ring_pair_t) *
+					 config->num_of_rings, GFP_KERNEL, node);
 	if (!c_dev->ring_pairs)
 		goto rp_fail;
 
@@ -1177,6 +1313,8 @@ fsl_crypto_dev_t *fsl_crypto_layer_add_device(struct c29x_dev *fsl_pci_dev,
 	fsl_pci_dev->crypto_dev = c_dev;
 
 	atomic_set(&(c_dev->crypto_dev_sess_cnt), 0);
+	spin_lock_init(&c_dev->cmd_lock);
+	INIT_LIST_HEAD(&c_dev->cmd_list);
 
 	c_dev->c_hs_mem = c_dev->priv_dev->bars[MEM_TYPE_SRAM].host_v_addr + HS_MEM_OFFSET;
 
@@ -1261,6 +1399,14 @@ fsl_crypto_dev_t *fsl_crypto_layer_add_device(struct c29x_dev *fsl_pci_dev,
 		goto error;
 	}
 
+	/* Requests on unknown curves still carry their own parameters */
+	if (load_ecc_curves(c_dev))
+		print_error("Named curves not loaded, using request params\n");
+#ifdef ECDSA_PRESIG
+	if (init_ecdsa_presig(c_dev))
+		print_error("ECDSA presignature pools not allocated\n");
+#endif
+
 	err = prepare_crypto_cfg_info_string(config, crypto_info_str);
 	if (err) {
 		print_error("Preparing crypto config info string failed\n");
@@ -1275,6 +1421,10 @@ fsl_crypto_dev_t *fsl_crypto_layer_add_device(struct c29x_dev *fsl_pci_dev,
 	return c_dev;
 
 error:
+#ifdef ECDSA_PRESIG
+	cleanup_ecdsa_presig(c_dev);
+#endif
+	cleanup_ecc_curves(c_dev);
 	kfree(c_dev->ctx_pool);
 ctx_pool_fail:
 	kfree(c_dev->op_pool.pool);
@@ -1320,6 +1470,11 @@ void cleanup_crypto_device(fsl_crypto_dev_t *dev)
 	}
 #endif
 
+#ifdef ECDSA_PRESIG
+	cleanup_ecdsa_presig(dev);
+#endif
+	cleanup_ecc_curves(dev);
+	cleanup_cmd_ctxs(dev);
 	kfree(dev->ctx_pool);
 	kfree(dev->ip_pool.drv_map_pool.pool);
 	kfree(dev->op_pool.pool);
@@ -1341,16 +1496,31 @@ int32_t app_ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 			 dev_dma_addr_t sec_desc)
 {
 	int32_t ret = 0;
+
+	ret = ring_enqueue(c_dev, jr_id, sec_desc);
+
+	return ret;
+}
+
+/* Enqueues the job of ctx and tracks it on its ring until its response */
+int32_t app_ring_enqueue_job(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
+			     dev_dma_addr_t sec_desc, crypto_op_ctx_t *ctx)
+{
+	return ring_enqueue_batch(c_dev, jr_id, &sec_desc, &ctx, 1) ? 0 : -1;
+}
+
+uint32_t app_ring_enqueue_batch(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
+				dev_dma_addr_t *sec_desc,
+				crypto_op_ctx_t **ctxs, uint32_t nr)
+{
 #ifndef HIGH_PERF
 	/* Check the block flag for the ring */
 	if (0 != atomic_read(&(c_dev->ring_pairs[jr_id].block))) {
 		print_debug("Block condition is set for the ring: %d\n", jr_id);
-		return -1;
+		return 0;
 	}
 #endif
-	ret = ring_enqueue(c_dev, jr_id, sec_desc);
-
-	return ret;
+	return ring_enqueue_batch(c_dev, jr_id, sec_desc, ctxs, nr);
 }
 
 int32_t cmd_ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
@@ -1360,6 +1530,20 @@ int32_t cmd_ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 	return ring_enqueue(c_dev, jr_id, sec_desc);
 }
 
+/* Host address of the descriptor the device sees at desc */
+static dma_addr_t *desc_to_host(fsl_crypto_dev_t *dev, uint64_t desc)
+{
+#ifdef SEC_DMA
+	dev_p_addr_t offset = dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr;
+
+	if (desc >= offset)
+		return dev->ip_pool.drv_map_pool.v_addr +
+			(desc - offset - dev->ip_pool.drv_map_pool.p_addr);
+#endif
+	return dev->ip_pool.drv_map_pool.v_addr +
+		(desc - dev->ip_pool.fw_pool.dev_p_addr);
+}
+
 void handle_response(fsl_crypto_dev_t *dev, uint64_t desc, int32_t res)
 {
 	dma_addr_t *h_desc;
@@ -1373,15 +1557,7 @@ void handle_response(fsl_crypto_dev_t *dev, uint64_t desc, int32_t res)
         dev_p_addr_t offset = dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr;
 #endif
 
-#ifdef SEC_DMA
-        if (desc < offset) {
-#endif
-            h_desc = dev->ip_pool.drv_map_pool.v_addr + (desc - dev->ip_pool.fw_pool.dev_p_addr);
-#ifdef SEC_DMA
-        } else {
-            h_desc = dev->ip_pool.drv_map_pool.v_addr + (desc - offset - dev->ip_pool.drv_map_pool.p_addr);
-        }
-#endif
+	h_desc = desc_to_host(dev, desc);
 
 #ifndef HIGH_PERF
 	if (get_flag(dev->ip_pool.drv_map_pool.pool, h_desc))
@@ -1404,6 +1580,8 @@ void handle_response(fsl_crypto_dev_t *dev, uint64_t desc, int32_t res)
                     unmap_crypto_mem(&ctx0->crypto_mem);
                 }
 #endif
+		/* The session may go away once the request completes */
+		sess_job_end(ctx0);
 		ctx0->op_done(ctx0, res);
         } else {
 		print_debug("NULL Context!!\n");
@@ -1418,6 +1596,112 @@ void handle_response(fsl_crypto_dev_t *dev, uint64_t desc, int32_t res)
 
 }
 
+#ifndef VIRTIO_C2X0
+/* Ends the tracking started by a successful app_ring_enqueue_job() */
+void ring_job_del(crypto_op_ctx_t *ctx)
+{
+	fsl_h_rsrc_ring_pair_t *rp;
+
+	if (!ctx->ring_list.next)
+		return;
+
+	rp = &ctx->c_dev->ring_pairs[ctx->rid];
+	spin_lock_bh(&rp->job_lock);
+	list_del(&ctx->ring_list);
+	ctx->ring_list.next = NULL;
+	spin_unlock_bh(&rp->job_lock);
+}
+
+/*******************************************************************************
+ * Function     : failover_app_jobs
+ *
+ * Arguments    : dev - device being reset
+ *
+ * Return Value : None
+ *
+ * Description  : Called with the app rings blocked, the device marked dead
+ *		  and every response of the firmware handled, so the PKC jobs
+ *		  still outstanding on an app ring will never be answered,
+ *		  whether the firmware fetched them or not, and so will the
+ *		  ones host DMA still holds for the blocked rings. Jobs of a
+ *		  tfm are released and their request submitted again, which
+ *		  rebinds the session to an alive device; an ordered session
+ *		  keeps the request's place in its completion order.
+ *		  Sessionless jobs are completed as discarded.
+ *
+ ******************************************************************************/
+void failover_app_jobs(fsl_crypto_dev_t *dev)
+{
+	fsl_h_rsrc_ring_pair_t *rp;
+	crypto_op_ctx_t *ctx, *tmp;
+	crypto_dev_sess_t *c_sess;
+	struct pkc_request *req;
+	uint32_t rid;
+	uint32_t moved = 0, failed = 0;
+	bool ordered;
+	int ret;
+	LIST_HEAD(jobs);
+#ifdef SEC_DMA
+	dev_p_addr_t offset = dev->priv_dev->bars[MEM_TYPE_DRIVER].dev_p_addr;
+#endif
+
+	for (rid = 1; rid < dev->num_of_rings; rid++) {
+		rp = &dev->ring_pairs[rid];
+		spin_lock_bh(&rp->job_lock);
+		list_splice_init(&rp->jobs, &jobs);
+		spin_unlock_bh(&rp->job_lock);
+	}
+#ifdef USE_HOST_DMA
+	dma_failover(dev, &jobs);
+#endif
+
+	list_for_each_entry_safe(ctx, tmp, &jobs, ring_list) {
+		list_del(&ctx->ring_list);
+		ctx->ring_list.next = NULL;
+#ifdef SEC_DMA
+		if (ctx->desc >= offset)
+			unmap_crypto_mem(&ctx->crypto_mem);
+#endif
+
+		req = ctx->req.pkc;
+		if (!req->base.tfm) {
+			/* JOB_DISCARDED, as firmware reports it */
+			sess_job_end(ctx);
+			ctx->op_done(ctx, -1);
+			failed++;
+			continue;
+		}
+
+		c_sess = ctx->sess;
+		ordered = c_sess && c_sess->order;
+		if (ordered)
+			sess_order_requeue(c_sess->order, req);
+
+		/* Released without giving up the order slot */
+		sess_job_end(ctx);
+		dealloc_crypto_mem(&ctx->crypto_mem);
+		free_crypto_ctx(ctx->ctx_pool, ctx);
+
+		ret = pkc_kapi_req(req) ? pkc_kapi_op(req) :
+					  crypto_pkc_op(req);
+		if (-EINPROGRESS == ret) {
+			moved++;
+			continue;
+		}
+		/* Answered without a job (cached result) or refused */
+		if (ordered)
+			crypto_dev_sess_complete(req, ret);
+		else
+			pkc_request_complete(req, ret);
+		if (ret)
+			failed++;
+	}
+
+	print_error("Device %d: %u jobs resubmitted, %u failed\n",
+		    dev->config->dev_no, moved, failed);
+}
+#endif
+
 #ifndef MULTIPLE_RESP_RINGS
 void demux_fw_responses(fsl_crypto_dev_t *dev)
 {
@@ -1485,31 +1769,8 @@ void demux_fw_responses(fsl_crypto_dev_t *dev)
 	*(dev->fw_resp_ring.intr_ctrl_flag) = 0;
 
 CMD_RING_RESP:
-/* Command ring response processing */
-/*	printk(KERN_ERR "*** Jobs added.. :%d Jobs processed... :%d\n",
-		dev->ring_pairs[0].s_c_counters->jobs_added ,
-		dev->ring_pairs[0].counters->jobs_processed);*/
-
-	if (dev->ring_pairs[0].s_c_counters->jobs_added -
-	    dev->ring_pairs[0].counters->jobs_processed) {
-		ri = dev->ring_pairs[0].indexes->r_index;
-
-		desc = be64_to_cpu(dev->ring_pairs[0].resp_r[ri].sec_desc);
-
-		print_debug("DEQUEUE RESP AT: %u RESP DESC: %llx  == [%p]",
-		     ri, desc, &(dev->ring_pairs[0].resp_r[ri]));
-
-		if (desc) {
-			res = be32_to_cpu(dev->ring_pairs[0].resp_r[ri].result);
-			process_cmd_response(dev, desc, res);
-			ri = (ri + 1) % (dev->ring_pairs[0].depth);
-			dev->ring_pairs[0].indexes->r_index = be32_to_cpu(ri);
-			dev->ring_pairs[0].counters->jobs_processed += 1;
-
-			iowrite32be(dev->ring_pairs[0].counters->jobs_processed,
-				&dev->ring_pairs[0].shadow_counters->resp_jobs_processed);
-		}
-	}
+	/* Command ring response processing */
+	process_cmd_ring(dev);
 	return;
 }
 
@@ -1521,63 +1782,54 @@ CMD_RING_RESP:
 void process_response(fsl_crypto_dev_t *dev, fsl_h_rsrc_ring_pair_t *ring_cursor)
 {
 	uint32_t pollcount;
-	uint32_t jobs_added = 0;
 	uint32_t resp_cnt = 0;
-	uint32_t ri;
 	uint64_t desc;
 	int32_t res = 0;
 	struct device *my_dev = &dev->priv_dev->dev->dev;
 #ifndef HIGH_PERF
-	uint32_t r_id;
 	uint32_t app_resp_cnt = 0;
 #endif
 
+	/* Command responses go to their waiters, which may be polling the
+	 * ring themselves */
+	if (0 == ring_cursor->info.ring_id) {
+		print_debug("COMMAND RING GOT AN INTERRUPT\n");
+		process_cmd_ring(ring_cursor->dev);
+		*(ring_cursor->intr_ctrl_flag) = 0;
+		return;
+	}
+
 	pollcount = 0;
 
 	while (pollcount++ < napi_poll_count) {
-		jobs_added = be32_to_cpu(ring_cursor->s_c_counters->jobs_added);
-		resp_cnt = jobs_added - ring_cursor->counters->jobs_processed;
+		resp_cnt = rc_resp_pending(ring_cursor->counters,
+					   ring_cursor->s_c_counters);
 		if (!resp_cnt)
 			continue;
 
 		dev = ring_cursor->dev;
-#ifndef HIGH_PERF
-		r_id = ring_cursor->info.ring_id;
-#endif
-		ri = ring_cursor->indexes->r_index;
 		print_debug("RING ID: %d\n", ring_cursor->info.ring_id);
 		print_debug("GOT INTERRUPT FROM DEV: %d\n", dev->config->dev_no);
 
 		while (resp_cnt) {
-			desc = be64_to_cpu(ring_cursor->resp_r[ri].sec_desc);
-			res = be32_to_cpu(ring_cursor->resp_r[ri].result);
-#ifndef HIGH_PERF
-			if (r_id == 0) {
-				print_debug("COMMAND RING GOT AN INTERRUPT\n");
-				if (desc)
-					process_cmd_response(dev, desc, res);
-			} else
-#endif
-			{
-				print_debug("APP RING GOT AN INTERRUPT\n");
-				if (desc) {
-					handle_response(dev, desc, res);
-				} else {
-					dev_err(my_dev, "INVALID DESC AT RI : %u\n", ri);
-				}
-				if (res) {
-					sec_jr_strstatus(my_dev, res);
-				}
+			rc_resp_peek(ring_cursor->resp_r, ring_cursor->indexes,
+				     &desc, &res);
+			print_debug("APP RING GOT AN INTERRUPT\n");
+			if (desc) {
+				handle_response(dev, desc, res);
+			} else {
+				dev_err(my_dev, "INVALID DESC AT RI : %u\n",
+					ring_cursor->indexes->r_index);
+			}
+			if (res) {
+				sec_jr_strstatus(my_dev, res);
+			}
 #ifndef HIGH_PERF
-				atomic_inc_return(&dev->app_resp_cnt);
+			atomic_inc_return(&dev->app_resp_cnt);
 #endif
-			}
-			ring_cursor->counters->jobs_processed += 1;
-			iowrite32be(ring_cursor->counters->jobs_processed,
-				&ring_cursor->shadow_counters->jobs_processed);
-
-			ri = (ri + 1) % (ring_cursor->depth);
-			ring_cursor->indexes->r_index = ri;
+			rc_resp_next(ring_cursor->depth, ring_cursor->indexes,
+				     ring_cursor->counters,
+				     ring_cursor->shadow_counters);
 			--resp_cnt;
 		}
 	}
@@ -36,6 +36,8 @@
 #ifndef FSL_PKC_CRYPTO_LAYER_H
 #define FSL_PKC_CRYPTO_LAYER_H
 
+#include "ring_core.h"
+
 extern int napi_poll_count;
 
 /* the number of context pools is arbitrary and NR_CPUS is a good default
@@ -117,6 +119,7 @@ struct fsl_h_mem_handshake {
 			uint32_t p_ob_mem_base_l;
 			uint32_t p_ob_mem_base_h;
 			uint32_t no_secs;
+			uint32_t caps;
 		} device;
 		struct config_data {
 			uint32_t s_r_cntrs;
@@ -158,6 +161,7 @@ struct crypto_c_hs_mem {
 			uint32_t s_cntrs;
 			uint32_t r_s_cntrs;
 			uint32_t fw_resp_ring_depth;
+			uint32_t fw_stats;
 		} config;
 		struct c_ring_data {
 			uint8_t rid;
@@ -199,32 +203,6 @@ typedef struct fsl_h_rsrc_pool {
 	uint32_t len;
 } fsl_h_rsrc_pool_t;
 
-/*******************************************************************************
-Description :	Defines the ring indexes
-Fields      :	w_index		: Request ring write index
-		r_index		: Response ring read index
-*******************************************************************************/
-struct ring_idxs_mem {
-	uint32_t w_index;
-	uint32_t r_index;
-};
-
-/*******************************************************************************
-Description :	Contains the counters per job ring. There will two copies one
-		for local usage and one shadowed for firmware
-Fields      :	Local memory
-		jobs_added	: Count of number of req jobs added
-		jobs_processed	: Count of number of resp jobs processed
-
-		Shadow copy memory
-		jobs_added	: Count of number of resp jobs added by fw
-		jobs_processed	: Count of number of req jobs processed by fw
-*******************************************************************************/
-struct ring_counters_mem {
-	uint32_t jobs_added;
-	uint32_t jobs_processed;
-};
-
 /*******************************************************************************
 Description :	Contains the total counters. There will two copies one
 		for local usage and one shadowed for firmware
@@ -262,24 +240,6 @@ typedef struct crypto_dev_info {
 
 /**** RING PAIR RELATED DATA STRUCTURES ****/
 
-/*******************************************************************************
-Description : Identifies the request ring entry
-Fields      : sec_desc        : DMA address of the sec addr valid in dev domain
-*******************************************************************************/
-struct req_ring_entry {
-	dev_dma_addr_t sec_desc;
-};
-
-/*******************************************************************************
-Description :	Identifies the response ring entry
-Fields      :	sec_desc: DMA address of the sec addr valid in dev domain
-		result	: Result word from sec engine
-*******************************************************************************/
-struct resp_ring_entry {
-	dev_dma_addr_t sec_desc;
-	volatile int32_t result;
-} __packed;
-
 /*******************************************************************************
 Description :	Contains the information about each ring pair
 Fields      :	depth: Depth of the ring
@@ -311,16 +271,38 @@ typedef struct fsl_h_rsrc_ring_pair {
 	struct ring_counters_mem *shadow_counters;
 
 	uint32_t depth;
+	/* Slots reserved for the ring at handshake, the most it can be
+	 * resized to without a rehandshake */
+	uint32_t max_depth;
 	uint32_t core_no;
 	uint32_t num_of_sec_engines;
 
 	atomic_t sec_eng_sel;
 	spinlock_t ring_lock;
 
+	/* PKC jobs posted on the ring and not answered yet, handed to
+	 * another device if this one is reset */
+	spinlock_t job_lock;
+	struct list_head jobs;
+
 	/* Will be used to notify the running contexts to block the ring -
 	 * used during reset operations */
 	atomic_t block;
 
+	/* Rebalancing statistics: smoothed occupancy (scaled by 8), jobs
+	 * consumed by fw in the last interval and the counter it was taken
+	 * from, and whether a session may move off the ring */
+	uint32_t rb_occ;
+	uint32_t rb_rate;
+	uint32_t rb_done;
+	atomic_t rb_move;
+
+#ifdef SW_FALLBACK
+	/* Smoothed completion latency (ns) and ring occupancy seen by the
+	 * jobs completed on this ring - used to estimate the queue delay */
+	uint32_t lat_avg;
+	uint32_t occ_avg;
+#endif
 } fsl_h_rsrc_ring_pair_t;
 
 /* Structure defining the input pool */
@@ -383,6 +365,7 @@ struct crypto_h_mem_layout {
 	struct ring_counters_mem *s_c_r_cntrs_mem;
 	struct counters_mem *cntrs_mem;
 	struct counters_mem *s_c_cntrs_mem;
+	struct fw_stats_mem *fw_stats;
 	void *op_pool;
 	void *ip_pool;
 
@@ -399,6 +382,7 @@ struct driver_ob_mem {
 	uint32_t s_c_r_cntrs_mem;
 	uint32_t s_c_cntrs_mem;
 	uint32_t cntrs_mem;
+	uint32_t fw_stats;
 };
 
 /* Per dev status structure */
@@ -407,6 +391,9 @@ typedef struct per_dev_struct {
 } per_dev_struct_t;
 
 typedef struct ctx_pool ctx_pool_t;
+struct ecc_curve_res;
+struct ecdsa_presig_pool;
+struct crypto_op_ctx;
 
 /*******************************************************************************
 Description :	Contains all the information of the crypto device.
@@ -425,6 +412,8 @@ typedef struct fsl_crypto_dev {
 	struct c29x_dev *priv_dev;
 
 	crypto_dev_info_t dev_info;
+	/* FW_CAP_* reported by the firmware when it came up */
+	uint32_t fw_caps;
 	struct crypto_dev_config *config;
 	struct driver_ob_mem ob_mem;
 	uint32_t tot_req_mem_size;
@@ -459,6 +448,13 @@ typedef struct fsl_crypto_dev {
 	 * of the available static contexts */
 	ctx_pool_t *ctx_pool;
 
+	/* Named ECC curves resident in the input pool */
+	struct ecc_curve_res *ecc_curves;
+#ifdef ECDSA_PRESIG
+	/* ECDSA presignature pools, one per named curve */
+	struct ecdsa_presig_pool *presig;
+#endif
+
 	/* Firmware resp ring information */
 #define NUM_OF_RESP_RINGS 1
 	struct fw_resp_ring fw_resp_rings[NUM_OF_RESP_RINGS];
@@ -468,24 +464,38 @@ typedef struct fsl_crypto_dev {
 
 	/* Holds the count of number of crypto dev sessions */
 	atomic_t crypto_dev_sess_cnt;
+	/* Ring sessions move to when theirs is hot, 0 for none */
+	uint32_t rb_target;
 
 	/* FIXME: really? a percpu variable to remember a device state? */
 	/* FLAG TO INDICATE DEVICE'S LIVELENESS STATUS */
 	per_dev_struct_t __percpu *dev_status;
 	atomic_t active_jobs;
 
+	/* Commands sent on ring 0 and waiting for their response */
+	spinlock_t cmd_lock;
+	struct list_head cmd_list;
+
 	atomic_t app_req_cnt;
 	atomic_t app_resp_cnt;
 } fsl_crypto_dev_t;
 
 int32_t app_ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 			 dev_dma_addr_t sec_desc);
+int32_t app_ring_enqueue_job(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
+			     dev_dma_addr_t sec_desc, struct crypto_op_ctx *ctx);
+uint32_t app_ring_enqueue_batch(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
+				dev_dma_addr_t *sec_desc,
+				struct crypto_op_ctx **ctxs, uint32_t nr);
 int32_t cmd_ring_enqueue(fsl_crypto_dev_t *c_dev, uint32_t jr_id,
 			 dev_dma_addr_t sec_desc);
 
 fsl_crypto_dev_t *fsl_crypto_layer_add_device(struct c29x_dev *dev,
 		struct crypto_dev_config *config);
 void demux_fw_responses(fsl_crypto_dev_t *dev);
+#ifndef VIRTIO_C2X0
+void failover_app_jobs(fsl_crypto_dev_t *dev);
+#endif
 void cleanup_crypto_device(fsl_crypto_dev_t *dev);
 int32_t handshake(fsl_crypto_dev_t *dev, struct crypto_dev_config *config);
 void rearrange_rings(fsl_crypto_dev_t *dev, struct crypto_dev_config *config);
@@ -508,6 +518,11 @@ void stop_device(fsl_crypto_dev_t *dev);
 void start_device(fsl_crypto_dev_t *dev);
 
 int32_t set_device_status_per_cpu(fsl_crypto_dev_t *c_dev, uint8_t set);
+#define CRYPTO_INFO_STR_LENGTH 200
+int prepare_crypto_cfg_info_string(struct crypto_dev_config *config,
+		uint8_t *cryp_cfg_str);
+int32_t read_fw_stats(fsl_crypto_dev_t *dev, struct fw_stats_mem *stats);
+ssize_t show_fw_stats(struct c29x_dev *fsl_pci_dev, char *buf);
 
 #ifdef MULTIPLE_RESP_RINGS
 int32_t process_rings(fsl_crypto_dev_t *, struct list_head *);
@@ -48,6 +48,13 @@
 #include "algs_reg.h"
 #include "test.h"
 #include "dma.h"
+#ifndef VIRTIO_C2X0
+#include "ring_balance.h"
+#include "user_ring.h"
+#endif
+#ifdef PKC_CACHE
+#include "pkc_cache.h"
+#endif
 
 static void create_default_config(struct crypto_dev_config *, uint8_t, uint8_t);
 /*********************************************************
@@ -60,6 +67,10 @@ static void create_default_config(struct crypto_dev_config *, uint8_t, uint8_t);
  *********************************************************/
 static long fsl_cryptodev_ioctl(struct file *filp, unsigned int cmd,
 				unsigned long arg);
+#ifndef VIRTIO_C2X0
+static int fsl_cryptodev_open(struct inode *inode, struct file *filp);
+static int fsl_cryptodev_release(struct inode *inode, struct file *filp);
+#endif
 
 /*********************************************************
  *        GLOBAL VARIABLES                               *
@@ -138,6 +149,11 @@ struct c29x_dev *g_fsl_pci_dev;
 static const struct file_operations fsl_cryptodev_fops = {
 	.owner = THIS_MODULE,
 	.unlocked_ioctl = fsl_cryptodev_ioctl,
+#ifndef VIRTIO_C2X0
+	.open = fsl_cryptodev_open,
+	.mmap = user_ring_mmap,
+	.release = fsl_cryptodev_release,
+#endif
 };
 
 static struct miscdevice fsl_cryptodev = {
@@ -240,6 +256,21 @@ fsl_crypto_dev_t *get_crypto_dev(uint32_t no)
 	return NULL;
 }
 
+#ifndef VIRTIO_C2X0
+/* misc_open() leaves the miscdevice in private_data, the rings go there */
+static int fsl_cryptodev_open(struct inode *inode, struct file *filp)
+{
+	filp->private_data = NULL;
+	return 0;
+}
+
+static int fsl_cryptodev_release(struct inode *inode, struct file *filp)
+{
+	user_ring_release(filp);
+	return 0;
+}
+#endif
+
 /*******************************************************************************
  * Function     : fsl_cryptodev_ioctl
  *
@@ -301,6 +332,18 @@ static long fsl_cryptodev_ioctl(struct file *filp, unsigned int cmd,
 			return validate_cmd_args(c_dev, &usr_cmd_desc); 
 #endif
 		}
+#ifndef VIRTIO_C2X0
+	case USERRINGSETUP:
+		return user_ring_setup(filp, (void __user *)arg);
+	case USERRINGENTER:
+		return user_ring_enter(filp, (void __user *)arg);
+	case USERRINGSUBMIT:
+		return user_ring_submit_batch(filp, (void __user *)arg);
+	case USERRINGREAP:
+		return user_ring_reap(filp, (void __user *)arg);
+	case USERRINGEVENTFD:
+		return user_ring_set_eventfd(filp, (void __user *)arg);
+#endif
 #ifdef VIRTIO_C2X0
 	case VIRTIOOPERATION:
 		{
@@ -1154,7 +1197,8 @@ int fsl_request_irqs(struct c29x_dev *fsl_pci_dev)
 	/* this was set-up earlier by get_irq_vectors */
 	num_of_vectors = fsl_pci_dev->intr_info.intr_vectors_cnt;
 	for (i = 0; i < num_of_vectors; i++) {
-		isr_context = kzalloc(sizeof(*isr_context), GFP_KERNEL);
+		isr_context = kzalloc_node(sizeof(*isr_context), GFP_KERNEL,
+					   dev_to_node(my_dev));
 		if (!isr_context) {
 			dev_err(my_dev, "Mem alloc failed\n");
 			err = -ENOMEM;
@@ -1713,7 +1757,8 @@ static int32_t fsl_crypto_pci_probe(struct pci_dev *dev,
 	}
 
 	/* Allocate memory for the new PCI device data structure */
-	fsl_pci_dev = kzalloc(sizeof(struct c29x_dev), GFP_KERNEL);
+	fsl_pci_dev = kzalloc_node(sizeof(struct c29x_dev), GFP_KERNEL,
+				   dev_to_node(&dev->dev));
 	if (!fsl_pci_dev) {
 		print_error("Memory allocation failed\n");
 		return -ENOMEM;
@@ -1980,6 +2025,8 @@ static int32_t __init fsl_crypto_drv_init(void)
 	spin_lock_init(&hash_sess_list_lock);
 	spin_lock_init(&symm_sess_list_lock);
 #else
+	ring_balance_start();
+
 	/* FIXME: proper clean-up for tests */
 	init_all_test();
 #endif
@@ -2019,6 +2066,7 @@ static void __exit fsl_crypto_drv_exit(void)
 {
 #ifndef VIRTIO_C2X0
 	clean_all_test();
+	ring_balance_stop();
 #endif
 
 #ifdef RNG_OFFLOAD 
@@ -2037,6 +2085,9 @@ static void __exit fsl_crypto_drv_exit(void)
 	/* Clean up all the devices and the resources */
 	pci_unregister_driver(&fsl_cypto_driver);
 
+#ifdef PKC_CACHE
+	pkc_cache_flush();
+#endif
 	clean_common_sysfs();
 
 	/* Cleanup the configuration file linked list */
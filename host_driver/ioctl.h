@@ -38,6 +38,13 @@
 
 #define CMDOPERATION _IOWR('c', 201, user_command_args_t)
 #define CHECKCMD _IOWR('c', 209, user_command_args_t)
+#ifndef VIRTIO_C2X0
+#define USERRINGSETUP _IOWR('c', 210, struct user_ring_params)
+#define USERRINGENTER _IOWR('c', 211, struct user_ring_enter)
+#define USERRINGSUBMIT _IOWR('c', 212, struct user_ring_batch)
+#define USERRINGREAP _IOWR('c', 213, struct user_ring_batch)
+#define USERRINGEVENTFD _IOW('c', 214, int32_t)
+#endif
 #ifdef VIRTIO_C2X0
 #define VIRTIOOPERATION _IOWR('c', 202, struct virtio_c2x0_qemu_cmd *)
 #define VIRTIOOPSTATUS _IOWR('c', 203, struct virtio_c2x0_qemu_cmd *)
@@ -0,0 +1,297 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FSL_PKC_RING_CORE_H
+#define FSL_PKC_RING_CORE_H
+
+/*******************************************************************************
+ * Ring protocol shared with the C29x firmware: the layout of the request and
+ * response rings, their indexes and counters, the producer / consumer steps
+ * on them and the statistics block the firmware publishes. Nothing here
+ * depends on the kernel, so the same code builds into this module and into a
+ * userspace poll mode driver owning the rings through mapped BARs.
+ * "make check" builds it in userspace and runs it against a simulated
+ * firmware (apps/ring_test), which implements the optional features.
+ *
+ * Locking, interrupt control and job bookkeeping are left to the caller.
+ * Counters local to the host are native endian; those in the shadow memory
+ * the firmware reads or writes are big endian.
+ ******************************************************************************/
+#ifdef __KERNEL__
+#define RC_WR32BE(val, addr)	iowrite32be((val), (addr))
+#define RC_WR64BE(val, addr)	IOWRITE64BE((val), (addr))
+#define RC_BE32(val)		be32_to_cpu(val)
+#define RC_BE64(val)		be64_to_cpu(val)
+#define RC_WMB()		wmb()
+#define RC_RMB()		rmb()
+#define RC_RELAX()		cpu_relax()
+#else
+#include <stdint.h>
+#include <errno.h>
+#include <endian.h>
+
+#ifdef DEV_PHYS_ADDR_32BIT
+typedef uint32_t dev_dma_addr_t;
+#else
+typedef uint64_t dev_dma_addr_t;
+#endif
+
+#ifndef __packed
+#define __packed		__attribute__((packed))
+#endif
+
+#define RC_WR32BE(val, addr)	(*(volatile uint32_t *)(addr) = htobe32(val))
+#define RC_WR64BE(val, addr)	do { \
+	RC_WR32BE((uint32_t)((uint64_t)(val) >> 32), (addr)); \
+	RC_WR32BE((uint32_t)(val), (uint8_t *)(addr) + sizeof(uint32_t)); \
+	} while (0)
+#define RC_BE32(val)		be32toh(val)
+#define RC_BE64(val)		be64toh(val)
+#define RC_WMB()		__sync_synchronize()
+#ifndef RC_RMB
+#define RC_RMB()		__sync_synchronize()
+#endif
+#ifndef RC_RELAX
+#define RC_RELAX()		do { } while (0)
+#endif
+#endif
+
+/* Optional features the firmware reports in fw_up_data.caps. The host
+ * clears the word before the handshake, so older firmware reports none */
+#define FW_CAP_RING_CONFIG	0x00000001
+#define FW_CAP_STATS		0x00000002
+
+/*******************************************************************************
+Description :	Defines the ring indexes
+Fields      :	w_index		: Request ring write index
+		r_index		: Response ring read index
+*******************************************************************************/
+struct ring_idxs_mem {
+	uint32_t w_index;
+	uint32_t r_index;
+};
+
+/*******************************************************************************
+Description :	Contains the counters per job ring. There will two copies one
+		for local usage and one shadowed for firmware
+Fields      :	Local memory
+		jobs_added	: Count of number of req jobs added
+		jobs_processed	: Count of number of resp jobs processed
+
+		Shadow copy memory
+		jobs_added	: Count of number of resp jobs added by fw
+		jobs_processed	: Count of number of req jobs processed by fw
+*******************************************************************************/
+struct ring_counters_mem {
+	uint32_t jobs_added;
+	uint32_t jobs_processed;
+};
+
+/*******************************************************************************
+Description : Identifies the request ring entry
+Fields      : sec_desc        : DMA address of the sec addr valid in dev domain
+*******************************************************************************/
+struct req_ring_entry {
+	dev_dma_addr_t sec_desc;
+};
+
+/*******************************************************************************
+Description :	Identifies the response ring entry
+Fields      :	sec_desc: DMA address of the sec addr valid in dev domain
+		result	: Result word from sec engine
+*******************************************************************************/
+struct resp_ring_entry {
+	dev_dma_addr_t sec_desc;
+	volatile int32_t result;
+} __packed;
+
+/* Jobs posted on a request ring and not yet consumed by the firmware */
+static inline uint32_t rc_req_inflight(const struct ring_counters_mem *cntrs,
+				       const struct ring_counters_mem *s_c_cntrs)
+{
+	return cntrs->jobs_added - RC_BE32(s_c_cntrs->jobs_processed);
+}
+
+/* Writes one descriptor at the write index; the caller checked for room */
+static inline void rc_req_put(struct req_ring_entry *req_r, uint32_t depth,
+			      struct ring_idxs_mem *idxs,
+			      struct ring_counters_mem *cntrs,
+			      dev_dma_addr_t sec_desc)
+{
+	uint32_t wi = idxs->w_index;
+
+	RC_WR64BE(sec_desc, &req_r[wi].sec_desc);
+	idxs->w_index = (wi + 1) % depth;
+	cntrs->jobs_added += 1;
+}
+
+/* Hands the descriptors put so far to the firmware */
+static inline void rc_req_publish(const struct ring_counters_mem *cntrs,
+				  struct ring_counters_mem *shadow)
+{
+	RC_WMB();
+	shadow->jobs_added = RC_BE32(cntrs->jobs_added);
+}
+
+/* Responses posted by the firmware and not yet consumed */
+static inline uint32_t rc_resp_pending(const struct ring_counters_mem *cntrs,
+				       const struct ring_counters_mem *s_c_cntrs)
+{
+	return RC_BE32(s_c_cntrs->jobs_added) - cntrs->jobs_processed;
+}
+
+/* Reads the response at the read index */
+static inline void rc_resp_peek(const struct resp_ring_entry *resp_r,
+				const struct ring_idxs_mem *idxs,
+				uint64_t *desc, int32_t *res)
+{
+	uint32_t ri = idxs->r_index;
+
+	*desc = RC_BE64(resp_r[ri].sec_desc);
+	*res = RC_BE32(resp_r[ri].result);
+}
+
+/* Consumes the response at the read index and tells the firmware */
+static inline void rc_resp_next(uint32_t depth, struct ring_idxs_mem *idxs,
+				struct ring_counters_mem *cntrs,
+				struct ring_counters_mem *shadow)
+{
+	cntrs->jobs_processed += 1;
+	RC_WR32BE(cntrs->jobs_processed, &shadow->jobs_processed);
+	idxs->r_index = (idxs->r_index + 1) % depth;
+}
+
+/* Every job posted on the ring pair has had its response consumed */
+static inline int rc_ring_idle(const struct ring_counters_mem *cntrs)
+{
+	return cntrs->jobs_added == cntrs->jobs_processed;
+}
+
+/* Restarts a drained ring pair once the firmware has taken its new depth
+ * (RINGCONFIG, with FW_CAP_RING_CONFIG): both sides index it from 0 again,
+ * the counters carry on */
+static inline void rc_ring_restart(struct ring_idxs_mem *idxs)
+{
+	idxs->w_index = 0;
+	idxs->r_index = 0;
+}
+
+/*******************************************************************************
+Description :	Statistics block the firmware refreshes in the outbound memory
+		when it reports FW_CAP_STATS, all fields big endian. seq is odd
+		while the firmware rewrites the block, readers retry until they
+		see the same even value before and after their copy.
+Fields      :	magic		: FW_STATS_MAGIC once the firmware publishes
+		seq		: update sequence
+		interval	: refresh period in ms
+		no_secs		: valid entries in sec
+		no_rings	: valid entries in ring
+		sec		: jobs, errors and busy cycles per SEC engine
+		ring		: jobs processed and errors per ring pair
+*******************************************************************************/
+#define FW_STATS_MAGIC		0x46535453	/* "FSTS" */
+#define FW_STATS_MAX_SECS	3
+#define FW_STATS_MAX_RINGS	6	/* FSL_CRYPTO_MAX_RING_PAIRS */
+/* Copies seen while the firmware keeps rewriting the block are retried
+ * this many times before giving up */
+#define FW_STATS_RETRIES	10
+
+struct fw_stats_mem {
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t interval;
+	uint32_t no_secs;
+	uint32_t no_rings;
+	uint32_t pad;
+	struct fw_sec_stats {
+		uint32_t jobs;
+		uint32_t errors;
+		uint64_t busy_cycles;
+	} sec[FW_STATS_MAX_SECS];
+	struct fw_ring_stats {
+		uint32_t jobs_processed;
+		uint32_t errors;
+	} ring[FW_STATS_MAX_RINGS];
+};
+
+/* Takes a host order copy of the block: 0, -ENODEV while the firmware has
+ * not published it or -EBUSY if every try overlapped a refresh */
+static inline int rc_stats_read(const volatile struct fw_stats_mem *fw,
+				struct fw_stats_mem *stats)
+{
+	uint32_t seq, i, n;
+
+	if (FW_STATS_MAGIC != RC_BE32(fw->magic))
+		return -ENODEV;
+
+	for (n = 0; n < FW_STATS_RETRIES; n++) {
+		seq = RC_BE32(fw->seq);
+		if (seq & 1) {
+			RC_RELAX();
+			continue;
+		}
+		RC_RMB();
+
+		stats->interval = RC_BE32(fw->interval);
+		stats->no_secs = RC_BE32(fw->no_secs);
+		if (stats->no_secs > FW_STATS_MAX_SECS)
+			stats->no_secs = FW_STATS_MAX_SECS;
+		stats->no_rings = RC_BE32(fw->no_rings);
+		if (stats->no_rings > FW_STATS_MAX_RINGS)
+			stats->no_rings = FW_STATS_MAX_RINGS;
+		for (i = 0; i < stats->no_secs; i++) {
+			stats->sec[i].jobs = RC_BE32(fw->sec[i].jobs);
+			stats->sec[i].errors = RC_BE32(fw->sec[i].errors);
+			stats->sec[i].busy_cycles =
+				RC_BE64(fw->sec[i].busy_cycles);
+		}
+		for (i = 0; i < stats->no_rings; i++) {
+			stats->ring[i].jobs_processed =
+				RC_BE32(fw->ring[i].jobs_processed);
+			stats->ring[i].errors = RC_BE32(fw->ring[i].errors);
+		}
+
+		RC_RMB();
+		if (RC_BE32(fw->seq) == seq) {
+			stats->magic = FW_STATS_MAGIC;
+			stats->seq = seq;
+			return 0;
+		}
+	}
+	return -EBUSY;
+}
+
+#endif
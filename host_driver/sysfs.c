@@ -51,7 +51,7 @@ int8_t *pci_sysfs_file_names[NUM_OF_PCI_SYSFS_FILES] = { "info" };
 int8_t *crypto_sysfs_file_names[NUM_OF_CRYPTO_SYSFS_FILES] = { "info" };
 
 int8_t *stat_sysfs_file_names[NUM_OF_STATS_SYSFS_FILES] = {
-	"req_count", "resp_count"
+	"req_count", "resp_count", "fw_stats"
 };
 
 int8_t *test_sysfs_file_names[NUM_OF_TEST_SYSFS_FILES] = {
@@ -62,7 +62,7 @@ uint8_t dev_sysfs_file_str_flag[1] = { 1 };
 uint8_t fw_sysfs_file_str_flag[NUM_OF_FW_SYSFS_FILES] = { 1, 1, 1, 1 };
 uint8_t pci_sysfs_file_str_flag[NUM_OF_PCI_SYSFS_FILES] = { 1 };
 uint8_t crypto_sysfs_file_str_flag[NUM_OF_CRYPTO_SYSFS_FILES] = { 1 };
-uint8_t stat_sysfs_file_str_flag[NUM_OF_STATS_SYSFS_FILES] = { 0, 0 };
+uint8_t stat_sysfs_file_str_flag[NUM_OF_STATS_SYSFS_FILES] = { 0, 0, 1 };
 uint8_t test_sysfs_file_str_flag[NUM_OF_TEST_SYSFS_FILES] = { 1, 1, 1, 0 };
 
 void *napi_loop_count_file;
@@ -75,6 +75,10 @@ ssize_t common_sysfs_show(struct kobject *kobj, struct attribute *attr,
 	struct k_sysfs_file *sysfs_file =
 	    container_of(pci_attr, struct k_sysfs_file, attr);
 	size_t buf_len;
+
+	if (sysfs_file->show)
+		return sysfs_file->show(sysfs_file->dev, buf);
+
 	if (sysfs_file->str_flag) {
 		sprintf(buf, "%s\n", sysfs_file->buf);
 		buf_len = sysfs_file->buf_len;
@@ -95,6 +99,9 @@ ssize_t common_sysfs_store(struct kobject *kobj, struct attribute *attr,
 	struct k_sysfs_file *sysfs_file =
 	    container_of(pci_attr, struct k_sysfs_file, attr);
 
+	if (!sysfs_file->cb)
+		return -EPERM;
+
 	if (sysfs_file->str_flag) {
 		size = min_t(size_t, size, MAX_SYSFS_BUFFER);
 
@@ -230,6 +237,7 @@ int32_t init_common_sysfs(void)
 int32_t init_sysfs(struct c29x_dev *fsl_pci_dev)
 {
 	uint32_t i = 0;
+	struct k_sysfs_file *file;
 
 	fsl_pci_dev->sysfs.dev_dir =
 	    create_sysfs_dir(fsl_pci_dev->dev_name, fsl_sysfs_entries);
@@ -337,6 +345,11 @@ int32_t init_sysfs(struct c29x_dev *fsl_pci_dev)
 			return -1;
 		}
 	}
+	/* fw_stats reads the block the firmware keeps refreshing */
+	file = fsl_pci_dev->sysfs.stats_files[STATS_FW_SYS_FILE -
+					      STATS_SYS_FILES_START - 1].file;
+	file->show = show_fw_stats;
+	file->dev = fsl_pci_dev;
 
 #ifndef VIRTIO_C2X0
 	/* Test sysfs file */
@@ -86,6 +86,7 @@ typedef enum sys_files_id {
 	STATS_SYS_FILES_START,
 	STATS_REQ_COUNT_SYS_FILE,
 	STATS_RESP_COUNT_SYS_FILE,
+	STATS_FW_SYS_FILE,
 	STATS_SYS_FILES_END,
 
 	/* Block of enums for files in test dir */
@@ -134,6 +135,7 @@ struct sysfs_dir {
 };
 
 #define K_SYSFS_FILE_NAME_LEN 16
+struct c29x_dev;
 struct k_sysfs_file {
 	struct k_obj_attribute attr;
 	uint8_t name[K_SYSFS_FILE_NAME_LEN];
@@ -142,8 +144,10 @@ struct k_sysfs_file {
 	uint32_t num;
 	size_t buf_len;
 	void (*cb) (char *, char *, int);
+	/* Files generating their contents on each read */
+	ssize_t (*show) (struct c29x_dev *, char *);
+	struct c29x_dev *dev;
 };
-struct c29x_dev;
 /* Head of all the sysfs entries */
 extern struct sysfs_dir *fsl_sysfs_entries;
 
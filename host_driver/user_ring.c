@@ -0,0 +1,903 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <linux/capability.h>
+#include <linux/crypto.h>
+#include <linux/eventfd.h>
+#include <linux/kthread.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0))
+#include <linux/sched/signal.h>
+#include <linux/sched/user.h>
+#else
+#include <linux/sched.h>
+#endif
+
+#include "common.h"
+#include "fsl_c2x0_crypto_layer.h"
+#include "fsl_c2x0_driver.h"
+#include "algs.h"
+#include "ring_balance.h"
+#include "user_ring.h"
+
+/* Largest block alloc_pages_exact() hands out */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0))
+#define UR_MAX_MAP	(PAGE_SIZE << MAX_PAGE_ORDER)
+#elif (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0))
+#define UR_MAX_MAP	(PAGE_SIZE << MAX_ORDER)
+#else
+#define UR_MAX_MAP	(PAGE_SIZE << (MAX_ORDER - 1))
+#endif
+
+/* Fields written by the application are read exactly once */
+#define UR_READ(x)	(*(volatile typeof(x) *)&(x))
+
+/* Operand of a request type: offsets of its pointer and length fields */
+struct user_ring_arg {
+	uint16_t ptr;
+	uint16_t len;
+};
+
+#define UR_NO_PTR	0xffff
+#define UR_OFF(s, f)	offsetof(struct pkc_request, req_u.s.f)
+#define UR_ARG(s, f)	{ UR_OFF(s, f), UR_OFF(s, f##_len) }
+#define UR_ARG_LEN(s, f, l)	{ UR_OFF(s, f), UR_OFF(s, l) }
+#define UR_LEN(s, l)	{ UR_NO_PTR, UR_OFF(s, l) }
+
+/* Operand sizes the descriptors can express: pkc(rsa) keys up to 4096 bits,
+ * the 10 bit L and 7 bit N of the DSA and DH PDBs */
+#define UR_RSA_MAX	512
+#define UR_L_MAX	512
+#define UR_N_MAX	127
+
+enum user_ring_tfm {
+	UR_RSA,
+	UR_DSA,
+	UR_DH,
+	UR_TFMS
+};
+
+static const char *const user_ring_algs[UR_TFMS] = {
+	"pkc-rsa-fsl",
+	"pkc-dsa-fsl",
+	"pkc-dh-fsl",
+};
+
+/* Argument lists end at the first zero length offset, base is at 0. Every
+ * argument is mandatory but the ones of the opt bitmask */
+struct user_ring_op {
+	enum user_ring_tfm tfm;
+	struct user_ring_arg args[USER_RING_MAX_ARGS];
+	uint32_t opt;
+};
+
+/* Places in the DSA and DH lists: the curve a,b, optional for DSA and DH,
+ * and the DSA c whose length has no field of its own */
+#define UR_DSA_AB	(1 << 5)
+#define UR_DH_AB	(1 << 1)
+#define UR_DSA_C	6
+
+#define UR_DSA_SIGN_ARGS { \
+	UR_ARG(dsa_sign, q), UR_ARG(dsa_sign, r), UR_ARG(dsa_sign, g), \
+	UR_ARG(dsa_sign, priv_key), UR_ARG(dsa_sign, m), \
+	UR_ARG(dsa_sign, ab), UR_ARG_LEN(dsa_sign, c, d_len), \
+	UR_ARG(dsa_sign, d) }
+#define UR_DSA_VERIFY_ARGS { \
+	UR_ARG(dsa_verify, q), UR_ARG(dsa_verify, r), UR_ARG(dsa_verify, g), \
+	UR_ARG(dsa_verify, pub_key), UR_ARG(dsa_verify, m), \
+	UR_ARG(dsa_verify, ab), UR_ARG_LEN(dsa_verify, c, d_len), \
+	UR_ARG(dsa_verify, d) }
+#define UR_DH_ARGS { \
+	UR_ARG(dh_req, q), UR_ARG(dh_req, ab), UR_ARG(dh_req, pub_key), \
+	UR_ARG(dh_req, s), UR_ARG(dh_req, z) }
+
+static const struct user_ring_op user_ring_ops[MAX_TYPES] = {
+	[RSA_PUB] = { UR_RSA, {
+		UR_ARG(rsa_pub_req, n), UR_ARG(rsa_pub_req, e),
+		UR_ARG(rsa_pub_req, f), UR_ARG(rsa_pub_req, g) } },
+	[RSA_PRIV_FORM1] = { UR_RSA, {
+		UR_ARG(rsa_priv_f1, n), UR_ARG(rsa_priv_f1, d),
+		UR_ARG(rsa_priv_f1, g), UR_ARG(rsa_priv_f1, f) } },
+	[RSA_PRIV_FORM2] = { UR_RSA, {
+		UR_ARG(rsa_priv_f2, p), UR_ARG(rsa_priv_f2, q),
+		UR_ARG(rsa_priv_f2, d), UR_ARG(rsa_priv_f2, g),
+		UR_ARG(rsa_priv_f2, f), UR_LEN(rsa_priv_f2, n_len) } },
+	[RSA_PRIV_FORM3] = { UR_RSA, {
+		UR_ARG(rsa_priv_f3, p), UR_ARG(rsa_priv_f3, q),
+		UR_ARG(rsa_priv_f3, dp), UR_ARG(rsa_priv_f3, dq),
+		UR_ARG(rsa_priv_f3, c), UR_ARG(rsa_priv_f3, g),
+		UR_ARG(rsa_priv_f3, f) } },
+	[DSA_SIGN] = { UR_DSA, UR_DSA_SIGN_ARGS, UR_DSA_AB },
+	[ECDSA_SIGN] = { UR_DSA, UR_DSA_SIGN_ARGS },
+	[DSA_VERIFY] = { UR_DSA, UR_DSA_VERIFY_ARGS, UR_DSA_AB },
+	[ECDSA_VERIFY] = { UR_DSA, UR_DSA_VERIFY_ARGS },
+	[DH_COMPUTE_KEY] = { UR_DH, UR_DH_ARGS, UR_DH_AB },
+	[ECDH_COMPUTE_KEY] = { UR_DH, UR_DH_ARGS },
+};
+
+struct user_ring_ctx;
+
+struct user_ring_req {
+	struct pkc_request pkc;
+	struct user_ring_ctx *ctx;
+	uint64_t user_data;
+};
+
+/*******************************************************************************
+Description :	Rings of an open /dev/fsl_cryptodev file.
+Fields      :	mem	: Pages shared with the application, map_len long
+		user	: Owner, charged with the locked pages of mem
+		locked	: Pages charged, 0 with CAP_IPC_LOCK
+		hdr/sqes/cqes/buf: Parts of mem
+		sq_head	: Driver copy of the SQ head, under sq_lock
+		cq_tail	: Driver copy of the CQ tail, under cq_lock
+		reqs	: Request slots, one per CQ entry so that a
+			  completion always finds its cqe free
+		free	: Stack of nr_free free slot indices, under cq_lock
+		evfd	: Eventfd signalled per cqe, under cq_lock
+		reap_lock: Serialises USERRINGREAP
+		tfm	: Striped PKC tfms the requests are issued on
+		cq_wait	: Woken on completions
+		sq_wait	: SQ poll thread sleep, ended by sq_wake
+		closed	: File released with requests in flight, under
+			  cq_lock; the last completion queues free_work
+*******************************************************************************/
+struct user_ring_ctx {
+	void *mem;
+	size_t map_len;
+	struct user_struct *user;
+	unsigned long locked;
+	struct user_ring_hdr *hdr;
+	struct user_ring_sqe *sqes;
+	struct user_ring_cqe *cqes;
+	uint8_t *buf;
+	uint32_t buf_len;
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+
+	struct mutex sq_lock;
+	uint32_t sq_head;
+
+	spinlock_t cq_lock;
+	uint32_t cq_tail;
+	struct user_ring_req *reqs;
+	uint32_t *free;
+	uint32_t nr_free;
+	struct eventfd_ctx *evfd;
+	struct mutex reap_lock;
+
+	struct crypto_pkc *tfm[UR_TFMS];
+	wait_queue_head_t cq_wait;
+
+	struct task_struct *sq_thread;
+	wait_queue_head_t sq_wait;
+	unsigned long sq_idle;
+	bool sq_wake;
+
+	bool closed;
+	struct work_struct free_work;
+};
+
+static uint32_t user_ring_cq_ready(struct user_ring_ctx *ctx)
+{
+	return ctx->cq_tail - UR_READ(ctx->hdr->cq_head);
+}
+
+static bool user_ring_idle(struct user_ring_ctx *ctx)
+{
+	return ctx->nr_free == ctx->cq_entries;
+}
+
+static void user_ring_signal(struct eventfd_ctx *evfd)
+{
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0))
+	eventfd_signal(evfd);
+#else
+	eventfd_signal(evfd, 1);
+#endif
+}
+
+static void user_ring_post(struct user_ring_req *req, int32_t res)
+{
+	struct user_ring_ctx *ctx = req->ctx;
+	struct user_ring_cqe *cqe;
+	unsigned long flags;
+	bool last;
+
+	spin_lock_irqsave(&ctx->cq_lock, flags);
+	cqe = &ctx->cqes[ctx->cq_tail & (ctx->cq_entries - 1)];
+	cqe->user_data = req->user_data;
+	cqe->res = res;
+	smp_wmb();
+	ctx->hdr->cq_tail = ++ctx->cq_tail;
+	ctx->free[ctx->nr_free++] = req - ctx->reqs;
+	if (ctx->evfd)
+		user_ring_signal(ctx->evfd);
+
+	smp_mb();
+	if (waitqueue_active(&ctx->cq_wait))
+		wake_up(&ctx->cq_wait);
+	/* Nothing touches ctx past the lock unless the file is gone */
+	last = ctx->closed && user_ring_idle(ctx);
+	spin_unlock_irqrestore(&ctx->cq_lock, flags);
+
+	if (last)
+		schedule_work(&ctx->free_work);
+}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0))
+static void user_ring_done(void *data, int err)
+{
+	struct user_ring_req *req = data;
+#else
+static void user_ring_done(struct crypto_async_request *base, int err)
+{
+	struct user_ring_req *req = base->data;
+#endif
+
+	/* SEC status words and driver errors are not errnos */
+	if (err)
+		err = (DSA_VERIFY == req->pkc.type ||
+		       ECDSA_VERIFY == req->pkc.type) ? -EKEYREJECTED : -EIO;
+
+	user_ring_post(req, err);
+}
+
+/* A free slot, provided the CQ keeps room for every request in flight */
+static struct user_ring_req *user_ring_get_req(struct user_ring_ctx *ctx)
+{
+	struct user_ring_req *req = NULL;
+
+	spin_lock_irq(&ctx->cq_lock);
+	if (user_ring_cq_ready(ctx) < ctx->nr_free)
+		req = &ctx->reqs[ctx->free[--ctx->nr_free]];
+	spin_unlock_irq(&ctx->cq_lock);
+
+	return req;
+}
+
+static int user_ring_fill(struct user_ring_ctx *ctx,
+			  const struct user_ring_sqe *sqe,
+			  struct pkc_request *req)
+{
+	const struct user_ring_op *op = &user_ring_ops[sqe->type];
+	uint8_t *base = (uint8_t *)req;
+	uint32_t i, off, len;
+
+	if (!op->args[0].len)
+		return -EINVAL;
+
+	for (i = 0; i < USER_RING_MAX_ARGS && op->args[i].len; i++) {
+		off = sqe->args[i].off;
+		len = sqe->args[i].len;
+
+		*(uint32_t *)(base + op->args[i].len) = len;
+		if (!len) {
+			if (!(op->opt & (1 << i)))
+				return -EINVAL;
+			continue;
+		}
+		if (UR_NO_PTR == op->args[i].ptr)
+			continue;
+		if (off > ctx->buf_len || len > ctx->buf_len - off)
+			return -EINVAL;
+		*(uint8_t **)(base + op->args[i].ptr) = ctx->buf + off;
+	}
+
+	return 0;
+}
+
+/*******************************************************************************
+ * Function     : user_ring_check
+ *
+ * Arguments    : sqe - copy of the request of the application
+ *		  req - request filled from it
+ *
+ * Return Value : 0 or -EINVAL
+ *
+ * Description  : The device writes its outputs at the size the descriptor
+ *		  gives, not at the size of the output buffer: the modulus
+ *		  for RSA, N for the DSA signature, L for the DH secret.
+ *		  Checks that those sizes fit the descriptor fields and that
+ *		  every output is at least as long, so that no write lands
+ *		  past the shared pages.
+ *
+ ******************************************************************************/
+static int user_ring_check(const struct user_ring_sqe *sqe,
+			   const struct pkc_request *req)
+{
+	const struct rsa_pub_req_s *pub = &req->req_u.rsa_pub_req;
+	const struct rsa_priv_frm1_req_s *f1 = &req->req_u.rsa_priv_f1;
+	const struct rsa_priv_frm2_req_s *f2 = &req->req_u.rsa_priv_f2;
+	const struct rsa_priv_frm3_req_s *f3 = &req->req_u.rsa_priv_f3;
+	const struct dsa_sign_req_s *sign = &req->req_u.dsa_sign;
+	const struct dsa_verify_req_s *verify = &req->req_u.dsa_verify;
+	const struct dh_key_req_s *dh = &req->req_u.dh_req;
+
+	switch (sqe->type) {
+	case RSA_PUB:
+		return (pub->n_len > UR_RSA_MAX || pub->e_len > pub->n_len ||
+			pub->f_len > pub->n_len || pub->g_len < pub->n_len) ?
+			-EINVAL : 0;
+	case RSA_PRIV_FORM1:
+		return (f1->n_len > UR_RSA_MAX || f1->d_len > f1->n_len ||
+			f1->g_len > f1->n_len || f1->f_len < f1->n_len) ?
+			-EINVAL : 0;
+	case RSA_PRIV_FORM2:
+		/* f is the modulus size, n_len must agree */
+		return (f2->f_len > UR_RSA_MAX || f2->n_len != f2->f_len ||
+			f2->p_len > f2->f_len || f2->q_len > f2->f_len ||
+			f2->d_len > f2->f_len || f2->g_len > f2->f_len) ?
+			-EINVAL : 0;
+	case RSA_PRIV_FORM3:
+		return (f3->f_len > UR_RSA_MAX ||
+			f3->p_len > f3->f_len || f3->q_len > f3->f_len ||
+			f3->dp_len > f3->p_len || f3->dq_len > f3->q_len ||
+			f3->c_len > f3->p_len || f3->g_len > f3->f_len) ?
+			-EINVAL : 0;
+	case DSA_SIGN:
+	case ECDSA_SIGN:
+		/* c and d share d_len, the length of c is only in the sqe */
+		return (sign->q_len > UR_L_MAX || sign->r_len > UR_N_MAX ||
+			sqe->args[UR_DSA_C].len < sign->r_len ||
+			sign->d_len < sign->r_len) ? -EINVAL : 0;
+	case DSA_VERIFY:
+	case ECDSA_VERIFY:
+		return (verify->q_len > UR_L_MAX || verify->r_len > UR_N_MAX) ?
+			-EINVAL : 0;
+	case DH_COMPUTE_KEY:
+	case ECDH_COMPUTE_KEY:
+		return (dh->q_len > UR_L_MAX || dh->s_len > UR_N_MAX ||
+			dh->z_len < dh->q_len) ? -EINVAL : 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static void user_ring_issue(struct user_ring_ctx *ctx,
+			    struct user_ring_req *req,
+			    const struct user_ring_sqe *sqe)
+{
+	int ret = -EINVAL;
+
+	memset(&req->pkc, 0, sizeof(req->pkc));
+	req->user_data = sqe->user_data;
+
+	if (sqe->type < MAX_TYPES && !user_ring_fill(ctx, sqe, &req->pkc) &&
+	    !user_ring_check(sqe, &req->pkc)) {
+		req->pkc.type = sqe->type;
+		req->pkc.curve_type = sqe->curve_type;
+		req->pkc.base.tfm = crypto_pkc_tfm(
+				ctx->tfm[user_ring_ops[sqe->type].tfm]);
+		req->pkc.base.flags = CRYPTO_TFM_REQ_MAY_SLEEP;
+		req->pkc.base.complete = user_ring_done;
+		req->pkc.base.data = req;
+
+		ret = crypto_pkc_op(&req->pkc);
+		if (-EINPROGRESS == ret)
+			return;
+		/* Ring full or no device alive */
+		if (-1 == ret)
+			ret = -EAGAIN;
+	}
+
+	/* Answered without a job (cached result) or refused */
+	user_ring_post(req, ret);
+}
+
+/*******************************************************************************
+ * Function     : user_ring_submit
+ *
+ * Arguments    : ctx - rings of the file
+ *		  max - most requests to consume
+ *
+ * Return Value : Number of requests consumed from the SQ
+ *
+ * Description  : Issues the requests queued in the SQ, up to max and as long
+ *		  as the CQ has room for their completions. Each sqe is copied
+ *		  before use so that the application cannot change it while
+ *		  it is checked.
+ *
+ ******************************************************************************/
+static uint32_t user_ring_submit(struct user_ring_ctx *ctx, uint32_t max)
+{
+	struct user_ring_req *req;
+	struct user_ring_sqe sqe;
+	uint32_t tail, done = 0;
+
+	mutex_lock(&ctx->sq_lock);
+	tail = UR_READ(ctx->hdr->sq_tail);
+	smp_rmb();
+
+	while (done < max && ctx->sq_head != tail &&
+	       tail - ctx->sq_head <= ctx->sq_entries) {
+		req = user_ring_get_req(ctx);
+		if (!req)
+			break;
+
+		sqe = ctx->sqes[ctx->sq_head & (ctx->sq_entries - 1)];
+		ctx->sq_head++;
+		done++;
+		user_ring_issue(ctx, req, &sqe);
+	}
+
+	if (done) {
+		smp_mb();
+		ctx->hdr->sq_head = ctx->sq_head;
+	}
+	mutex_unlock(&ctx->sq_lock);
+
+	return done;
+}
+
+static int user_ring_sq_thread(void *data)
+{
+	struct user_ring_ctx *ctx = data;
+	unsigned long idle = jiffies + ctx->sq_idle;
+
+	while (!kthread_should_stop()) {
+		if (user_ring_submit(ctx, ctx->sq_entries)) {
+			idle = jiffies + ctx->sq_idle;
+			cond_resched();
+			continue;
+		}
+		if (time_before(jiffies, idle)) {
+			cond_resched();
+			continue;
+		}
+
+		/* Tell the application before the last look at the SQ */
+		ctx->sq_wake = false;
+		ctx->hdr->flags |= USER_RING_NEED_WAKEUP;
+		smp_mb();
+		if (!user_ring_submit(ctx, ctx->sq_entries))
+			wait_event_interruptible(ctx->sq_wait, ctx->sq_wake ||
+						 kthread_should_stop());
+
+		ctx->hdr->flags &= ~USER_RING_NEED_WAKEUP;
+		idle = jiffies + ctx->sq_idle;
+	}
+
+	return 0;
+}
+
+/* The shared pages cannot be swapped: RLIMIT_MEMLOCK bounds them per user */
+static int user_ring_charge(struct user_ring_ctx *ctx)
+{
+	unsigned long limit, cur, pages = ctx->map_len >> PAGE_SHIFT;
+
+	ctx->user = get_current_user();
+	if (capable(CAP_IPC_LOCK))
+		return 0;
+
+	limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	do {
+		cur = atomic_long_read(&ctx->user->locked_vm);
+		if (cur + pages > limit)
+			return -ENOMEM;
+	} while (atomic_long_cmpxchg(&ctx->user->locked_vm, cur,
+				     cur + pages) != cur);
+	ctx->locked = pages;
+
+	return 0;
+}
+
+static void user_ring_free(struct user_ring_ctx *ctx)
+{
+	int i;
+
+	if (ctx->sq_thread)
+		kthread_stop(ctx->sq_thread);
+
+	for (i = 0; i < UR_TFMS; i++)
+		if (ctx->tfm[i])
+			crypto_free_pkc(ctx->tfm[i]);
+	if (ctx->evfd)
+		eventfd_ctx_put(ctx->evfd);
+	kfree(ctx->free);
+	vfree(ctx->reqs);
+	if (ctx->mem)
+		free_pages_exact(ctx->mem, ctx->map_len);
+	if (ctx->user) {
+		atomic_long_sub(ctx->locked, &ctx->user->locked_vm);
+		free_uid(ctx->user);
+	}
+	kfree(ctx);
+}
+
+static void user_ring_free_work(struct work_struct *work)
+{
+	user_ring_free(container_of(work, struct user_ring_ctx, free_work));
+}
+
+static int user_ring_alloc_tfms(struct user_ring_ctx *ctx)
+{
+	struct crypto_pkc *tfm;
+	int i;
+
+	for (i = 0; i < UR_TFMS; i++) {
+		tfm = crypto_alloc_pkc(user_ring_algs[i], 0, 0);
+		if (IS_ERR(tfm))
+			return PTR_ERR(tfm);
+		ctx->tfm[i] = tfm;
+		/* Spread the requests over all devices, unordered */
+		crypto_dev_sess_set_striped(tfm, false);
+	}
+
+	return 0;
+}
+
+/*******************************************************************************
+ * Function     : user_ring_setup
+ *
+ * Arguments    : filp - file the rings belong to
+ *		  arg - user_ring_params of the application
+ *
+ * Return Value : 0 or -errno
+ *
+ * Description  : USERRINGSETUP handler. Allocates the shared pages as one
+ *		  physically contiguous block, so that the operands the
+ *		  requests point into can be DMA mapped like any kernel
+ *		  buffer, and returns the layout to map.
+ *
+ ******************************************************************************/
+int user_ring_setup(struct file *filp, void __user *arg)
+{
+	struct user_ring_params p;
+	struct user_ring_ctx *ctx;
+	uint32_t i;
+	int ret = -ENOMEM;
+
+	if (filp->private_data)
+		return -EBUSY;
+	if (copy_from_user(&p, arg, sizeof(p)))
+		return -EFAULT;
+	if (!p.sq_entries || p.sq_entries > USER_RING_MAX_ENTRIES ||
+	    p.cq_entries > 2 * USER_RING_MAX_ENTRIES ||
+	    !p.buf_len || p.buf_len > USER_RING_MAX_BUF)
+		return -EINVAL;
+	if ((p.flags & USER_RING_SQPOLL) && !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	p.sq_entries = roundup_pow_of_two(p.sq_entries);
+	p.cq_entries = roundup_pow_of_two(p.cq_entries ? : 2 * p.sq_entries);
+	p.sq_off = ALIGN(sizeof(struct user_ring_hdr), L1_CACHE_BYTES);
+	p.cq_off = p.sq_off + p.sq_entries * sizeof(struct user_ring_sqe);
+	p.buf_off = ALIGN(p.cq_off + p.cq_entries * sizeof(struct user_ring_cqe),
+			  L1_CACHE_BYTES);
+	p.map_len = PAGE_ALIGN(p.buf_off + p.buf_len);
+	if (p.map_len > UR_MAX_MAP)
+		return -EINVAL;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->map_len = p.map_len;
+	ret = user_ring_charge(ctx);
+	if (ret)
+		goto out_err;
+
+	ret = -ENOMEM;
+	ctx->mem = alloc_pages_exact(p.map_len,
+				     GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN);
+	ctx->reqs = vzalloc(p.cq_entries * sizeof(*ctx->reqs));
+	ctx->free = kcalloc(p.cq_entries, sizeof(*ctx->free), GFP_KERNEL);
+	if (!ctx->mem || !ctx->reqs || !ctx->free)
+		goto out_err;
+
+	ctx->hdr = ctx->mem;
+	ctx->sqes = ctx->mem + p.sq_off;
+	ctx->cqes = ctx->mem + p.cq_off;
+	ctx->buf = ctx->mem + p.buf_off;
+	ctx->buf_len = p.buf_len;
+	ctx->sq_entries = p.sq_entries;
+	ctx->cq_entries = p.cq_entries;
+	ctx->hdr->sq_entries = p.sq_entries;
+	ctx->hdr->cq_entries = p.cq_entries;
+
+	mutex_init(&ctx->sq_lock);
+	mutex_init(&ctx->reap_lock);
+	spin_lock_init(&ctx->cq_lock);
+	init_waitqueue_head(&ctx->cq_wait);
+	init_waitqueue_head(&ctx->sq_wait);
+	INIT_WORK(&ctx->free_work, user_ring_free_work);
+	for (i = 0; i < p.cq_entries; i++) {
+		ctx->reqs[i].ctx = ctx;
+		ctx->free[i] = i;
+	}
+	ctx->nr_free = p.cq_entries;
+
+	ret = user_ring_alloc_tfms(ctx);
+	if (ret)
+		goto out_err;
+
+	if (p.flags & USER_RING_SQPOLL) {
+		p.sq_idle_ms = min_t(uint32_t, p.sq_idle_ms ? : 1000,
+				     USER_RING_MAX_IDLE_MS);
+		ctx->sq_idle = msecs_to_jiffies(p.sq_idle_ms);
+		ctx->sq_thread = kthread_run(user_ring_sq_thread, ctx,
+					     "pkc_sqpoll/%d",
+					     task_pid_nr(current));
+		if (IS_ERR(ctx->sq_thread)) {
+			ret = PTR_ERR(ctx->sq_thread);
+			ctx->sq_thread = NULL;
+			goto out_err;
+		}
+	}
+
+	if (cmpxchg(&filp->private_data, NULL, ctx)) {
+		ret = -EBUSY;
+		goto out_err;
+	}
+
+	if (copy_to_user(arg, &p, sizeof(p)))
+		return -EFAULT;
+
+	return 0;
+
+out_err:
+	user_ring_free(ctx);
+	return ret;
+}
+
+/*******************************************************************************
+ * Function     : user_ring_enter
+ *
+ * Arguments    : filp - file the rings belong to
+ *		  arg - user_ring_enter of the application
+ *
+ * Return Value : 0 or -errno
+ *
+ * Description  : USERRINGENTER handler. Issues up to to_submit requests, or
+ *		  wakes the SQ poll thread, then waits until min_complete
+ *		  cqes are ready or nothing is left in flight.
+ *
+ ******************************************************************************/
+int user_ring_enter(struct file *filp, void __user *arg)
+{
+	struct user_ring_ctx *ctx = filp->private_data;
+	struct user_ring_enter e;
+	uint32_t min;
+
+	if (!ctx)
+		return -ENXIO;
+	if (copy_from_user(&e, arg, sizeof(e)))
+		return -EFAULT;
+
+	e.submitted = 0;
+	if (ctx->sq_thread) {
+		if (e.flags & USER_RING_ENTER_WAKEUP) {
+			ctx->sq_wake = true;
+			wake_up(&ctx->sq_wait);
+		}
+	} else if (e.to_submit) {
+		e.submitted = user_ring_submit(ctx, e.to_submit);
+	}
+
+	if (copy_to_user(arg, &e, sizeof(e)))
+		return -EFAULT;
+
+	min = min(e.min_complete, ctx->cq_entries);
+	if (min && wait_event_interruptible(ctx->cq_wait,
+					    user_ring_cq_ready(ctx) >= min ||
+					    user_ring_idle(ctx)))
+		return -EINTR;
+
+	return 0;
+}
+
+/*******************************************************************************
+ * Function     : user_ring_submit_batch
+ *
+ * Arguments    : filp - file the rings belong to
+ *		  arg - user_ring_batch pointing to an array of sqes
+ *
+ * Return Value : 0 or -errno
+ *
+ * Description  : USERRINGSUBMIT handler. Issues the sqes in order without
+ *		  waiting for them, stopping early when the CQ has no room
+ *		  left; done tells how many were issued.
+ *
+ ******************************************************************************/
+int user_ring_submit_batch(struct file *filp, void __user *arg)
+{
+	struct user_ring_ctx *ctx = filp->private_data;
+	struct user_ring_sqe __user *usqe;
+	struct user_ring_batch b;
+	struct user_ring_req *req;
+	struct user_ring_sqe sqe;
+	int ret = 0;
+
+	if (!ctx)
+		return -ENXIO;
+	if (copy_from_user(&b, arg, sizeof(b)))
+		return -EFAULT;
+
+	usqe = (struct user_ring_sqe __user *)(uintptr_t)b.entries;
+	for (b.done = 0; b.done < b.nr; b.done++) {
+		if (copy_from_user(&sqe, &usqe[b.done], sizeof(sqe))) {
+			ret = -EFAULT;
+			break;
+		}
+		req = user_ring_get_req(ctx);
+		if (!req)
+			break;
+		user_ring_issue(ctx, req, &sqe);
+	}
+
+	/* done is reported even on a fault, the issued sqes stay issued */
+	if (copy_to_user(arg, &b, sizeof(b)))
+		return -EFAULT;
+
+	return (ret && !b.done) ? ret : 0;
+}
+
+/*******************************************************************************
+ * Function     : user_ring_reap
+ *
+ * Arguments    : filp - file the rings belong to
+ *		  arg - user_ring_batch pointing to an array of cqes
+ *
+ * Return Value : 0 or -errno
+ *
+ * Description  : USERRINGREAP handler. Copies out up to nr ready cqes and
+ *		  consumes them from the CQ. Does not wait.
+ *
+ ******************************************************************************/
+int user_ring_reap(struct file *filp, void __user *arg)
+{
+	struct user_ring_ctx *ctx = filp->private_data;
+	struct user_ring_cqe __user *ucqe;
+	struct user_ring_batch b;
+	uint32_t head, idx, n;
+	int ret = 0;
+
+	if (!ctx)
+		return -ENXIO;
+	if (copy_from_user(&b, arg, sizeof(b)))
+		return -EFAULT;
+
+	ucqe = (struct user_ring_cqe __user *)(uintptr_t)b.entries;
+
+	mutex_lock(&ctx->reap_lock);
+	head = UR_READ(ctx->hdr->cq_head);
+	b.nr = min3(b.nr, UR_READ(ctx->cq_tail) - head, ctx->cq_entries);
+	smp_rmb();
+
+	for (b.done = 0; b.done < b.nr; b.done += n) {
+		/* Up to the end of the CQ, then from its start */
+		idx = (head + b.done) & (ctx->cq_entries - 1);
+		n = min(b.nr - b.done, ctx->cq_entries - idx);
+		if (copy_to_user(&ucqe[b.done], &ctx->cqes[idx],
+				 n * sizeof(*ucqe))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	if (b.done) {
+		smp_mb();
+		ctx->hdr->cq_head = head + b.done;
+	}
+	mutex_unlock(&ctx->reap_lock);
+
+	if (copy_to_user(arg, &b, sizeof(b)))
+		return -EFAULT;
+
+	return ret;
+}
+
+int user_ring_set_eventfd(struct file *filp, void __user *arg)
+{
+	struct user_ring_ctx *ctx = filp->private_data;
+	struct eventfd_ctx *evfd = NULL, *old;
+	int32_t fd;
+
+	if (!ctx)
+		return -ENXIO;
+	if (get_user(fd, (int32_t __user *)arg))
+		return -EFAULT;
+
+	if (fd >= 0) {
+		evfd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(evfd))
+			return PTR_ERR(evfd);
+	}
+
+	spin_lock_irq(&ctx->cq_lock);
+	old = ctx->evfd;
+	ctx->evfd = evfd;
+	spin_unlock_irq(&ctx->cq_lock);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
+int user_ring_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct user_ring_ctx *ctx = filp->private_data;
+	unsigned long len = vma->vm_end - vma->vm_start;
+
+	if (!ctx)
+		return -ENXIO;
+	if (vma->vm_pgoff || len > ctx->map_len)
+		return -EINVAL;
+
+	/* The pages are DMA targets of this file only: not inherited over
+	 * fork, nor grown by mremap */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0))
+	vm_flags_set(vma, VM_DONTCOPY | VM_DONTEXPAND);
+#else
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND;
+#endif
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       virt_to_phys(ctx->mem) >> PAGE_SHIFT, len,
+			       vma->vm_page_prot);
+}
+
+/* Called on the last reference, so no mapping or ioctl is left. Requests
+ * still in flight keep the rings, which their last completion frees: a job
+ * that never completes costs its rings, not a hung close */
+void user_ring_release(struct file *filp)
+{
+	struct user_ring_ctx *ctx = filp->private_data;
+	bool idle;
+
+	if (!ctx)
+		return;
+
+	if (ctx->sq_thread)
+		kthread_stop(ctx->sq_thread);
+	ctx->sq_thread = NULL;
+
+	spin_lock_irq(&ctx->cq_lock);
+	idle = user_ring_idle(ctx);
+	ctx->closed = !idle;
+	spin_unlock_irq(&ctx->cq_lock);
+
+	if (idle)
+		user_ring_free(ctx);
+}
@@ -0,0 +1,160 @@
+/* Copyright 2013 Freescale Semiconductor, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of Freescale Semiconductor nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ *
+ * ALTERNATIVELY, this software may be distributed under the terms of the
+ * GNU General Public License ("GPL") as published by the Free Software
+ * Foundation, either version 2 of that License or (at your option) any
+ * later version.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Freescale Semiconductor ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Freescale Semiconductor BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE)ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FSL_PKC_USER_RING_H
+#define FSL_PKC_USER_RING_H
+
+/*******************************************************************************
+ * Shared memory request rings of /dev/fsl_cryptodev, one set per open file.
+ * USERRINGSETUP sizes them and mmap() of user_ring_params.map_len bytes at
+ * offset 0 maps them:
+ *
+ *	user_ring_hdr | sq_entries sqes | cq_entries cqes | buf_len bytes
+ *
+ * The mapping is one block of the page allocator, so map_len is bounded by
+ * its largest block (4 MB with 4 KB pages), and counts against the
+ * RLIMIT_MEMLOCK of the user unless the caller has CAP_IPC_LOCK.
+ *
+ * The application writes requests at sq_tail and advances it; the driver
+ * consumes them on USERRINGENTER, or from its own thread with
+ * USER_RING_SQPOLL, and posts one cqe per request at cq_tail. The
+ * application consumes cqes by advancing cq_head. All four indices are free
+ * running and masked with the entry count minus one.
+ *
+ * The operands of a request are (offset, length) pairs into the operand
+ * buffer, in the order below; outputs are written in place. Every operand
+ * is mandatory but ab of DSA and DH. Outputs are as long as the device
+ * writes them: the modulus (n, or f for forms 2 and 3, which n_len then
+ * equals) for RSA, r for the DSA signature, q for the DH secret. Other
+ * requests complete with -EINVAL.
+ *	RSA_PUB			n, e, f, g (out)
+ *	RSA_PRIV_FORM1		n, d, g, f (out)
+ *	RSA_PRIV_FORM2		p, q, d, g, f (out), n (length only)
+ *	RSA_PRIV_FORM3		p, q, dp, dq, c, g, f (out)
+ *	[EC]DSA_SIGN		q, r, g, priv_key, m, ab, c (out), d (out)
+ *	[EC]DSA_VERIFY		q, r, g, pub_key, m, ab, c, d
+ *	[EC]DH_COMPUTE_KEY	q, ab, pub_key, s, z (out)
+ * c and d of the DSA requests share the length of d.
+ *
+ * At most cq_entries requests are in flight or waiting in the CQ: the driver
+ * leaves requests in the SQ until the application makes room in the CQ.
+ * USER_RING_SQPOLL needs CAP_SYS_ADMIN. The thread sleeps after sq_idle_ms
+ * (at most USER_RING_MAX_IDLE_MS) without requests and sets
+ * USER_RING_NEED_WAKEUP; the application then calls USERRINGENTER
+ * with USER_RING_ENTER_WAKEUP after queueing requests or reaping cqes.
+ *
+ * Event loops may skip the shared SQ and CQ: USERRINGSUBMIT issues an array
+ * of sqes from the ioctl argument and returns without waiting, and
+ * USERRINGREAP moves up to nr ready cqes into an array, advancing cq_head.
+ * An eventfd registered with USERRINGEVENTFD (-1 to remove it) is signalled
+ * once per cqe posted, so the ring can sit in an epoll set next to sockets.
+ ******************************************************************************/
+#define USER_RING_MAX_ENTRIES	4096
+#define USER_RING_MAX_BUF	(4 << 20)
+#define USER_RING_MAX_IDLE_MS	1000
+#define USER_RING_MAX_ARGS	8
+
+/* user_ring_params.flags */
+#define USER_RING_SQPOLL	(1 << 0)
+/* user_ring_hdr.flags */
+#define USER_RING_NEED_WAKEUP	(1 << 0)
+/* user_ring_enter.flags */
+#define USER_RING_ENTER_WAKEUP	(1 << 0)
+
+struct user_ring_params {
+	uint32_t sq_entries;	/* in, rounded up to a power of 2 */
+	uint32_t cq_entries;	/* in, 0 for twice sq_entries */
+	uint32_t buf_len;	/* in, operand buffer length */
+	uint32_t flags;		/* in */
+	uint32_t sq_idle_ms;	/* in/out, SQ poll thread idle time */
+	uint32_t sq_off;	/* out, offsets within the mapping */
+	uint32_t cq_off;
+	uint32_t buf_off;
+	uint32_t map_len;	/* out */
+};
+
+struct user_ring_hdr {
+	uint32_t sq_head;	/* written by the driver */
+	uint32_t sq_tail;	/* written by the application */
+	uint32_t cq_head;	/* written by the application */
+	uint32_t cq_tail;	/* written by the driver */
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t flags;
+};
+
+struct user_ring_sqe {
+	uint64_t user_data;
+	uint32_t type;		/* enum pkc_req_type */
+	uint32_t curve_type;	/* enum curve_t */
+	struct {
+		uint32_t off;
+		uint32_t len;
+	} args[USER_RING_MAX_ARGS];
+};
+
+/* res: 0, -EKEYREJECTED for a failed verify, another -errno on error */
+struct user_ring_cqe {
+	uint64_t user_data;
+	int32_t res;
+	uint32_t rsvd;
+};
+
+struct user_ring_enter {
+	uint32_t to_submit;	/* in, ignored with USER_RING_SQPOLL */
+	uint32_t min_complete;	/* in, cqes to wait for */
+	uint32_t flags;		/* in */
+	uint32_t submitted;	/* out */
+};
+
+/* Argument of USERRINGSUBMIT and USERRINGREAP */
+struct user_ring_batch {
+	uint64_t entries;	/* in, user address of the sqe / cqe array */
+	uint32_t nr;		/* in, its length */
+	uint32_t done;		/* out, entries issued / reaped */
+};
+
+#ifdef __KERNEL__
+int user_ring_setup(struct file *filp, void __user *arg);
+int user_ring_enter(struct file *filp, void __user *arg);
+int user_ring_submit_batch(struct file *filp, void __user *arg);
+int user_ring_reap(struct file *filp, void __user *arg);
+int user_ring_set_eventfd(struct file *filp, void __user *arg);
+int user_ring_mmap(struct file *filp, struct vm_area_struct *vma);
+void user_ring_release(struct file *filp);
+#endif
+
+#endif